@@ -0,0 +1,501 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "utilities/algorithms.h"
+#include "image.h"
+#include "view.h"
+#include "buffer.h"
+#include "pool.h"
+#include "priority_buffer.h"
+#include "opencv_interface.h"
+#include "raw_file.h"
+#include "tiled_image.h"
+
+/* Benchmarks of the hot paths of ImageFrame, ImageBuffer, and Utilities.
+
+Each case is repeated for at least MinTime and MinRuns, and the median of the runs is
+reported as
+ns/px: nanoseconds per pixel (or per element for the range functions)
+GB/s: bytes read and written per second
+
+Usage: Benchmark [--large]
+--large adds 100 MPix frames, which take a few GB of memory.
+
+NOTE: std::chrono::high_resolution_clock of Visual Studio 2013 ticks in about 1 ms, so the
+cases run long enough for the resolution not to matter. */
+
+namespace
+{
+	typedef std::chrono::high_resolution_clock Clock;
+
+	const std::chrono::milliseconds MinTime(300);
+	const std::size_t MinRuns = 5;
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Timing and reporting.
+
+	double ToSeconds(Clock::duration d)
+	{
+		return std::chrono::duration_cast<std::chrono::duration<double>>(d).count();
+	}
+
+	// Median seconds per call of func after a warm-up call.
+	double Measure(const std::function<void(void)> &func)
+	{
+		func();
+		std::vector<double> runs;
+		auto start = Clock::now();
+		while (runs.size() < MinRuns || Clock::now() - start < MinTime)
+		{
+			auto t0 = Clock::now();
+			func();
+			runs.push_back(ToSeconds(Clock::now() - t0));
+		}
+		std::nth_element(runs.begin(), runs.begin() + runs.size() / 2, runs.end());
+		return runs[runs.size() / 2];
+	}
+
+	void Report(const std::string &name, const std::string &config, std::size_t nPixels,
+		std::size_t nBytes, double seconds)
+	{
+		std::cout << std::left << std::setw(30) << name << std::setw(26) << config <<
+			std::right << std::fixed << std::setprecision(3) << std::setw(10) <<
+			seconds * 1.0e9 / nPixels << " ns/px" << std::setw(10) <<
+			nBytes / seconds / 1.0e9 << " GB/s" << std::endl;
+	}
+
+	std::string ToString(Imaging::DataType ty)
+	{
+		switch (ty)
+		{
+		case Imaging::DataType::UCHAR:
+			return "uchar";
+		case Imaging::DataType::USHORT:
+			return "ushort";
+		case Imaging::DataType::INT:
+			return "int";
+		case Imaging::DataType::FLOAT:
+			return "float";
+		default:
+			return "other";
+		}
+	}
+
+	// Timing and reporting.
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// ImageFrame and OpenCV interface.
+
+	/* The dimension is kept as plain numbers; a copy of an ImageSize refers to the width
+	and height of the original, which does not outlive the aggregate initialization. */
+	struct FrameConfig
+	{
+		Imaging::DataType dataType;
+		Imaging::ImageSizeType width, height;
+		Imaging::ImageSizeType depth;
+	};
+
+	void BenchmarkFrame(const FrameConfig &cfg)
+	{
+		using namespace Imaging;
+
+		std::ostringstream config;
+		config << cfg.width << "x" << cfg.height << "x" << cfg.depth << " " <<
+			ToString(cfg.dataType);
+		const std::size_t nPixels = cfg.width * cfg.height;
+		const ImageSize size(cfg.width, cfg.height);
+
+		ImageFrame img1(cfg.dataType, size, cfg.depth);
+		std::fill(img1.Begin(), img1.Begin() + img1.data.size(), 1);
+		const std::size_t nBytes = img1.data.size();
+
+		Report("ImageFrame copy", config.str(), nPixels, 2 * nBytes, Measure([&img1](void)
+		{
+			ImageFrame img2(img1);
+		}));
+
+		// No image data is touched; the numbers are per frame.
+		ImageFrame img2(img1);
+		double t = Measure([&img2](void)
+		{
+			ImageFrame img3(std::move(img2));
+			img2 = std::move(img3);
+		});
+		std::cout << std::left << std::setw(30) << "ImageFrame move x2" << std::setw(26) <<
+			config.str() << std::right << std::setw(10) << t * 1.0e9 << " ns/frame" <<
+			std::endl;
+
+		// Source lines aligned to 64 bytes; padded unless a line is a multiple of 64 bytes.
+		ImageFrame imgPadded(cfg.dataType, size, cfg.depth, 64);
+		ImageFrame img4;
+		Report("ImageFrame CopyFrom(ptr)", config.str(), nPixels, 2 * nBytes,
+			Measure([&](void)
+		{
+			img4.CopyFrom(&(*imgPadded.Cbegin()), imgPadded.dataType, imgPadded.size,
+				imgPadded.depth, imgPadded.bytesPerLine);
+		}));
+
+		// Center quarter of the frame.
+		ImageFrame::ROI roi({ cfg.width / 4, cfg.height / 4 },
+			{ cfg.width / 2, cfg.height / 2 });
+		Report("ImageFrame CopyTo(ROI)", config.str(), nPixels / 4, nBytes / 2,
+			Measure([&img1, &roi](void)
+		{
+			ImageFrame img5 = img1.CopyTo(roi);
+		}));
+
+		Report("CreateCvMat", config.str(), nPixels, 2 * nBytes, Measure([&img1](void)
+		{
+			cv::Mat cvDst = CreateCvMat(img1);
+		}));
+
+		t = Measure([&img1](void)
+		{
+			cv::Mat cvDst = CreateCvMatShared(img1);
+		});
+		std::cout << std::left << std::setw(30) << "CreateCvMatShared" << std::setw(26) <<
+			config.str() << std::right << std::setw(10) << t * 1.0e9 << " ns/frame" <<
+			std::endl;
+
+		// As loading an image with cv::imread(); only the data of a cv::Mat is taken over.
+		cv::Mat cvSrc = CreateCvMat(img1);
+		t = Measure([&cvSrc](void)
+		{
+			cv::Mat cvTemp = cvSrc;
+			ImageFrame img6 = CreateImageFrame(std::move(cvTemp));
+		});
+		std::cout << std::left << std::setw(30) << "CreateImageFrame(cv::Mat &&)" <<
+			std::setw(26) << config.str() << std::right << std::setw(10) << t * 1.0e9 <<
+			" ns/frame" << std::endl;
+
+		// Only the header is read; the pages of the image data are faulted in on access.
+		WriteRawFile("benchmark.raw", img1);
+		t = Measure([](void)
+		{
+			ImageFrame img7 = OpenRawFile("benchmark.raw");
+		});
+		std::cout << std::left << std::setw(30) << "OpenRawFile" << std::setw(26) <<
+			config.str() << std::right << std::setw(10) << t * 1.0e9 << " ns/frame" <<
+			std::endl;
+
+		// Same ROI as above stitched from 256x256 tiles, which are resident after a run.
+		const std::size_t nTiles = (cfg.width / 256 + 1) * (cfg.height / 256 + 1);
+		TiledImage tiled(std::make_shared<RawFileTileStore>("benchmark.raw"), { 256, 256 },
+			nTiles);
+		Report("TiledImage CopyTo(ROI)", config.str(), nPixels / 4, nBytes / 2,
+			Measure([&tiled, &roi](void)
+		{
+			ImageFrame img8 = tiled.CopyTo(roi);
+		}));
+		std::remove("benchmark.raw");
+	}
+
+	// ImageFrame and OpenCV interface.
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Storage
+
+	// A new frame per iteration, as a capture loop without a FramePool; numbers per frame.
+	void BenchmarkStorage(const std::string &name,
+		const std::shared_ptr<Imaging::Storage> &storage, const Imaging::ImageSize &sz,
+		Imaging::Init init = Imaging::Init::Zero)
+	{
+		using namespace Imaging;
+
+		double t = Measure([&](void)
+		{
+			ImageFrame img;
+			img.SetStorage(storage);
+			img.Reset(DataType::UCHAR, sz, 3, 1, init);
+			*img.Begin() = 1;
+		});
+		std::ostringstream config;
+		config << sz.width << "x" << sz.height << "x3 uchar";
+		std::cout << std::left << std::setw(30) << "ImageFrame Reset " + name <<
+			std::setw(26) << config.str() << std::right << std::setw(10) << t * 1.0e9 <<
+			" ns/frame" << std::endl;
+	}
+
+	// Storage
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// ImageBuffer
+
+	/* Producers push frames from a FramePool with their push time stamped in the first
+	bytes, and consumers take the latency when they pop them. With 'batch' > 1, the frames
+	are pushed and popped in batches of up to that many frames (push_n()/try_pop_n()). */
+	void BenchmarkBuffer(std::size_t nProducers, std::size_t nConsumers,
+		std::size_t batch = 1)
+	{
+		using namespace Imaging;
+
+		const std::size_t nFramesPerProducer = 2000, capacity = 8;
+		const ImageSize sz(640, 480);
+		const std::size_t nFrames = nFramesPerProducer * nProducers;
+
+		// Room for every frame in flight: in the buffer and in the batches of the threads.
+		const std::size_t capacityBuffer = std::max(capacity, batch);
+		FramePool pool(DataType::UCHAR, sz, 1,
+			capacityBuffer * 2 + batch * (nProducers + nConsumers));
+		ImageBuffer buffer(capacityBuffer, pool);
+		std::atomic_size_t nPopped(0);
+		std::vector<std::vector<double>> latencies(nConsumers);
+		std::vector<std::thread> threads;
+
+		auto start = Clock::now();
+		for (std::size_t n = 0; n != nConsumers; ++n)
+			threads.push_back(std::thread([&, n](void)
+			{
+				std::vector<ImageFrame> imgs(batch);
+				while (nPopped < nFrames)
+				{
+					std::size_t m = 0;
+					if (batch == 1)
+						m = buffer.try_pop(imgs[0], std::chrono::seconds(1)) ? 1 : 0;
+					else
+						m = buffer.try_pop_n(imgs.begin(), batch, std::chrono::seconds(1));
+					for (std::size_t i = 0; i != m; ++i)
+					{
+						Clock::rep stamp;
+						std::memcpy(&stamp, &(*imgs[i].Cbegin()), sizeof(stamp));
+						latencies[n].push_back(ToSeconds(Clock::now().time_since_epoch() -
+							Clock::duration(stamp)));
+					}
+					nPopped += m;
+				}
+			}));
+		for (std::size_t n = 0; n != nProducers; ++n)
+			threads.push_back(std::thread([&](void)
+			{
+				std::vector<ImageFrame> imgs;
+				for (std::size_t i = 0; i != nFramesPerProducer; ++i)
+				{
+					imgs.push_back(pool.acquire());
+					Clock::rep stamp = Clock::now().time_since_epoch().count();
+					std::memcpy(&(*imgs.back().Begin()), &stamp, sizeof(stamp));
+					if (imgs.size() == batch || i + 1 == nFramesPerProducer)
+					{
+						if (batch == 1)
+							buffer.push(std::move(imgs[0]));
+						else
+							buffer.push_n(imgs.begin(), imgs.size());
+						imgs.clear();
+					}
+				}
+			}));
+
+		// Throughput up to the last frame, and then the consumers wait for their time-out.
+		while (nPopped < nFrames)
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		double seconds = ToSeconds(Clock::now() - start);
+		for (auto &thread : threads)
+			thread.join();
+
+		std::vector<double> all;
+		for (const auto &v : latencies)
+			all.insert(all.end(), v.begin(), v.end());
+		std::sort(all.begin(), all.end());
+		auto percentile = [&all](double p)
+		{
+			return all[std::min(all.size() - 1, static_cast<std::size_t>(p * all.size()))] *
+				1.0e6;
+		};
+
+		std::ostringstream config;
+		config << nProducers << "P/" << nConsumers << "C 640x480 uchar";
+		std::string name = batch == 1 ? "ImageBuffer push/pop" :
+			"ImageBuffer push_n/pop_n x" + std::to_string(batch);
+		std::cout << std::left << std::setw(30) << name << std::setw(26) <<
+			config.str() << std::right << std::fixed << std::setprecision(1) <<
+			std::setw(10) << nFrames / seconds << " frames/s  latency us p50 " <<
+			percentile(0.5) << " p90 " << percentile(0.9) << " p99 " << percentile(0.99) <<
+			" max " << percentile(1.0) << std::endl;
+	}
+
+	/* A producer keeps a backlog of bulk frames queued with every 16th frame urgent, and a
+	consumer spends about 20 us on each frame. The latency of the urgent frames is taken in
+	a single FIFO (ImageBuffer) and in a lane of their own (PriorityImageBuffer). */
+	void BenchmarkPriorityBuffer(bool lanes)
+	{
+		using namespace Imaging;
+
+		const std::size_t nFrames = 4000, capacity = 64, interval = 16;
+		const ImageSize sz(640, 480);
+
+		FramePool pool(DataType::UCHAR, sz, 1, capacity * 2 + 16);
+		ImageBuffer fifo(capacity, pool);
+		PriorityImageBuffer priority({ capacity / interval, capacity }, {}, pool);
+		std::vector<double> latencies;
+
+		std::thread consumer([&](void)
+		{
+			ImageFrame img;
+			for (std::size_t n = 0; n != nFrames; ++n)
+			{
+				if (!(lanes ? priority.try_pop(img) : fifo.try_pop(img)))
+					break;
+				Clock::rep stamp;
+				std::memcpy(&stamp, &(*img.Cbegin()), sizeof(stamp));
+				if (stamp != 0)
+					latencies.push_back(ToSeconds(Clock::now().time_since_epoch() -
+						Clock::duration(stamp)));
+
+				// Process the frame.
+				auto until = Clock::now() + std::chrono::microseconds(20);
+				while (Clock::now() < until)
+					;
+			}
+		});
+		for (std::size_t n = 0; n != nFrames; ++n)
+		{
+			ImageFrame img = pool.acquire();
+			bool urgent = n % interval == interval - 1;
+			Clock::rep stamp = urgent ? Clock::now().time_since_epoch().count() : 0;
+			std::memcpy(&(*img.Begin()), &stamp, sizeof(stamp));
+			if (lanes)
+				priority.push(urgent ? 0 : 1, std::move(img));
+			else
+				fifo.push(std::move(img));
+		}
+		consumer.join();
+
+		std::sort(latencies.begin(), latencies.end());
+		auto percentile = [&latencies](double p)
+		{
+			return latencies[std::min(latencies.size() - 1,
+				static_cast<std::size_t>(p * latencies.size()))] * 1.0e6;
+		};
+
+		std::ostringstream config;
+		config << "1P/1C backlog " << capacity;
+		std::string name = lanes ? "PriorityImageBuffer 2 lanes" : "ImageBuffer (FIFO)";
+		std::cout << std::left << std::setw(30) << name << std::setw(26) <<
+			config.str() << std::right << std::fixed << std::setprecision(1) <<
+			"urgent latency us p50 " << percentile(0.5) << " p90 " << percentile(0.9) <<
+			" p99 " << percentile(0.99) << " max " << percentile(1.0) << std::endl;
+	}
+
+	// ImageBuffer
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Utilities::*Range
+
+	template <typename T>
+	std::string TypeName(void)
+	{
+		return ToString(Imaging::GetDataType<T>());
+	}
+
+	// C = A op B with pointers (vectorized) and std::vector iterators (element-wise).
+	template <typename T>
+	void BenchmarkRanges(std::size_t n)
+	{
+		std::vector<T> v1(n, 3), v2(n, 2), v3(n);
+		const T *p1 = v1.data(), *p2 = v2.data();
+		T *p3 = v3.data();
+		std::ostringstream config;
+		config << n << " " << TypeName<T>();
+		const std::size_t nBytes = 3 * n * sizeof(T);
+
+		Report("AddRange(ptr)", config.str(), n, nBytes, Measure([=](void)
+		{
+			Utilities::AddRange(p1, p1 + n, p2, p3);
+		}));
+		Report("AddRange(iterator)", config.str(), n, nBytes, Measure([&](void)
+		{
+			Utilities::AddRange(v1.cbegin(), v1.cend(), v2.cbegin(), v3.begin());
+		}));
+		Report("AddRange(ptr, Saturate)", config.str(), n, nBytes, Measure([=](void)
+		{
+			Utilities::AddRange(p1, p1 + n, p2, p3, Utilities::Saturate());
+		}));
+		Report("MultiplyRange(ptr)", config.str(), n, nBytes, Measure([=](void)
+		{
+			Utilities::MultiplyRange(p1, p1 + n, p2, p3);
+		}));
+		Report("MultiplyRange(ptr, Saturate)", config.str(), n, nBytes, Measure([=](void)
+		{
+			Utilities::MultiplyRange(p1, p1 + n, p2, p3, Utilities::Saturate());
+		}));
+	}
+
+	void BenchmarkCastRange(std::size_t n)
+	{
+		std::vector<float> v1(n, 300.0f);
+		std::vector<unsigned char> v2(n);
+		const float *p1 = v1.data();
+		unsigned char *p2 = v2.data();
+		std::ostringstream config;
+		config << n << " float->uchar";
+		const std::size_t nBytes = n * (sizeof(float) + sizeof(unsigned char));
+
+		Report("CastRange(ptr, Saturate)", config.str(), n, nBytes, Measure([=](void)
+		{
+			Utilities::CastRange(p1, p1 + n, p2, Utilities::Saturate());
+		}));
+	}
+
+	// Utilities::*Range
+	////////////////////////////////////////////////////////////////////////////////////////
+}
+
+int main(int argc, char *argv[])
+{
+	using namespace Imaging;
+
+	bool large = argc > 1 && std::string(argv[1]) == "--large";
+
+	// Width and height; a std::vector<ImageSize> copies each ImageSize (see FrameConfig).
+	typedef std::pair<ImageSizeType, ImageSizeType> Dimension;
+	std::vector<Dimension> sizes = { Dimension(640, 480), Dimension(1920, 1080),
+		Dimension(4000, 3000) };
+	if (large)
+		sizes.push_back(Dimension(10000, 10000));
+	const DataType types[] = { DataType::UCHAR, DataType::USHORT, DataType::FLOAT };
+	const ImageSizeType depths[] = { 1, 3 };
+
+	for (const auto &dim : sizes)
+		for (auto ty : types)
+			for (auto d : depths)
+				BenchmarkFrame({ ty, dim.first, dim.second, d });
+
+	for (const auto &dim : sizes)
+	{
+		const ImageSize sz(dim.first, dim.second);
+		BenchmarkStorage("(heap)", nullptr, sz);
+		BenchmarkStorage("(no init)", nullptr, sz, Init::None);
+		BenchmarkStorage("(slab)", std::make_shared<SlabStorage>(), sz);
+		BenchmarkStorage("(huge page)", std::make_shared<HugePageStorage>(), sz);
+	}
+
+	const std::size_t nCores = std::max(2U, std::thread::hardware_concurrency());
+	for (std::size_t nProducers = 1; nProducers <= nCores; nProducers *= 2)
+		for (std::size_t nConsumers = 1; nConsumers <= nCores; nConsumers *= 2)
+			BenchmarkBuffer(nProducers, nConsumers);
+	for (std::size_t nConsumers = 1; nConsumers <= nCores; nConsumers *= 2)
+		BenchmarkBuffer(1, nConsumers, 32);
+	BenchmarkPriorityBuffer(false);
+	BenchmarkPriorityBuffer(true);
+
+	const std::size_t nElems = 1 << 22;
+	BenchmarkRanges<unsigned char>(nElems);
+	BenchmarkRanges<unsigned short>(nElems);
+	BenchmarkRanges<int>(nElems);
+	BenchmarkRanges<float>(nElems);
+	BenchmarkCastRange(nElems);
+}
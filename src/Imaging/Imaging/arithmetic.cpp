@@ -0,0 +1,252 @@
+#include <algorithm>
+#include <mutex>
+#include <sstream>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+#include "arithmetic.h"
+#include "arithmetic_kernels.h"
+#include "parallel.h"
+
+namespace Imaging
+{
+	namespace Internal
+	{
+		////////////////////////////////////////////////////////////////////////////////////
+		// Scalar kernels.
+
+		template <typename T>
+		void RegisterScalarKernels(ArithmeticKernels &kernels)
+		{
+			DataType ty = GetDataType<T>();
+			SetKernel(kernels, ArithmeticOp::ADD, true, ty, ScalarLineFunc<T, AddSatOp>);
+			SetKernel(kernels, ArithmeticOp::ADD, false, ty, ScalarLineFunc<T, AddWrapOp>);
+			SetKernel(kernels, ArithmeticOp::SUBTRACT, true, ty,
+				ScalarLineFunc<T, SubSatOp>);
+			SetKernel(kernels, ArithmeticOp::SUBTRACT, false, ty,
+				ScalarLineFunc<T, SubWrapOp>);
+			SetKernel(kernels, ArithmeticOp::MULTIPLY, true, ty,
+				ScalarLineFunc<T, MulSatOp>);
+			SetKernel(kernels, ArithmeticOp::MULTIPLY, false, ty,
+				ScalarLineFunc<T, MulWrapOp>);
+			SetKernel(kernels, ArithmeticOp::ABSDIFF, true, ty,
+				ScalarLineFunc<T, AbsDiffSatOp>);
+			SetKernel(kernels, ArithmeticOp::ABSDIFF, false, ty,
+				ScalarLineFunc<T, AbsDiffWrapOp>);
+		}
+
+		void RegisterScalarKernels(ArithmeticKernels &kernels)
+		{
+			// CHAR is filled by either SCHAR or UCHAR.
+			RegisterScalarKernels<signed char>(kernels);
+			RegisterScalarKernels<unsigned char>(kernels);
+			RegisterScalarKernels<short>(kernels);
+			RegisterScalarKernels<unsigned short>(kernels);
+			RegisterScalarKernels<int>(kernels);
+			RegisterScalarKernels<unsigned int>(kernels);
+			RegisterScalarKernels<long long>(kernels);
+			RegisterScalarKernels<unsigned long long>(kernels);
+			RegisterScalarKernels<float>(kernels);
+			RegisterScalarKernels<double>(kernels);
+		}
+
+		// Scalar kernels.
+		////////////////////////////////////////////////////////////////////////////////////
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// CPU detection.
+
+		/* AVX2 requires both the CPU support and the OS support of saving the YMM registers
+		on context switches. */
+		bool HaveAvx2(void)
+		{
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+			int info[4];
+			__cpuid(info, 0);
+			if (info[0] < 7)
+				return false;
+
+			// OSXSAVE and AVX.
+			__cpuid(info, 1);
+			const int osxsave = 1 << 27, avx = 1 << 28;
+			if ((info[2] & osxsave) == 0 || (info[2] & avx) == 0)
+				return false;
+
+			// XMM and YMM states enabled by the OS.
+			if ((_xgetbv(0) & 0x6) != 0x6)
+				return false;
+
+			__cpuidex(info, 7, 0);
+			return (info[1] & (1 << 5)) != 0;
+#elif defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+			// Checks the OS support as well.
+			return __builtin_cpu_supports("avx2") != 0;
+#else
+			return false;
+#endif
+		}
+
+		// CPU detection.
+		////////////////////////////////////////////////////////////////////////////////////
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Kernel table.
+
+		// Singleton; see Internal::poolFlag in thread_pool.cpp.
+		std::once_flag kernelTableFlag;
+		ArithmeticKernels kernelTable;
+
+		// Built once on the first use; read-only afterward, so no lock is required.
+		const ArithmeticKernels &GetKernels(void)
+		{
+			std::call_once(kernelTableFlag, [](void)
+			{
+				RegisterScalarKernels(kernelTable);
+				RegisterSse2Kernels(kernelTable);
+				if (HaveAvx2())
+					RegisterAvx2Kernels(kernelTable);
+			});
+			return kernelTable;
+		}
+
+		// Kernel table.
+		////////////////////////////////////////////////////////////////////////////////////
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Common routine of the operations.
+
+		// A smaller band (of the three images) costs more to schedule than it saves.
+		const std::size_t MinBytesPerBand = 1 << 20;
+
+		void EvaluateLines(ArithmeticLineFunc func, const ConstImageView &imgA,
+			const ConstImageView &imgB, const ImageView &imgC)
+		{
+			// Number of elements per line.
+			auto nElemPerLine = imgA.size.width * imgA.depth;
+
+			// One call for the entire image if no image has padding bytes.
+			if (imgA.HaveZeroPaddingBytes() && imgB.HaveZeroPaddingBytes() &&
+				imgC.HaveZeroPaddingBytes())
+				func(imgA.Cbegin(), imgB.Cbegin(), imgC.Begin(), nElemPerLine *
+				imgA.size.height);
+			else
+			{
+				auto itA = imgA.Cbegin();
+				auto itB = imgB.Cbegin();
+				auto itC = imgC.Begin();
+				for (ImageFrame::SizeType y = 0; y != imgA.size.height; ++y)
+				{
+					func(itA, itB, itC, nElemPerLine);
+					itA += imgA.bytesPerLine;
+					itB += imgB.bytesPerLine;
+					itC += imgC.bytesPerLine;
+				}
+			}
+		}
+
+		void EvalSameDimension(const ConstImageView &imgA, const ConstImageView &imgB)
+		{
+			if (imgA.dataType != imgB.dataType || imgA.size != imgB.size ||
+				imgA.depth != imgB.depth)
+			{
+				std::ostringstream errMsg;
+				errMsg << "The dimensions of images (" << imgA.size.width << " x " <<
+					imgA.size.height << " x " << imgA.depth << ", " << imgB.size.width <<
+					" x " << imgB.size.height << " x " << imgB.depth <<
+					") or data types do not match.";
+				throw std::invalid_argument(errMsg.str());
+			}
+		}
+
+		void Evaluate(ArithmeticOp op, const ConstImageView &imgA, const ConstImageView &imgB,
+			const ImageView &imgC, OverflowMode mode)
+		{
+			EvalSameDimension(imgA, imgB);
+			EvalSameDimension(imgA, imgC);
+			if (imgA.IsEmpty())
+				return;
+			if (imgA.dataType == DataType::UNDEFINED)
+				throw std::runtime_error("Data type is undefined.");
+
+			ArithmeticLineFunc func = GetKernels().funcs[ToIndex(op)][ToIndex(
+				mode == OverflowMode::SATURATE)][ToIndex(imgA.dataType)];
+
+			// Large images are split into bands of lines across the thread pool.
+			auto bytes_line = GetNumBytes(imgA.dataType) * imgA.size.width * imgA.depth * 3;
+			ParallelForRows(imgC, [&](const ImageView &bandC, const ImageFrame::ROI &roi)
+			{
+				EvaluateLines(func, imgA.SubView(roi), imgB.SubView(roi), bandC);
+			}, std::max<ImageFrame::SizeType>(1, MinBytesPerBand / bytes_line));
+		}
+
+		void Evaluate(ArithmeticOp op, const ConstImageView &imgA, const ConstImageView &imgB,
+			ImageFrame &imgC, OverflowMode mode)
+		{
+			EvalSameDimension(imgA, imgB);
+			if (imgC.dataType != imgA.dataType || imgC.size != imgA.size ||
+				imgC.depth != imgA.depth)
+				imgC.Reset(imgA.dataType, imgA.size, imgA.depth, imgC.alignment);
+			Evaluate(op, imgA, imgB, ImageView(imgC), mode);
+		}
+
+		// Common routine of the operations.
+		////////////////////////////////////////////////////////////////////////////////////
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Operations.
+
+	void Add(const ConstImageView &imgA, const ConstImageView &imgB, const ImageView &imgC,
+		OverflowMode mode)
+	{
+		Internal::Evaluate(Internal::ArithmeticOp::ADD, imgA, imgB, imgC, mode);
+	}
+
+	void Subtract(const ConstImageView &imgA, const ConstImageView &imgB,
+		const ImageView &imgC, OverflowMode mode)
+	{
+		Internal::Evaluate(Internal::ArithmeticOp::SUBTRACT, imgA, imgB, imgC, mode);
+	}
+
+	void Multiply(const ConstImageView &imgA, const ConstImageView &imgB,
+		const ImageView &imgC, OverflowMode mode)
+	{
+		Internal::Evaluate(Internal::ArithmeticOp::MULTIPLY, imgA, imgB, imgC, mode);
+	}
+
+	void AbsDiff(const ConstImageView &imgA, const ConstImageView &imgB,
+		const ImageView &imgC, OverflowMode mode)
+	{
+		Internal::Evaluate(Internal::ArithmeticOp::ABSDIFF, imgA, imgB, imgC, mode);
+	}
+
+	void Add(const ConstImageView &imgA, const ConstImageView &imgB, ImageFrame &imgC,
+		OverflowMode mode)
+	{
+		Internal::Evaluate(Internal::ArithmeticOp::ADD, imgA, imgB, imgC, mode);
+	}
+
+	void Subtract(const ConstImageView &imgA, const ConstImageView &imgB, ImageFrame &imgC,
+		OverflowMode mode)
+	{
+		Internal::Evaluate(Internal::ArithmeticOp::SUBTRACT, imgA, imgB, imgC, mode);
+	}
+
+	void Multiply(const ConstImageView &imgA, const ConstImageView &imgB, ImageFrame &imgC,
+		OverflowMode mode)
+	{
+		Internal::Evaluate(Internal::ArithmeticOp::MULTIPLY, imgA, imgB, imgC, mode);
+	}
+
+	void AbsDiff(const ConstImageView &imgA, const ConstImageView &imgB, ImageFrame &imgC,
+		OverflowMode mode)
+	{
+		Internal::Evaluate(Internal::ArithmeticOp::ABSDIFF, imgA, imgB, imgC, mode);
+	}
+
+	// Operations.
+	////////////////////////////////////////////////////////////////////////////////////////
+}
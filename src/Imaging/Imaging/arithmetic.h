@@ -0,0 +1,55 @@
+#if !defined(ARITHMETIC_H)
+#define ARITHMETIC_H
+
+#include "image.h"
+#include "view.h"
+
+namespace Imaging
+{
+	/* Element-wise arithmetic operations between images.
+
+	C = A op B is computed for every channel of every pixel, where A, B, and C must have
+	the same data type, size, and depth. C may be the same image as A or B (in-place
+	operation).
+
+	Each line is processed by a kernel chosen at runtime per {operation, data type, mode}.
+	AVX2 kernels are used if the CPU and the OS support AVX2, SSE2 kernels otherwise, and
+	scalar kernels for combinations without SIMD support (e.g. 32-bit integer
+	multiplication). All kernels produce identical results.
+	Large images are split into bands of lines across the thread pool (see parallel.h).
+
+	Unlike Utilities::Add() and its relatives, these functions never throw on overflow.
+	The result of integral operations is either clamped to the range of the data type
+	(SATURATE) or truncated to its bits (WRAP). The mode is ignored for floating point
+	types.
+
+	AbsDiff: |A - B|. Always exact for unsigned types. For signed types, the difference may
+	exceed the maximum value of the type, e.g. |-128 - 127| for signed char. */
+
+	enum struct OverflowMode
+	{
+		SATURATE,
+		WRAP
+	};
+
+	void Add(const ConstImageView &imgA, const ConstImageView &imgB, const ImageView &imgC,
+		OverflowMode mode = OverflowMode::SATURATE);
+	void Subtract(const ConstImageView &imgA, const ConstImageView &imgB,
+		const ImageView &imgC, OverflowMode mode = OverflowMode::SATURATE);
+	void Multiply(const ConstImageView &imgA, const ConstImageView &imgB,
+		const ImageView &imgC, OverflowMode mode = OverflowMode::SATURATE);
+	void AbsDiff(const ConstImageView &imgA, const ConstImageView &imgB,
+		const ImageView &imgC, OverflowMode mode = OverflowMode::SATURATE);
+
+	/* Destination is resized per the size of source data, keeping its line alignment.
+	No re-allocation happens if the destination already has the same dimension. */
+	void Add(const ConstImageView &imgA, const ConstImageView &imgB, ImageFrame &imgC,
+		OverflowMode mode = OverflowMode::SATURATE);
+	void Subtract(const ConstImageView &imgA, const ConstImageView &imgB, ImageFrame &imgC,
+		OverflowMode mode = OverflowMode::SATURATE);
+	void Multiply(const ConstImageView &imgA, const ConstImageView &imgB, ImageFrame &imgC,
+		OverflowMode mode = OverflowMode::SATURATE);
+	void AbsDiff(const ConstImageView &imgA, const ConstImageView &imgB, ImageFrame &imgC,
+		OverflowMode mode = OverflowMode::SATURATE);
+}
+#endif
@@ -0,0 +1,131 @@
+#include "arithmetic_kernels.h"
+
+/* AVX2 kernels are selected at runtime only if the CPU and the OS support AVX2, so this
+file is compiled without any instruction set option; the rest of the program must run on
+CPUs without AVX2.
+Visual Studio accepts AVX2 intrinsics without /arch:AVX2. GCC and Clang require the target
+to be enabled per function, which is limited to the code below by push_options. */
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define IMAGING_HAVE_AVX2
+#endif
+
+#if defined(IMAGING_HAVE_AVX2)
+#if defined(__GNUC__)
+#pragma GCC push_options
+#pragma GCC target("avx2")
+#endif
+
+#include <immintrin.h>
+
+namespace Imaging
+{
+	namespace Internal
+	{
+		namespace
+		{
+			// Intrinsics of 256-bit vectors.
+			// The packing and unpacking instructions work within each 128-bit lane, which the
+			// kernels rely on by always unpacking and packing the same pair of vectors.
+			struct Avx2
+			{
+				typedef __m256i I;
+				typedef __m256 F;
+				typedef __m256d D;
+				static const std::size_t Bytes = 32;
+
+				static void ZeroUpper(void) { _mm256_zeroupper(); }
+
+				static I Load(const void *src) { return _mm256_loadu_si256(static_cast<const I *>(src)); }
+				static void Store(void *dst, I v) { _mm256_storeu_si256(static_cast<I *>(dst), v); }
+				static F LoadPs(const float *src) { return _mm256_loadu_ps(src); }
+				static void StorePs(float *dst, F v) { _mm256_storeu_ps(dst, v); }
+				static D LoadPd(const double *src) { return _mm256_loadu_pd(src); }
+				static void StorePd(double *dst, D v) { _mm256_storeu_pd(dst, v); }
+
+				static I Zero(void) { return _mm256_setzero_si256(); }
+				static I Set1Epi8(char v) { return _mm256_set1_epi8(v); }
+				static I Set1Epi16(short v) { return _mm256_set1_epi16(v); }
+				static I Set1Epi32(int v) { return _mm256_set1_epi32(v); }
+
+				static I And(I a, I b) { return _mm256_and_si256(a, b); }
+				static I AndNot(I a, I b) { return _mm256_andnot_si256(a, b); }
+				static I Or(I a, I b) { return _mm256_or_si256(a, b); }
+				static I Xor(I a, I b) { return _mm256_xor_si256(a, b); }
+
+				static I AddEpi8(I a, I b) { return _mm256_add_epi8(a, b); }
+				static I AddEpi16(I a, I b) { return _mm256_add_epi16(a, b); }
+				static I AddEpi32(I a, I b) { return _mm256_add_epi32(a, b); }
+				static I AddEpi64(I a, I b) { return _mm256_add_epi64(a, b); }
+				static I SubEpi8(I a, I b) { return _mm256_sub_epi8(a, b); }
+				static I SubEpi16(I a, I b) { return _mm256_sub_epi16(a, b); }
+				static I SubEpi32(I a, I b) { return _mm256_sub_epi32(a, b); }
+				static I SubEpi64(I a, I b) { return _mm256_sub_epi64(a, b); }
+
+				static I AddsEpi8(I a, I b) { return _mm256_adds_epi8(a, b); }
+				static I AddsEpu8(I a, I b) { return _mm256_adds_epu8(a, b); }
+				static I AddsEpi16(I a, I b) { return _mm256_adds_epi16(a, b); }
+				static I AddsEpu16(I a, I b) { return _mm256_adds_epu16(a, b); }
+				static I SubsEpi8(I a, I b) { return _mm256_subs_epi8(a, b); }
+				static I SubsEpu8(I a, I b) { return _mm256_subs_epu8(a, b); }
+				static I SubsEpi16(I a, I b) { return _mm256_subs_epi16(a, b); }
+				static I SubsEpu16(I a, I b) { return _mm256_subs_epu16(a, b); }
+
+				static I MulloEpi16(I a, I b) { return _mm256_mullo_epi16(a, b); }
+				static I MulhiEpi16(I a, I b) { return _mm256_mulhi_epi16(a, b); }
+				static I MulhiEpu16(I a, I b) { return _mm256_mulhi_epu16(a, b); }
+
+				static I UnpackloEpi8(I a, I b) { return _mm256_unpacklo_epi8(a, b); }
+				static I UnpackhiEpi8(I a, I b) { return _mm256_unpackhi_epi8(a, b); }
+				static I UnpackloEpi16(I a, I b) { return _mm256_unpacklo_epi16(a, b); }
+				static I UnpackhiEpi16(I a, I b) { return _mm256_unpackhi_epi16(a, b); }
+				static I PackusEpi16(I a, I b) { return _mm256_packus_epi16(a, b); }
+				static I PacksEpi32(I a, I b) { return _mm256_packs_epi32(a, b); }
+
+				static I CmpeqEpi16(I a, I b) { return _mm256_cmpeq_epi16(a, b); }
+				static I CmpgtEpi32(I a, I b) { return _mm256_cmpgt_epi32(a, b); }
+				static I SignEpi32(I a) { return _mm256_srai_epi32(a, 31); }
+
+				static F Set1Ps(float v) { return _mm256_set1_ps(v); }
+				static F AddPs(F a, F b) { return _mm256_add_ps(a, b); }
+				static F SubPs(F a, F b) { return _mm256_sub_ps(a, b); }
+				static F MulPs(F a, F b) { return _mm256_mul_ps(a, b); }
+				static F AndNotPs(F a, F b) { return _mm256_andnot_ps(a, b); }
+
+				static D Set1Pd(double v) { return _mm256_set1_pd(v); }
+				static D AddPd(D a, D b) { return _mm256_add_pd(a, b); }
+				static D SubPd(D a, D b) { return _mm256_sub_pd(a, b); }
+				static D MulPd(D a, D b) { return _mm256_mul_pd(a, b); }
+				static D AndNotPd(D a, D b) { return _mm256_andnot_pd(a, b); }
+			};
+		}
+	}
+}
+
+#include "arithmetic_simd.h"
+
+namespace Imaging
+{
+	namespace Internal
+	{
+		void RegisterAvx2Kernels(ArithmeticKernels &kernels)
+		{
+			RegisterSimdKernels<Avx2>(kernels);
+		}
+	}
+}
+
+#if defined(__GNUC__)
+#pragma GCC pop_options
+#endif
+#else
+namespace Imaging
+{
+	namespace Internal
+	{
+		void RegisterAvx2Kernels(ArithmeticKernels &kernels)
+		{
+			(void)kernels;
+		}
+	}
+}
+#endif
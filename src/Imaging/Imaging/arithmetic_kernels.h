@@ -0,0 +1,356 @@
+#if !defined(ARITHMETIC_KERNELS_H)
+#define ARITHMETIC_KERNELS_H
+
+/*
+Internal header of arithmetic.cpp, arithmetic_sse2.cpp, and arithmetic_avx2.cpp.
+Declares the kernel table and defines the scalar reference operations.
+*/
+
+#include <cstddef>
+#include <cmath>
+#include <limits>
+#include <type_traits>
+
+#include "utilities/SafeInt.hpp"
+#include "image.h"
+
+namespace Imaging
+{
+	namespace Internal
+	{
+		////////////////////////////////////////////////////////////////////////////////////
+		// Kernel table.
+
+		enum struct ArithmeticOp
+		{
+			ADD,
+			SUBTRACT,
+			MULTIPLY,
+			ABSDIFF
+		};
+
+		const std::size_t NUM_ARITHMETIC_OPS = 4;
+		const std::size_t NUM_OVERFLOW_MODES = 2;
+		const std::size_t NUM_DATA_TYPES = 12;
+
+		/* Processes n elements of a line; c[i] = a[i] op b[i].
+		Pointers do not need to be aligned. c may be identical to a or b. */
+		typedef void(*ArithmeticLineFunc)(const void *a, const void *b, void *c,
+			std::size_t n);
+
+		// [ArithmeticOp][OverflowMode][DataType]
+		struct ArithmeticKernels
+		{
+			ArithmeticLineFunc funcs[NUM_ARITHMETIC_OPS][NUM_OVERFLOW_MODES][NUM_DATA_TYPES];
+		};
+
+		// Each of them overwrites the entries it supports.
+		void RegisterScalarKernels(ArithmeticKernels &kernels);
+		void RegisterSse2Kernels(ArithmeticKernels &kernels);
+		void RegisterAvx2Kernels(ArithmeticKernels &kernels);
+
+		// Kernel table.
+		////////////////////////////////////////////////////////////////////////////////////
+
+		/* Internal linkage.
+		The SSE2 and AVX2 kernels are compiled with different instruction set options, and
+		they use these scalar operations for the remaining elements of each line.
+		If these function templates had external linkage, the linker could pick the AVX2
+		instantiation for all translation units, which would crash on CPUs without AVX2.
+		The anonymous namespace gives each translation unit its own copy. */
+		namespace
+		{
+			////////////////////////////////////////////////////////////////////////////////
+			// Scalar operations.
+
+			// Unsigned type with the same width as T, but at least as wide as unsigned int
+			// to avoid the promotion to (signed) int.
+			template <typename T>
+			struct WrapType
+			{
+				typedef typename std::conditional<(sizeof(T) < sizeof(unsigned int)),
+					unsigned int, typename std::make_unsigned<T>::type>::type type;
+			};
+
+			// Clamps a value of a wider type W into the range of T.
+			template <typename T, typename W>
+			inline T ClampTo(W w)
+			{
+				return w < static_cast<W>(std::numeric_limits<T>::min()) ?
+					std::numeric_limits<T>::min() :
+					(w > static_cast<W>(std::numeric_limits<T>::max()) ?
+					std::numeric_limits<T>::max() : static_cast<T>(w));
+			}
+
+			// Saturation value for an overflow whose sign is 'negative'.
+			template <typename T>
+			inline T Limit(bool negative)
+			{
+				return negative ? std::numeric_limits<T>::min() : std::numeric_limits<T>::max();
+			}
+
+			// Wider type for exact computation; only for integral types narrower than 64 bits.
+			template <typename T>
+			struct WideType
+			{
+				typedef typename std::conditional<std::is_signed<T>::value, long long,
+					unsigned long long>::type type;
+			};
+
+			////////////////////////////////////////////////////////////////////////////////
+			// Add
+
+			template <typename T>
+			inline std::enable_if_t<std::is_integral<T>::value && (sizeof(T) < 8), T> AddSat(
+				T a, T b)
+			{
+				typedef typename WideType<T>::type W;
+				return ClampTo<T>(static_cast<W>(a) + static_cast<W>(b));
+			}
+
+			// 64-bit; the sign of the result differs from both sources if overflowed.
+			template <typename T>
+			inline std::enable_if_t<std::is_integral<T>::value && (sizeof(T) == 8), T> AddSat(
+				T a, T b)
+			{
+				typedef typename WrapType<T>::type U;
+				T c = static_cast<T>(static_cast<U>(a) + static_cast<U>(b));
+				if (std::is_signed<T>::value)
+					return ((a ^ c) & (b ^ c)) < 0 ? Limit<T>(a < 0) : c;
+				else
+					return c < a ? std::numeric_limits<T>::max() : c;
+			}
+
+			template <typename T>
+			inline std::enable_if_t<std::is_integral<T>::value, T> AddWrap(T a, T b)
+			{
+				typedef typename WrapType<T>::type U;
+				return static_cast<T>(static_cast<U>(a) + static_cast<U>(b));
+			}
+
+			// Add
+			////////////////////////////////////////////////////////////////////////////////
+
+			////////////////////////////////////////////////////////////////////////////////
+			// Subtract
+
+			template <typename T>
+			inline std::enable_if_t<std::is_integral<T>::value && (sizeof(T) < 8), T> SubSat(
+				T a, T b)
+			{
+				// Unsigned types also use a signed wide type to detect negative results.
+				return ClampTo<T>(static_cast<long long>(a) - static_cast<long long>(b));
+			}
+
+			template <typename T>
+			inline std::enable_if_t<std::is_integral<T>::value && (sizeof(T) == 8), T> SubSat(
+				T a, T b)
+			{
+				typedef typename WrapType<T>::type U;
+				T c = static_cast<T>(static_cast<U>(a) - static_cast<U>(b));
+				if (std::is_signed<T>::value)
+					return ((a ^ b) & (a ^ c)) < 0 ? Limit<T>(a < 0) : c;
+				else
+					return a < b ? 0 : c;
+			}
+
+			template <typename T>
+			inline std::enable_if_t<std::is_integral<T>::value, T> SubWrap(T a, T b)
+			{
+				typedef typename WrapType<T>::type U;
+				return static_cast<T>(static_cast<U>(a) - static_cast<U>(b));
+			}
+
+			// Subtract
+			////////////////////////////////////////////////////////////////////////////////
+
+			////////////////////////////////////////////////////////////////////////////////
+			// Multiply
+
+			// The product of two 32-bit values always fits in 64 bits.
+			template <typename T>
+			inline std::enable_if_t<std::is_integral<T>::value && (sizeof(T) < 8), T> MulSat(
+				T a, T b)
+			{
+				typedef typename WideType<T>::type W;
+				return ClampTo<T>(static_cast<W>(a) * static_cast<W>(b));
+			}
+
+			// 64-bit; employs SafeInt to detect overflow as Utilities::Multiply() does.
+			template <typename T>
+			inline std::enable_if_t<std::is_integral<T>::value && (sizeof(T) == 8), T> MulSat(
+				T a, T b)
+			{
+				T c;
+				if (::SafeMultiply(a, b, c))
+					return c;
+				else
+					return Limit<T>((a < 0) != (b < 0));
+			}
+
+			template <typename T>
+			inline std::enable_if_t<std::is_integral<T>::value, T> MulWrap(T a, T b)
+			{
+				typedef typename WrapType<T>::type U;
+				return static_cast<T>(static_cast<U>(a) * static_cast<U>(b));
+			}
+
+			// Multiply
+			////////////////////////////////////////////////////////////////////////////////
+
+			////////////////////////////////////////////////////////////////////////////////
+			// AbsDiff
+
+			// Exact |a - b| as an unsigned value.
+			template <typename T>
+			inline typename WrapType<T>::type AbsDiffUnsigned(T a, T b)
+			{
+				typedef typename WrapType<T>::type U;
+				return a > b ? static_cast<U>(static_cast<U>(a) - static_cast<U>(b)) :
+					static_cast<U>(static_cast<U>(b) - static_cast<U>(a));
+			}
+
+			template <typename T>
+			inline std::enable_if_t<std::is_integral<T>::value, T> AbsDiffSat(T a, T b)
+			{
+				typedef typename WrapType<T>::type U;
+				U d = AbsDiffUnsigned(a, b);
+				return d > static_cast<U>(std::numeric_limits<T>::max()) ?
+					std::numeric_limits<T>::max() : static_cast<T>(d);
+			}
+
+			template <typename T>
+			inline std::enable_if_t<std::is_integral<T>::value, T> AbsDiffWrap(T a, T b)
+			{
+				return static_cast<T>(AbsDiffUnsigned(a, b));
+			}
+
+			// AbsDiff
+			////////////////////////////////////////////////////////////////////////////////
+
+			////////////////////////////////////////////////////////////////////////////////
+			// Floating point types; no saturation.
+
+			template <typename T>
+			inline std::enable_if_t<std::is_floating_point<T>::value, T> AddSat(T a, T b)
+			{
+				return a + b;
+			}
+
+			template <typename T>
+			inline std::enable_if_t<std::is_floating_point<T>::value, T> SubSat(T a, T b)
+			{
+				return a - b;
+			}
+
+			template <typename T>
+			inline std::enable_if_t<std::is_floating_point<T>::value, T> MulSat(T a, T b)
+			{
+				return a * b;
+			}
+
+			template <typename T>
+			inline std::enable_if_t<std::is_floating_point<T>::value, T> AbsDiffSat(T a, T b)
+			{
+				return std::abs(a - b);
+			}
+
+			template <typename T>
+			inline std::enable_if_t<std::is_floating_point<T>::value, T> AddWrap(T a, T b)
+			{
+				return a + b;
+			}
+
+			template <typename T>
+			inline std::enable_if_t<std::is_floating_point<T>::value, T> SubWrap(T a, T b)
+			{
+				return a - b;
+			}
+
+			template <typename T>
+			inline std::enable_if_t<std::is_floating_point<T>::value, T> MulWrap(T a, T b)
+			{
+				return a * b;
+			}
+
+			template <typename T>
+			inline std::enable_if_t<std::is_floating_point<T>::value, T> AbsDiffWrap(T a, T b)
+			{
+				return std::abs(a - b);
+			}
+
+			// Floating point types; no saturation.
+			////////////////////////////////////////////////////////////////////////////////
+
+			// Function objects of the scalar operations; used as template arguments.
+#define IMAGING_SCALAR_OP(Name) \
+			struct Name##Op \
+			{ \
+				template <typename T> \
+				static T Apply(T a, T b) { return Name(a, b); } \
+			};
+
+			IMAGING_SCALAR_OP(AddSat)
+			IMAGING_SCALAR_OP(AddWrap)
+			IMAGING_SCALAR_OP(SubSat)
+			IMAGING_SCALAR_OP(SubWrap)
+			IMAGING_SCALAR_OP(MulSat)
+			IMAGING_SCALAR_OP(MulWrap)
+			IMAGING_SCALAR_OP(AbsDiffSat)
+			IMAGING_SCALAR_OP(AbsDiffWrap)
+#undef IMAGING_SCALAR_OP
+
+			// Scalar line kernel; also used for the remaining elements of SIMD kernels.
+			template <typename T, typename Op>
+			void ScalarLine(const T *a, const T *b, T *c, std::size_t n)
+			{
+				for (std::size_t i = 0; i != n; ++i)
+					c[i] = Op::template Apply<T>(a[i], b[i]);
+			}
+
+			template <typename T, typename Op>
+			void ScalarLineFunc(const void *a, const void *b, void *c, std::size_t n)
+			{
+				ScalarLine<T, Op>(static_cast<const T *>(a), static_cast<const T *>(b),
+					static_cast<T *>(c), n);
+			}
+
+			// Scalar operations.
+			////////////////////////////////////////////////////////////////////////////////
+
+			////////////////////////////////////////////////////////////////////////////////
+			// Registration helpers.
+
+			inline std::size_t ToIndex(ArithmeticOp op)
+			{
+				return static_cast<std::size_t>(op);
+			}
+
+			inline std::size_t ToIndex(bool saturate)
+			{
+				return saturate ? 0 : 1;
+			}
+
+			inline std::size_t ToIndex(DataType ty)
+			{
+				return static_cast<std::size_t>(ty);
+			}
+
+			inline void SetKernel(ArithmeticKernels &kernels, ArithmeticOp op, bool saturate,
+				DataType ty, ArithmeticLineFunc func)
+			{
+				kernels.funcs[ToIndex(op)][ToIndex(saturate)][ToIndex(ty)] = func;
+
+				// char is either signed or unsigned depending on compilers.
+				if (ty == GetDataType<std::conditional<std::is_signed<char>::value,
+					signed char, unsigned char>::type>())
+					kernels.funcs[ToIndex(op)][ToIndex(saturate)][ToIndex(DataType::CHAR)] =
+					func;
+			}
+
+			// Registration helpers.
+			////////////////////////////////////////////////////////////////////////////////
+		}
+	}
+}
+#endif
@@ -0,0 +1,702 @@
+#if !defined(ARITHMETIC_SIMD_H)
+#define ARITHMETIC_SIMD_H
+
+/*
+Internal header of arithmetic_sse2.cpp and arithmetic_avx2.cpp.
+Defines the SIMD kernels as class templates of an instruction set 'Isa', which wraps the
+intrinsics of one vector width, e.g. Sse2 for __m128i and Avx2 for __m256i.
+
+Each translation unit defines its own Isa and includes this header, so a kernel is written
+once and compiled once per instruction set.
+Everything is in an anonymous namespace for the same reason as arithmetic_kernels.h.
+*/
+
+#include "arithmetic_kernels.h"
+
+namespace Imaging
+{
+	namespace Internal
+	{
+		namespace
+		{
+			////////////////////////////////////////////////////////////////////////////////
+			// Load and store.
+
+			template <typename Isa, typename T>
+			struct IntVector
+			{
+				typedef Isa InstructionSet;
+				typedef T ValueType;
+				typedef typename Isa::I Vector;
+				static const std::size_t Step = Isa::Bytes / sizeof(T);
+				static Vector Load(const T *src) { return Isa::Load(src); }
+				static void Store(T *dst, Vector v) { Isa::Store(dst, v); }
+			};
+
+			template <typename Isa>
+			struct FloatVector
+			{
+				typedef Isa InstructionSet;
+				typedef float ValueType;
+				typedef typename Isa::F Vector;
+				static const std::size_t Step = Isa::Bytes / sizeof(float);
+				static Vector Load(const float *src) { return Isa::LoadPs(src); }
+				static void Store(float *dst, Vector v) { Isa::StorePs(dst, v); }
+			};
+
+			template <typename Isa>
+			struct DoubleVector
+			{
+				typedef Isa InstructionSet;
+				typedef double ValueType;
+				typedef typename Isa::D Vector;
+				static const std::size_t Step = Isa::Bytes / sizeof(double);
+				static Vector Load(const double *src) { return Isa::LoadPd(src); }
+				static void Store(double *dst, Vector v) { Isa::StorePd(dst, v); }
+			};
+
+			// Load and store.
+			////////////////////////////////////////////////////////////////////////////////
+
+			////////////////////////////////////////////////////////////////////////////////
+			// Common idioms.
+
+			// min(v, c) for unsigned 8-bit values; v - max(v - c, 0).
+			template <typename Isa>
+			typename Isa::I MinEpu8(typename Isa::I v, typename Isa::I c)
+			{
+				return Isa::SubEpi8(v, Isa::SubsEpu8(v, c));
+			}
+
+			// min(v, c) for unsigned 16-bit values; v - max(v - c, 0).
+			template <typename Isa>
+			typename Isa::I MinEpu16(typename Isa::I v, typename Isa::I c)
+			{
+				return Isa::SubEpi16(v, Isa::SubsEpu16(v, c));
+			}
+
+			// mask ? a : b for integral vectors.
+			template <typename Isa>
+			typename Isa::I Select(typename Isa::I mask, typename Isa::I a,
+				typename Isa::I b)
+			{
+				return Isa::Or(Isa::And(mask, a), Isa::AndNot(mask, b));
+			}
+
+			// |a - b| of 32-bit values as unsigned values; gt is (b > a) for all bits.
+			template <typename Isa>
+			typename Isa::I AbsDiffEpi32(typename Isa::I a, typename Isa::I b,
+				typename Isa::I gt)
+			{
+				// Negates (a - b) if b > a; (x ^ -1) - (-1) = -x.
+				return Isa::SubEpi32(Isa::Xor(Isa::SubEpi32(a, b), gt), gt);
+			}
+
+			// Common idioms.
+			////////////////////////////////////////////////////////////////////////////////
+
+			////////////////////////////////////////////////////////////////////////////////
+			// unsigned char
+
+			template <typename Isa>
+			struct AddSatU8 : IntVector<Isa, unsigned char>
+			{
+				typedef AddSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return Isa::AddsEpu8(a, b);
+				}
+			};
+
+			template <typename Isa>
+			struct SubSatU8 : IntVector<Isa, unsigned char>
+			{
+				typedef SubSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return Isa::SubsEpu8(a, b);
+				}
+			};
+
+			// Exact for unsigned types, so it is used for both modes.
+			template <typename Isa>
+			struct AbsDiffU8 : IntVector<Isa, unsigned char>
+			{
+				typedef AbsDiffSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return Isa::Or(Isa::SubsEpu8(a, b), Isa::SubsEpu8(b, a));
+				}
+			};
+
+			// Multiplies as 16-bit values, and then packs them back to 8-bit values.
+			// The product of two 8-bit values fits in unsigned 16 bits.
+			template <typename Isa>
+			struct MulSatU8 : IntVector<Isa, unsigned char>
+			{
+				typedef MulSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					auto zero = Isa::Zero();
+					auto max = Isa::Set1Epi16(0xFF);
+					auto lo = Isa::MulloEpi16(Isa::UnpackloEpi8(a, zero),
+						Isa::UnpackloEpi8(b, zero));
+					auto hi = Isa::MulloEpi16(Isa::UnpackhiEpi8(a, zero),
+						Isa::UnpackhiEpi8(b, zero));
+					return Isa::PackusEpi16(MinEpu16<Isa>(lo, max), MinEpu16<Isa>(hi, max));
+				}
+			};
+
+			template <typename Isa>
+			struct MulWrapU8 : IntVector<Isa, unsigned char>
+			{
+				typedef MulWrapOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					auto zero = Isa::Zero();
+					auto mask = Isa::Set1Epi16(0xFF);
+					auto lo = Isa::MulloEpi16(Isa::UnpackloEpi8(a, zero),
+						Isa::UnpackloEpi8(b, zero));
+					auto hi = Isa::MulloEpi16(Isa::UnpackhiEpi8(a, zero),
+						Isa::UnpackhiEpi8(b, zero));
+					return Isa::PackusEpi16(Isa::And(lo, mask), Isa::And(hi, mask));
+				}
+			};
+
+			// unsigned char
+			////////////////////////////////////////////////////////////////////////////////
+
+			////////////////////////////////////////////////////////////////////////////////
+			// signed char
+
+			template <typename Isa>
+			struct AddSatS8 : IntVector<Isa, signed char>
+			{
+				typedef AddSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return Isa::AddsEpi8(a, b);
+				}
+			};
+
+			template <typename Isa>
+			struct SubSatS8 : IntVector<Isa, signed char>
+			{
+				typedef SubSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return Isa::SubsEpi8(a, b);
+				}
+			};
+
+			// Flipping the sign bit maps signed values to unsigned values in the same order,
+			// so the unsigned absolute difference can be used.
+			template <typename Isa>
+			typename Isa::I AbsDiffS8Unsigned(typename Isa::I a, typename Isa::I b)
+			{
+				auto bias = Isa::Set1Epi8(static_cast<char>(0x80));
+				return AbsDiffU8<Isa>::Apply(Isa::Xor(a, bias), Isa::Xor(b, bias));
+			}
+
+			template <typename Isa>
+			struct AbsDiffSatS8 : IntVector<Isa, signed char>
+			{
+				typedef AbsDiffSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return MinEpu8<Isa>(AbsDiffS8Unsigned<Isa>(a, b), Isa::Set1Epi8(0x7F));
+				}
+			};
+
+			template <typename Isa>
+			struct AbsDiffWrapS8 : IntVector<Isa, signed char>
+			{
+				typedef AbsDiffWrapOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return AbsDiffS8Unsigned<Isa>(a, b);
+				}
+			};
+
+			// signed char
+			////////////////////////////////////////////////////////////////////////////////
+
+			////////////////////////////////////////////////////////////////////////////////
+			// unsigned short
+
+			template <typename Isa>
+			struct AddSatU16 : IntVector<Isa, unsigned short>
+			{
+				typedef AddSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return Isa::AddsEpu16(a, b);
+				}
+			};
+
+			template <typename Isa>
+			struct SubSatU16 : IntVector<Isa, unsigned short>
+			{
+				typedef SubSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return Isa::SubsEpu16(a, b);
+				}
+			};
+
+			template <typename Isa>
+			struct AbsDiffU16 : IntVector<Isa, unsigned short>
+			{
+				typedef AbsDiffSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return Isa::Or(Isa::SubsEpu16(a, b), Isa::SubsEpu16(b, a));
+				}
+			};
+
+			// Saturates to 0xFFFF if the high 16 bits of the product is not zero.
+			template <typename Isa>
+			struct MulSatU16 : IntVector<Isa, unsigned short>
+			{
+				typedef MulSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					auto lo = Isa::MulloEpi16(a, b);
+					auto hi = Isa::MulhiEpu16(a, b);
+					auto overflow = Isa::AndNot(Isa::CmpeqEpi16(hi, Isa::Zero()),
+						Isa::Set1Epi16(-1));
+					return Isa::Or(lo, overflow);
+				}
+			};
+
+			template <typename Isa>
+			struct MulWrapU16 : IntVector<Isa, unsigned short>
+			{
+				typedef MulWrapOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return Isa::MulloEpi16(a, b);
+				}
+			};
+
+			// unsigned short
+			////////////////////////////////////////////////////////////////////////////////
+
+			////////////////////////////////////////////////////////////////////////////////
+			// short
+
+			template <typename Isa>
+			struct AddSatS16 : IntVector<Isa, short>
+			{
+				typedef AddSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return Isa::AddsEpi16(a, b);
+				}
+			};
+
+			template <typename Isa>
+			struct SubSatS16 : IntVector<Isa, short>
+			{
+				typedef SubSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return Isa::SubsEpi16(a, b);
+				}
+			};
+
+			template <typename Isa>
+			typename Isa::I AbsDiffS16Unsigned(typename Isa::I a, typename Isa::I b)
+			{
+				auto bias = Isa::Set1Epi16(static_cast<short>(0x8000));
+				return AbsDiffU16<Isa>::Apply(Isa::Xor(a, bias), Isa::Xor(b, bias));
+			}
+
+			template <typename Isa>
+			struct AbsDiffSatS16 : IntVector<Isa, short>
+			{
+				typedef AbsDiffSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return MinEpu16<Isa>(AbsDiffS16Unsigned<Isa>(a, b), Isa::Set1Epi16(0x7FFF));
+				}
+			};
+
+			template <typename Isa>
+			struct AbsDiffWrapS16 : IntVector<Isa, short>
+			{
+				typedef AbsDiffWrapOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return AbsDiffS16Unsigned<Isa>(a, b);
+				}
+			};
+
+			// Interleaves the low and high 16 bits into 32-bit products, and then packs them
+			// back with signed saturation.
+			template <typename Isa>
+			struct MulSatS16 : IntVector<Isa, short>
+			{
+				typedef MulSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					auto lo = Isa::MulloEpi16(a, b);
+					auto hi = Isa::MulhiEpi16(a, b);
+					return Isa::PacksEpi32(Isa::UnpackloEpi16(lo, hi),
+						Isa::UnpackhiEpi16(lo, hi));
+				}
+			};
+
+			template <typename Isa>
+			struct MulWrapS16 : IntVector<Isa, short>
+			{
+				typedef MulWrapOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return Isa::MulloEpi16(a, b);
+				}
+			};
+
+			// short
+			////////////////////////////////////////////////////////////////////////////////
+
+			////////////////////////////////////////////////////////////////////////////////
+			// unsigned int
+
+			// Unsigned comparison a > b; flips the sign bits for the signed comparison.
+			template <typename Isa>
+			typename Isa::I CmpgtEpu32(typename Isa::I a, typename Isa::I b)
+			{
+				auto bias = Isa::Set1Epi32(static_cast<int>(0x80000000));
+				return Isa::CmpgtEpi32(Isa::Xor(a, bias), Isa::Xor(b, bias));
+			}
+
+			// Overflowed if the sum is less than a source value.
+			template <typename Isa>
+			struct AddSatU32 : IntVector<Isa, unsigned int>
+			{
+				typedef AddSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					auto c = Isa::AddEpi32(a, b);
+					return Isa::Or(c, CmpgtEpu32<Isa>(a, c));
+				}
+			};
+
+			template <typename Isa>
+			struct SubSatU32 : IntVector<Isa, unsigned int>
+			{
+				typedef SubSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return Isa::AndNot(CmpgtEpu32<Isa>(b, a), Isa::SubEpi32(a, b));
+				}
+			};
+
+			template <typename Isa>
+			struct AbsDiffU32 : IntVector<Isa, unsigned int>
+			{
+				typedef AbsDiffSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return AbsDiffEpi32<Isa>(a, b, CmpgtEpu32<Isa>(b, a));
+				}
+			};
+
+			// unsigned int
+			////////////////////////////////////////////////////////////////////////////////
+
+			////////////////////////////////////////////////////////////////////////////////
+			// int
+
+			// INT_MIN if v is negative, INT_MAX otherwise.
+			template <typename Isa>
+			typename Isa::I LimitEpi32(typename Isa::I v)
+			{
+				return Isa::Xor(Isa::SignEpi32(v), Isa::Set1Epi32(0x7FFFFFFF));
+			}
+
+			// Overflowed if the sign of the sum differs from both sources.
+			template <typename Isa>
+			struct AddSatS32 : IntVector<Isa, int>
+			{
+				typedef AddSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					auto c = Isa::AddEpi32(a, b);
+					auto overflow = Isa::SignEpi32(Isa::And(Isa::Xor(a, c), Isa::Xor(b, c)));
+					return Select<Isa>(overflow, LimitEpi32<Isa>(a), c);
+				}
+			};
+
+			// Overflowed if the signs of sources differ and the sign of the result differs
+			// from the first source.
+			template <typename Isa>
+			struct SubSatS32 : IntVector<Isa, int>
+			{
+				typedef SubSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					auto c = Isa::SubEpi32(a, b);
+					auto overflow = Isa::SignEpi32(Isa::And(Isa::Xor(a, b), Isa::Xor(a, c)));
+					return Select<Isa>(overflow, LimitEpi32<Isa>(a), c);
+				}
+			};
+
+			// The unsigned difference is larger than INT_MAX if its sign bit is set.
+			template <typename Isa>
+			struct AbsDiffSatS32 : IntVector<Isa, int>
+			{
+				typedef AbsDiffSatOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					auto d = AbsDiffEpi32<Isa>(a, b, Isa::CmpgtEpi32(b, a));
+					return Select<Isa>(Isa::SignEpi32(d), Isa::Set1Epi32(0x7FFFFFFF), d);
+				}
+			};
+
+			template <typename Isa>
+			struct AbsDiffWrapS32 : IntVector<Isa, int>
+			{
+				typedef AbsDiffWrapOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return AbsDiffEpi32<Isa>(a, b, Isa::CmpgtEpi32(b, a));
+				}
+			};
+
+			// int
+			////////////////////////////////////////////////////////////////////////////////
+
+			////////////////////////////////////////////////////////////////////////////////
+			// Wrapping addition and subtraction; identical bits for signed and unsigned.
+
+			template <typename Isa, typename T>
+			struct AddWrapInt : IntVector<Isa, T>
+			{
+				typedef AddWrapOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return sizeof(T) == 1 ? Isa::AddEpi8(a, b) :
+						(sizeof(T) == 2 ? Isa::AddEpi16(a, b) :
+						(sizeof(T) == 4 ? Isa::AddEpi32(a, b) : Isa::AddEpi64(a, b)));
+				}
+			};
+
+			template <typename Isa, typename T>
+			struct SubWrapInt : IntVector<Isa, T>
+			{
+				typedef SubWrapOp ScalarOp;
+				static typename Isa::I Apply(typename Isa::I a, typename Isa::I b)
+				{
+					return sizeof(T) == 1 ? Isa::SubEpi8(a, b) :
+						(sizeof(T) == 2 ? Isa::SubEpi16(a, b) :
+						(sizeof(T) == 4 ? Isa::SubEpi32(a, b) : Isa::SubEpi64(a, b)));
+				}
+			};
+
+			// Wrapping addition and subtraction; identical bits for signed and unsigned.
+			////////////////////////////////////////////////////////////////////////////////
+
+			////////////////////////////////////////////////////////////////////////////////
+			// float and double; identical for both modes.
+
+			template <typename Isa>
+			struct AddF32 : FloatVector<Isa>
+			{
+				typedef AddSatOp ScalarOp;
+				static typename Isa::F Apply(typename Isa::F a, typename Isa::F b)
+				{
+					return Isa::AddPs(a, b);
+				}
+			};
+
+			template <typename Isa>
+			struct SubF32 : FloatVector<Isa>
+			{
+				typedef SubSatOp ScalarOp;
+				static typename Isa::F Apply(typename Isa::F a, typename Isa::F b)
+				{
+					return Isa::SubPs(a, b);
+				}
+			};
+
+			template <typename Isa>
+			struct MulF32 : FloatVector<Isa>
+			{
+				typedef MulSatOp ScalarOp;
+				static typename Isa::F Apply(typename Isa::F a, typename Isa::F b)
+				{
+					return Isa::MulPs(a, b);
+				}
+			};
+
+			// Clears the sign bit.
+			template <typename Isa>
+			struct AbsDiffF32 : FloatVector<Isa>
+			{
+				typedef AbsDiffSatOp ScalarOp;
+				static typename Isa::F Apply(typename Isa::F a, typename Isa::F b)
+				{
+					return Isa::AndNotPs(Isa::Set1Ps(-0.0f), Isa::SubPs(a, b));
+				}
+			};
+
+			template <typename Isa>
+			struct AddF64 : DoubleVector<Isa>
+			{
+				typedef AddSatOp ScalarOp;
+				static typename Isa::D Apply(typename Isa::D a, typename Isa::D b)
+				{
+					return Isa::AddPd(a, b);
+				}
+			};
+
+			template <typename Isa>
+			struct SubF64 : DoubleVector<Isa>
+			{
+				typedef SubSatOp ScalarOp;
+				static typename Isa::D Apply(typename Isa::D a, typename Isa::D b)
+				{
+					return Isa::SubPd(a, b);
+				}
+			};
+
+			template <typename Isa>
+			struct MulF64 : DoubleVector<Isa>
+			{
+				typedef MulSatOp ScalarOp;
+				static typename Isa::D Apply(typename Isa::D a, typename Isa::D b)
+				{
+					return Isa::MulPd(a, b);
+				}
+			};
+
+			template <typename Isa>
+			struct AbsDiffF64 : DoubleVector<Isa>
+			{
+				typedef AbsDiffSatOp ScalarOp;
+				static typename Isa::D Apply(typename Isa::D a, typename Isa::D b)
+				{
+					return Isa::AndNotPd(Isa::Set1Pd(-0.0), Isa::SubPd(a, b));
+				}
+			};
+
+			// float and double; identical for both modes.
+			////////////////////////////////////////////////////////////////////////////////
+
+			////////////////////////////////////////////////////////////////////////////////
+			// Line kernel and registration.
+
+			/* Processes full vectors first, and then the remaining elements one by one.
+			ZeroUpper() avoids the penalty of switching from 256-bit AVX code to legacy SSE
+			code, because the rest of the program is not compiled with AVX enabled. */
+			template <typename V>
+			void SimdLineFunc(const void *a, const void *b, void *c, std::size_t n)
+			{
+				typedef typename V::ValueType T;
+				auto pa = static_cast<const T *>(a);
+				auto pb = static_cast<const T *>(b);
+				auto pc = static_cast<T *>(c);
+
+				std::size_t i = 0;
+				for (; i + V::Step <= n; i += V::Step)
+					V::Store(pc + i, V::Apply(V::Load(pa + i), V::Load(pb + i)));
+				V::InstructionSet::ZeroUpper();
+				ScalarLine<T, typename V::ScalarOp>(pa + i, pb + i, pc + i, n - i);
+			}
+
+			template <typename V>
+			void SetSimdKernel(ArithmeticKernels &kernels, ArithmeticOp op, bool saturate)
+			{
+				SetKernel(kernels, op, saturate, GetDataType<typename V::ValueType>(),
+					SimdLineFunc<V>);
+			}
+
+			// Registers the kernels for both modes.
+			template <typename V>
+			void SetSimdKernel(ArithmeticKernels &kernels, ArithmeticOp op)
+			{
+				SetSimdKernel<V>(kernels, op, true);
+				SetSimdKernel<V>(kernels, op, false);
+			}
+
+			template <typename Isa, typename T>
+			void RegisterWrapKernels(ArithmeticKernels &kernels)
+			{
+				SetSimdKernel<AddWrapInt<Isa, T>>(kernels, ArithmeticOp::ADD, false);
+				SetSimdKernel<SubWrapInt<Isa, T>>(kernels, ArithmeticOp::SUBTRACT, false);
+			}
+
+			// Combinations without an entry here keep the scalar kernels.
+			template <typename Isa>
+			void RegisterSimdKernels(ArithmeticKernels &kernels)
+			{
+				// Wrapping addition and subtraction of all integral types.
+				RegisterWrapKernels<Isa, unsigned char>(kernels);
+				RegisterWrapKernels<Isa, signed char>(kernels);
+				RegisterWrapKernels<Isa, unsigned short>(kernels);
+				RegisterWrapKernels<Isa, short>(kernels);
+				RegisterWrapKernels<Isa, unsigned int>(kernels);
+				RegisterWrapKernels<Isa, int>(kernels);
+				RegisterWrapKernels<Isa, unsigned long long>(kernels);
+				RegisterWrapKernels<Isa, long long>(kernels);
+
+				// unsigned char
+				SetSimdKernel<AddSatU8<Isa>>(kernels, ArithmeticOp::ADD, true);
+				SetSimdKernel<SubSatU8<Isa>>(kernels, ArithmeticOp::SUBTRACT, true);
+				SetSimdKernel<MulSatU8<Isa>>(kernels, ArithmeticOp::MULTIPLY, true);
+				SetSimdKernel<MulWrapU8<Isa>>(kernels, ArithmeticOp::MULTIPLY, false);
+				SetSimdKernel<AbsDiffU8<Isa>>(kernels, ArithmeticOp::ABSDIFF);
+
+				// signed char
+				SetSimdKernel<AddSatS8<Isa>>(kernels, ArithmeticOp::ADD, true);
+				SetSimdKernel<SubSatS8<Isa>>(kernels, ArithmeticOp::SUBTRACT, true);
+				SetSimdKernel<AbsDiffSatS8<Isa>>(kernels, ArithmeticOp::ABSDIFF, true);
+				SetSimdKernel<AbsDiffWrapS8<Isa>>(kernels, ArithmeticOp::ABSDIFF, false);
+
+				// unsigned short
+				SetSimdKernel<AddSatU16<Isa>>(kernels, ArithmeticOp::ADD, true);
+				SetSimdKernel<SubSatU16<Isa>>(kernels, ArithmeticOp::SUBTRACT, true);
+				SetSimdKernel<MulSatU16<Isa>>(kernels, ArithmeticOp::MULTIPLY, true);
+				SetSimdKernel<MulWrapU16<Isa>>(kernels, ArithmeticOp::MULTIPLY, false);
+				SetSimdKernel<AbsDiffU16<Isa>>(kernels, ArithmeticOp::ABSDIFF);
+
+				// short
+				SetSimdKernel<AddSatS16<Isa>>(kernels, ArithmeticOp::ADD, true);
+				SetSimdKernel<SubSatS16<Isa>>(kernels, ArithmeticOp::SUBTRACT, true);
+				SetSimdKernel<MulSatS16<Isa>>(kernels, ArithmeticOp::MULTIPLY, true);
+				SetSimdKernel<MulWrapS16<Isa>>(kernels, ArithmeticOp::MULTIPLY, false);
+				SetSimdKernel<AbsDiffSatS16<Isa>>(kernels, ArithmeticOp::ABSDIFF, true);
+				SetSimdKernel<AbsDiffWrapS16<Isa>>(kernels, ArithmeticOp::ABSDIFF, false);
+
+				// unsigned int
+				SetSimdKernel<AddSatU32<Isa>>(kernels, ArithmeticOp::ADD, true);
+				SetSimdKernel<SubSatU32<Isa>>(kernels, ArithmeticOp::SUBTRACT, true);
+				SetSimdKernel<AbsDiffU32<Isa>>(kernels, ArithmeticOp::ABSDIFF);
+
+				// int
+				SetSimdKernel<AddSatS32<Isa>>(kernels, ArithmeticOp::ADD, true);
+				SetSimdKernel<SubSatS32<Isa>>(kernels, ArithmeticOp::SUBTRACT, true);
+				SetSimdKernel<AbsDiffSatS32<Isa>>(kernels, ArithmeticOp::ABSDIFF, true);
+				SetSimdKernel<AbsDiffWrapS32<Isa>>(kernels, ArithmeticOp::ABSDIFF, false);
+
+				// float
+				SetSimdKernel<AddF32<Isa>>(kernels, ArithmeticOp::ADD);
+				SetSimdKernel<SubF32<Isa>>(kernels, ArithmeticOp::SUBTRACT);
+				SetSimdKernel<MulF32<Isa>>(kernels, ArithmeticOp::MULTIPLY);
+				SetSimdKernel<AbsDiffF32<Isa>>(kernels, ArithmeticOp::ABSDIFF);
+
+				// double
+				SetSimdKernel<AddF64<Isa>>(kernels, ArithmeticOp::ADD);
+				SetSimdKernel<SubF64<Isa>>(kernels, ArithmeticOp::SUBTRACT);
+				SetSimdKernel<MulF64<Isa>>(kernels, ArithmeticOp::MULTIPLY);
+				SetSimdKernel<AbsDiffF64<Isa>>(kernels, ArithmeticOp::ABSDIFF);
+			}
+
+			// Line kernel and registration.
+			////////////////////////////////////////////////////////////////////////////////
+		}
+	}
+}
+#endif
@@ -0,0 +1,110 @@
+#include "arithmetic_kernels.h"
+
+/* SSE2 is a part of x64, and it is enabled by default for x86 since Visual Studio 2012.
+Other compilers define __SSE2__ if it is enabled. */
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define IMAGING_HAVE_SSE2
+#endif
+
+#if defined(IMAGING_HAVE_SSE2)
+#include <emmintrin.h>
+
+namespace Imaging
+{
+	namespace Internal
+	{
+		namespace
+		{
+			// Intrinsics of 128-bit vectors.
+			struct Sse2
+			{
+				typedef __m128i I;
+				typedef __m128 F;
+				typedef __m128d D;
+				static const std::size_t Bytes = 16;
+
+				static void ZeroUpper(void) {}
+
+				static I Load(const void *src) { return _mm_loadu_si128(static_cast<const I *>(src)); }
+				static void Store(void *dst, I v) { _mm_storeu_si128(static_cast<I *>(dst), v); }
+				static F LoadPs(const float *src) { return _mm_loadu_ps(src); }
+				static void StorePs(float *dst, F v) { _mm_storeu_ps(dst, v); }
+				static D LoadPd(const double *src) { return _mm_loadu_pd(src); }
+				static void StorePd(double *dst, D v) { _mm_storeu_pd(dst, v); }
+
+				static I Zero(void) { return _mm_setzero_si128(); }
+				static I Set1Epi8(char v) { return _mm_set1_epi8(v); }
+				static I Set1Epi16(short v) { return _mm_set1_epi16(v); }
+				static I Set1Epi32(int v) { return _mm_set1_epi32(v); }
+
+				static I And(I a, I b) { return _mm_and_si128(a, b); }
+				static I AndNot(I a, I b) { return _mm_andnot_si128(a, b); }
+				static I Or(I a, I b) { return _mm_or_si128(a, b); }
+				static I Xor(I a, I b) { return _mm_xor_si128(a, b); }
+
+				static I AddEpi8(I a, I b) { return _mm_add_epi8(a, b); }
+				static I AddEpi16(I a, I b) { return _mm_add_epi16(a, b); }
+				static I AddEpi32(I a, I b) { return _mm_add_epi32(a, b); }
+				static I AddEpi64(I a, I b) { return _mm_add_epi64(a, b); }
+				static I SubEpi8(I a, I b) { return _mm_sub_epi8(a, b); }
+				static I SubEpi16(I a, I b) { return _mm_sub_epi16(a, b); }
+				static I SubEpi32(I a, I b) { return _mm_sub_epi32(a, b); }
+				static I SubEpi64(I a, I b) { return _mm_sub_epi64(a, b); }
+
+				static I AddsEpi8(I a, I b) { return _mm_adds_epi8(a, b); }
+				static I AddsEpu8(I a, I b) { return _mm_adds_epu8(a, b); }
+				static I AddsEpi16(I a, I b) { return _mm_adds_epi16(a, b); }
+				static I AddsEpu16(I a, I b) { return _mm_adds_epu16(a, b); }
+				static I SubsEpi8(I a, I b) { return _mm_subs_epi8(a, b); }
+				static I SubsEpu8(I a, I b) { return _mm_subs_epu8(a, b); }
+				static I SubsEpi16(I a, I b) { return _mm_subs_epi16(a, b); }
+				static I SubsEpu16(I a, I b) { return _mm_subs_epu16(a, b); }
+
+				static I MulloEpi16(I a, I b) { return _mm_mullo_epi16(a, b); }
+				static I MulhiEpi16(I a, I b) { return _mm_mulhi_epi16(a, b); }
+				static I MulhiEpu16(I a, I b) { return _mm_mulhi_epu16(a, b); }
+
+				static I UnpackloEpi8(I a, I b) { return _mm_unpacklo_epi8(a, b); }
+				static I UnpackhiEpi8(I a, I b) { return _mm_unpackhi_epi8(a, b); }
+				static I UnpackloEpi16(I a, I b) { return _mm_unpacklo_epi16(a, b); }
+				static I UnpackhiEpi16(I a, I b) { return _mm_unpackhi_epi16(a, b); }
+				static I PackusEpi16(I a, I b) { return _mm_packus_epi16(a, b); }
+				static I PacksEpi32(I a, I b) { return _mm_packs_epi32(a, b); }
+
+				static I CmpeqEpi16(I a, I b) { return _mm_cmpeq_epi16(a, b); }
+				static I CmpgtEpi32(I a, I b) { return _mm_cmpgt_epi32(a, b); }
+				static I SignEpi32(I a) { return _mm_srai_epi32(a, 31); }
+
+				static F Set1Ps(float v) { return _mm_set1_ps(v); }
+				static F AddPs(F a, F b) { return _mm_add_ps(a, b); }
+				static F SubPs(F a, F b) { return _mm_sub_ps(a, b); }
+				static F MulPs(F a, F b) { return _mm_mul_ps(a, b); }
+				static F AndNotPs(F a, F b) { return _mm_andnot_ps(a, b); }
+
+				static D Set1Pd(double v) { return _mm_set1_pd(v); }
+				static D AddPd(D a, D b) { return _mm_add_pd(a, b); }
+				static D SubPd(D a, D b) { return _mm_sub_pd(a, b); }
+				static D MulPd(D a, D b) { return _mm_mul_pd(a, b); }
+				static D AndNotPd(D a, D b) { return _mm_andnot_pd(a, b); }
+			};
+		}
+	}
+}
+
+#include "arithmetic_simd.h"
+#endif
+
+namespace Imaging
+{
+	namespace Internal
+	{
+		void RegisterSse2Kernels(ArithmeticKernels &kernels)
+		{
+#if defined(IMAGING_HAVE_SSE2)
+			RegisterSimdKernels<Sse2>(kernels);
+#else
+			(void)kernels;
+#endif
+		}
+	}
+}
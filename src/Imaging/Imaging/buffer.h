@@ -1,27 +1,200 @@
 #if !defined(BUFFER_H)
 #define BUFFER_H
 
+#include <algorithm>
+#include <chrono>
 #include <mutex>
 #include <thread>
 #include <condition_variable>
 #include <atomic>
+#include <vector>
 
+#include "buffer_stats.h"
 #include "image.h"
+#include "pool.h"
 
 namespace Imaging
 {
-	/* Thread safe image queue buffer */
+	// What ImageBuffer::push() does if the buffer is full.
+	enum class Overflow
+	{
+		Block,				// waits until a frame is popped.
+		BlockWithTimeout,	// waits up to the timeout, and then drops the new frame.
+		DropNewest,			// drops the new frame.
+		DropOldest			// overwrites the oldest frame in the buffer.
+	};
+
+	// Wait time of try_pop() and try_pop_n() if none is given.
+	const std::chrono::seconds DefaultWaitTime(3);
+
+	namespace Internal
+	{
+		/* Spin of a consumer on an empty buffer before it sleeps.
+
+		A frame due within microseconds is taken sooner by polling for it than by sleeping
+		on a condition variable, whose wake-up takes several microseconds, or the timer
+		resolution of the OS (1 ms or more on Windows) for a timed wait. The spin time
+		follows the recent waits of the consumer: about twice the waits a spin could have
+		covered, averaged over the last 8 or so, and none if the frames come further apart
+		than the maximum or the waits time out. The spin yields the processor between
+		polls, so it does not hold up a producer on the same core for long; on a single
+		processor, where a spin only delays the producer, the maximum is zero. */
+		class AdaptiveSpin
+		{
+		public:
+			AdaptiveSpin(void);
+
+			// Spin time of the next wait; zero not to spin.
+			StatsClock::duration GetTime(void) const;
+
+			// Zero disables spinning.
+			void SetMaximum(const StatsClock::duration &maximum);
+
+			// Adapts the spin time to a wait which took 'waited' in total.
+			void Update(const StatsClock::duration &waited, bool ready);
+
+			/* Polls 'ready' for 'time' from 'start', and no later than the deadline; true
+			if 'ready' returned true. */
+			template <typename Pred>
+			static bool Spin(Pred ready, const StatsClock::time_point &start,
+				const StatsClock::duration &time,
+				const std::chrono::steady_clock::time_point &deadline);
+
+		protected:
+			StatsClock::duration maximum_;
+			StatsClock::duration time_;
+		};
+
+		// Deadline of a wait on the steady clock, rounded up to its resolution.
+		template <typename Rep, typename Period>
+		std::chrono::steady_clock::time_point GetDeadline(
+			const std::chrono::duration<Rep, Period> &wait_time);
+	}
+
+	/* Thread safe image queue buffer
+
+	Frame recycling.
+	If a FramePool is given, try_pop() returns the frame previously held by imgDst to the
+	pool instead of freeing it. Together with FramePool::acquire() on the producer side,
+	streaming frames of a fixed dimension does not allocate any memory in steady state.
+	The pool must outlive the buffer.
+
+	Batches.
+	push_n() and try_pop_n() move a batch of frames per lock acquisition and per
+	notification instead of one frame each, e.g. for a consumer processing 32 frames at a
+	time. push_n() moves the frames from [first, first + n) in order, waiting for room as
+	push() does if the batch does not fit at once. try_pop_n() waits as try_pop() does until
+	at least one frame is available, moves up to 'n' frames into [first, first + n), and
+	returns the number of frames moved; 0 if timed out.
+
+	Overflow.
+	push() waits indefinitely for a full buffer by default (Overflow::Block). SetOverflow()
+	selects another policy, e.g. Overflow::DropOldest for a live preview, which must never
+	hold up the acquisition; the consumer then gets the latest frames.
+	push() returns false and push_n() returns fewer than 'n' if new frames were dropped.
+	A frame dropped for a full buffer is returned to the pool if given. Otherwise it is left
+	in the source, i.e. the new frame itself, or with Overflow::DropOldest the oldest frame
+	it replaced, so the producer can fill it again without allocating memory.
+	dropped() counts the new frames dropped, and overwritten() counts the queued frames
+	replaced by Overflow::DropOldest.
+
+	Waiting.
+	try_pop() and try_pop_n() wait for a frame up to DefaultWaitTime, up to a duration of
+	any unit, e.g. std::chrono::microseconds(200), or until a deadline on the steady clock,
+	e.g. the end of a frame period shared by several calls; try_pop_now() never waits.
+	A change of the system time does not shorten or extend a wait, except with Visual
+	Studio 2013, whose steady_clock is the system clock.
+	Before sleeping on an empty buffer, a consumer spins for a while adapted to its recent
+	waits (see Internal::AdaptiveSpin), so frames handed over every few microseconds are
+	taken without a sleep and a wake-up each. SetMaxSpin() limits the spin time (50 us by
+	default with more than one processor), and a maximum of zero disables spinning.
+
+	Statistics.
+	stats() returns a snapshot of the counters of the buffer (see ImageBufferStats), e.g.
+	to size its capacity, or to find the stage of a pipeline holding up the others; a
+	monitor may call it every few seconds, and reset_stats() starts a new interval.
+	Every frame is stamped on push() and its latency recorded on try_pop(), under the lock
+	already taken, so the counters cost one clock read per call (or per batch) when no
+	thread waits; the time spent waiting is measured only if push() or try_pop() actually
+	waits. */
 	class ImageBuffer
 	{
 	public:
 		ImageBuffer(std::size_t capacity);
+		ImageBuffer(std::size_t capacity, FramePool &pool);
 		~ImageBuffer(void);
-		void push(ImageFrame &&imgSrc);
+		bool push(ImageFrame &&imgSrc);
+		bool try_pop(ImageFrame &imgDst);
+		template <typename Rep, typename Period>
+		bool try_pop(ImageFrame &imgDst,
+			const std::chrono::duration<Rep, Period> &wait_time);
 		bool try_pop(ImageFrame &imgDst,
-			const std::chrono::seconds &wait_time = std::chrono::seconds(3));
+			const std::chrono::steady_clock::time_point &deadline);
+		bool try_pop_now(ImageFrame &imgDst);
+
+		template <typename InputIt>
+		std::size_t push_n(InputIt first, std::size_t n);
+		template <typename ForwardIt>
+		std::size_t try_pop_n(ForwardIt first, std::size_t n);
+		template <typename ForwardIt, typename Rep, typename Period>
+		std::size_t try_pop_n(ForwardIt first, std::size_t n,
+			const std::chrono::duration<Rep, Period> &wait_time);
+		template <typename ForwardIt>
+		std::size_t try_pop_n(ForwardIt first, std::size_t n,
+			const std::chrono::steady_clock::time_point &deadline);
+
+		// The timeout is used only with Overflow::BlockWithTimeout.
+		void SetOverflow(Overflow policy,
+			const std::chrono::milliseconds &timeout = std::chrono::milliseconds(0));
+		Overflow GetOverflow(void) const;
+
+		void SetMaxSpin(const std::chrono::microseconds &maxSpin);
+
+		std::size_t dropped(void) const;
+		std::size_t overwritten(void) const;
+
+		ImageBufferStats stats(void) const;
+
+		// Zeroes every counter, including dropped() and overwritten().
+		void reset_stats(void);
+
 	protected:
+		// Waits for room per the overflow policy; false if the buffer is still full.
+		bool WaitForRoom(std::unique_lock<std::mutex> &lock);
+
+		// Waits for a frame until the deadline; false if timed out.
+		bool WaitForFrames(std::unique_lock<std::mutex> &lock,
+			const std::chrono::steady_clock::time_point &deadline);
+
+		// Stamps a frame just queued at the back.
+		void Enqueued(const StatsClock::time_point &now);
+
+		// Moves the frame at the front to imgDst, and the previous frame of imgDst to
+		// imgOld if it goes back to the pool.
+		void PopFront(ImageFrame &imgDst, ImageFrame &imgOld);
+
 		std::size_t capacity_ = 0;
 		ImageFrame *data_ = nullptr;
+		FramePool *pool_ = nullptr;
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Overflow policy and its counters.
+		Overflow overflow_ = Overflow::Block;
+		std::chrono::milliseconds timeout_ = std::chrono::milliseconds(0);
+		std::atomic_size_t dropped_ = 0;
+		std::atomic_size_t overwritten_ = 0;
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Statistics; guarded by mutex_. stamps_[i] is the time data_[i] was queued.
+		std::vector<StatsClock::time_point> stamps_;
+		std::size_t highWater_ = 0;
+		std::uint64_t pushed_ = 0;
+		std::uint64_t popped_ = 0;
+		StatsClock::duration blocked_ = StatsClock::duration(0);
+		StatsClock::duration idle_ = StatsClock::duration(0);
+		LatencyHistogram latency_;
+		StatsClock::time_point since_;
+		Internal::AdaptiveSpin spin_;
 
 		////////////////////////////////////////////////////////////////////////////////////
 		// Real-time dimension information.
@@ -32,6 +205,99 @@ namespace Imaging
 
 		////////////////////////////////////////////////////////////////////////////////////
 		// Thread safe locks.
+		mutable std::mutex mutex_;
+		std::condition_variable not_empty_;
+		std::condition_variable not_full_;
+	};
+
+	/* Lock-free image queue buffer for exactly one producer and one consumer.
+
+	The producer owns back_ and the consumer owns front_. Each index is written by only one
+	thread, so the hand-off of a frame is a release store of an index and an acquire load of
+	the same index on the other side; no lock is taken while the buffer is neither empty
+	nor full.
+	The indices increase monotonically and are mapped to slots by modulo, so
+	(back_ - front_) is always the number of frames in the buffer.
+
+	The producer only sleeps when the buffer is full, and the consumer only sleeps when the
+	buffer is empty. The other side notifies only if a waiting flag is set, so the mutex and
+	condition variables are untouched in steady state.
+
+	push_n() and try_pop_n() behave as those of ImageBuffer, and publish a batch with a
+	single store of the index. The waits and the spin of the consumer are the same as those
+	of ImageBuffer.
+
+	NOTE: Calling push() from more than one thread or try_pop() from more than one thread
+	is undefined. Use ImageBuffer for multiple producers or consumers, or for an overflow
+	policy other than Overflow::Block. */
+	class SpscImageBuffer
+	{
+	public:
+		SpscImageBuffer(std::size_t capacity);
+		SpscImageBuffer(std::size_t capacity, FramePool &pool);
+		~SpscImageBuffer(void);
+		void push(ImageFrame &&imgSrc);
+		bool try_pop(ImageFrame &imgDst);
+		template <typename Rep, typename Period>
+		bool try_pop(ImageFrame &imgDst,
+			const std::chrono::duration<Rep, Period> &wait_time);
+		bool try_pop(ImageFrame &imgDst,
+			const std::chrono::steady_clock::time_point &deadline);
+		bool try_pop_now(ImageFrame &imgDst);
+
+		template <typename InputIt>
+		void push_n(InputIt first, std::size_t n);
+		template <typename ForwardIt>
+		std::size_t try_pop_n(ForwardIt first, std::size_t n);
+		template <typename ForwardIt, typename Rep, typename Period>
+		std::size_t try_pop_n(ForwardIt first, std::size_t n,
+			const std::chrono::duration<Rep, Period> &wait_time);
+		template <typename ForwardIt>
+		std::size_t try_pop_n(ForwardIt first, std::size_t n,
+			const std::chrono::steady_clock::time_point &deadline);
+
+		void SetMaxSpin(const std::chrono::microseconds &maxSpin);
+
+	protected:
+		// Slow path of the producer; waits until the buffer is not full.
+		void WaitForRoom(std::size_t back);
+
+		// Slow path of the consumer; spins or waits until the buffer is not empty or timed
+		// out.
+		bool WaitForFrames(std::size_t front,
+			const std::chrono::steady_clock::time_point &deadline);
+
+		// Re-reads back_ if the buffer looks empty with the cached value; false if empty.
+		bool HasFrames(std::size_t front);
+
+		// Moves the frame at 'front' to imgDst, and then releases its slot.
+		void PopFront(std::size_t front, ImageFrame &imgDst);
+
+		// Size of a cache line. Separates the indices to avoid false sharing.
+		static const std::size_t CacheLineSize = 64;
+
+		std::size_t capacity_ = 0;
+		ImageFrame *data_ = nullptr;
+		FramePool *pool_ = nullptr;
+		char padding0_[CacheLineSize];
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Producer side; front_cache_ is the last known value of front_.
+		std::atomic_size_t back_;
+		std::size_t front_cache_ = 0;
+		char padding1_[CacheLineSize - sizeof(std::atomic_size_t) - sizeof(std::size_t)];
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Consumer side; back_cache_ is the last known value of back_.
+		std::atomic_size_t front_;
+		std::size_t back_cache_ = 0;
+		char padding2_[CacheLineSize - sizeof(std::atomic_size_t) - sizeof(std::size_t)];
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Slow path; used only if the buffer is full or empty.
+		std::atomic_bool producer_waiting_;
+		std::atomic_bool consumer_waiting_;
+		Internal::AdaptiveSpin spin_;	// guarded by mutex_.
 		std::mutex mutex_;
 		std::condition_variable not_empty_;
 		std::condition_variable not_full_;
@@ -40,59 +306,686 @@ namespace Imaging
 
 namespace Imaging
 {
-	ImageBuffer::ImageBuffer(std::size_t capacity) : capacity_(capacity)
+	namespace Internal
+	{
+		inline AdaptiveSpin::AdaptiveSpin(void) : maximum_(0), time_(0)
+		{
+			if (std::thread::hardware_concurrency() > 1)
+				this->maximum_ = std::chrono::microseconds(50);
+		}
+
+		inline StatsClock::duration AdaptiveSpin::GetTime(void) const
+		{
+			return this->time_;
+		}
+
+		inline void AdaptiveSpin::SetMaximum(const StatsClock::duration &maximum)
+		{
+			this->maximum_ = maximum;
+			this->time_ = std::min(this->time_, maximum);
+		}
+
+		// An exponential moving average of 1/8, which decays to zero in integers.
+		inline void AdaptiveSpin::Update(const StatsClock::duration &waited, bool ready)
+		{
+			auto target = StatsClock::duration(0);
+			if (ready && waited <= this->maximum_)
+				target = std::min(2 * waited, this->maximum_);
+			this->time_ = (7 * this->time_ + target) / 8;
+		}
+
+		// static
+		template <typename Pred>
+		bool AdaptiveSpin::Spin(Pred ready, const StatsClock::time_point &start,
+			const StatsClock::duration &time,
+			const std::chrono::steady_clock::time_point &deadline)
+		{
+			// The two clocks differ; the deadline limits the spin time instead.
+			auto until = start + time;
+			auto left = deadline - std::chrono::steady_clock::now();
+			if (left < time)
+				until = start + std::chrono::duration_cast<StatsClock::duration>(left);
+
+			while (!ready())
+			{
+				if (StatsClock::now() >= until)
+					return false;
+				std::this_thread::yield();
+			}
+			return true;
+		}
+
+		template <typename Rep, typename Period>
+		std::chrono::steady_clock::time_point GetDeadline(
+			const std::chrono::duration<Rep, Period> &wait_time)
+		{
+			typedef std::chrono::steady_clock::duration Duration;
+			auto wait = std::chrono::duration_cast<Duration>(wait_time);
+			if (wait < wait_time)
+				wait += Duration(1);
+			return std::chrono::steady_clock::now() + wait;
+		}
+	}
+
+	inline ImageBuffer::ImageBuffer(std::size_t capacity) : capacity_(capacity),
+		stamps_(capacity), since_(StatsClock::now())
 	{
 		this->data_ = new ImageFrame[this->capacity_];
 	}
 
-	ImageBuffer::~ImageBuffer(void)
+	inline ImageBuffer::ImageBuffer(std::size_t capacity, FramePool &pool) :
+		ImageBuffer(capacity)
+	{
+		this->pool_ = &pool;
+	}
+
+	inline ImageBuffer::~ImageBuffer(void)
 	{
 		delete[] this->data_;
 	}
 
 	// The internally used lock must be a std::unique_lock to use std::condition_variable.
-	void ImageBuffer::push(ImageFrame &&imgSrc)
+	inline bool ImageBuffer::push(ImageFrame &&imgSrc)
 	{
-		// Wait indefinitely if the buffer is full.		
-		std::unique_lock<std::mutex> lock(this->mutex_);
-		this->not_full_.wait(lock, [this](){
-			return this->count_.load() != this->capacity_; });
+		bool queued = false;
+		{
+			// Wait per the overflow policy if the buffer is full.
+			std::unique_lock<std::mutex> lock(this->mutex_);
+			if (this->WaitForRoom(lock))
+			{
+				// Move data instead of copying.
+				this->data_[this->back_.load()] = std::move(imgSrc);
+				this->Enqueued(StatsClock::now());
 
-		// Move data instead of copying.
-		this->data_[this->back_.load()] = std::move(imgSrc);
+				// Update counter.
+				this->back_ = (this->back_.load() + 1) % this->capacity_;
+				++this->count_;
+				this->highWater_ = std::max(this->highWater_, this->count_.load());
 
-		// Update counter.
-		this->back_ = (this->back_.load() + 1) % this->capacity_;
-		++this->count_;
+				// Notify that buffer is not empty.
+				this->not_empty_.notify_one();
+				return true;
+			}
+
+			if (this->overflow_ == Overflow::DropOldest)
+			{	// The oldest frame is at the back of a full buffer; swap it with the new.
+				std::swap(this->data_[this->back_.load()], imgSrc);
+				this->Enqueued(StatsClock::now());
+				this->back_ = (this->back_.load() + 1) % this->capacity_;
+				this->front_ = this->back_.load();
+				++this->overwritten_;
+				queued = true;
+			}
+			else
+				++this->dropped_;
+		}
 
-		// Notify that buffer is not empty.
-		this->not_empty_.notify_one();
+		// Recycle the dropped frame after unlocking.
+		if (this->pool_ && !imgSrc.data.empty())
+			this->pool_->release(std::move(imgSrc));
+		return queued;
 	}
 
-	bool ImageBuffer::try_pop(ImageFrame &imgDst, const std::chrono::seconds &wait_time)
+	inline bool ImageBuffer::try_pop(ImageFrame &imgDst)
 	{
-		// Wait for given wait time if buffer is empty.
-		std::unique_lock<std::mutex> lock(this->mutex_);
-		//this->not_empty_.wait(lock, [this](){ return this->count_.load() != 0; });
-		auto now = std::chrono::system_clock::now();
-		if (this->not_empty_.wait_until(lock, now + wait_time,
-			[this](){ return this->count_.load() != 0; }))
+		return this->try_pop(imgDst, DefaultWaitTime);
+	}
+
+	template <typename Rep, typename Period>
+	bool ImageBuffer::try_pop(ImageFrame &imgDst,
+		const std::chrono::duration<Rep, Period> &wait_time)
+	{
+		return this->try_pop(imgDst, Internal::GetDeadline(wait_time));
+	}
+
+	inline bool ImageBuffer::try_pop(ImageFrame &imgDst,
+		const std::chrono::steady_clock::time_point &deadline)
+	{
+		// Keeps the previous frame of imgDst to return it to the pool after unlocking.
+		ImageFrame imgOld;
 		{
-			// Move data instead of copying to a temporary variable.
-			imgDst = std::move(this->data_[this->front_.load()]);
+			// Wait until the deadline if buffer is empty.
+			std::unique_lock<std::mutex> lock(this->mutex_);
+			//this->not_empty_.wait(lock, [this](){ return this->count_.load() != 0; });
+			if (!this->WaitForFrames(lock, deadline))
+				return false;	// timed out.
+			this->PopFront(imgDst, imgOld);
+		}
 
-			// Update counter.
-			this->front_ = (this->front_.load() + 1) % this->capacity_;
-			--this->count_;
+		if (this->pool_)
+			this->pool_->release(std::move(imgOld));
+		return true;
+	}
 
-			// Notify that buffer is not full.
-			this->not_full_.notify_one();
+	// Polls without locking if the buffer is empty.
+	inline bool ImageBuffer::try_pop_now(ImageFrame &imgDst)
+	{
+		if (this->count_.load() == 0)
+			return false;
+
+		ImageFrame imgOld;
+		{
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			if (this->count_.load() == 0)
+				return false;	// taken by another consumer.
+			this->PopFront(imgDst, imgOld);
+		}
+
+		if (this->pool_)
+			this->pool_->release(std::move(imgOld));
+		return true;
+	}
+
+	template <typename InputIt>
+	std::size_t ImageBuffer::push_n(InputIt first, std::size_t n)
+	{
+		// Keeps the dropped frames to return them to the pool after unlocking.
+		std::vector<ImageFrame> imgOld;
+		std::size_t queued = 0;
+		{
+			std::unique_lock<std::mutex> lock(this->mutex_);
+			for (std::size_t pending = 0; n != 0; pending = 0)
+			{
+				// Move as many frames as the buffer has room for.
+				const auto now = StatsClock::now();
+				auto m = std::min(n, this->capacity_ - this->count_.load());
+				for (std::size_t i = 0; i != m; ++i, ++first)
+				{
+					this->data_[this->back_.load()] = std::move(*first);
+					this->Enqueued(now);
+					this->back_ = (this->back_.load() + 1) % this->capacity_;
+					++this->count_;
+				}
+				this->highWater_ = std::max(this->highWater_, this->count_.load());
+				n -= m;
+				queued += m;
+				pending += m;
+
+				// Full; overwrite the oldest frames with the rest of the batch.
+				if (n != 0 && this->overflow_ == Overflow::DropOldest)
+				{
+					m = n;
+					for (std::size_t i = 0; i != m; ++i, ++first)
+					{
+						std::swap(this->data_[this->back_.load()], *first);
+						this->Enqueued(now);
+						this->back_ = (this->back_.load() + 1) % this->capacity_;
+						this->front_ = this->back_.load();
+						if (this->pool_ && !first->data.empty())
+							imgOld.push_back(std::move(*first));
+					}
+					this->overwritten_ += m;
+					n = 0;
+					queued += m;
+				}
+
+				// Notify once for the frames moved; every frame may wake up a consumer.
+				// This must be done before waiting, so the consumers make room.
+				if (pending == 1)
+					this->not_empty_.notify_one();
+				else if (pending > 1)
+					this->not_empty_.notify_all();
 
+				// Full; wait per the overflow policy, or drop the rest of the batch.
+				if (n != 0 && !this->WaitForRoom(lock))
+				{
+					for (; n != 0; --n, ++first)
+					{
+						if (this->pool_ && !first->data.empty())
+							imgOld.push_back(std::move(*first));
+						++this->dropped_;
+					}
+				}
+			}
+		}
+
+		for (auto &img : imgOld)
+			this->pool_->release(std::move(img));
+		return queued;
+	}
+
+	template <typename ForwardIt>
+	std::size_t ImageBuffer::try_pop_n(ForwardIt first, std::size_t n)
+	{
+		return this->try_pop_n(first, n, DefaultWaitTime);
+	}
+
+	template <typename ForwardIt, typename Rep, typename Period>
+	std::size_t ImageBuffer::try_pop_n(ForwardIt first, std::size_t n,
+		const std::chrono::duration<Rep, Period> &wait_time)
+	{
+		return this->try_pop_n(first, n, Internal::GetDeadline(wait_time));
+	}
+
+	template <typename ForwardIt>
+	std::size_t ImageBuffer::try_pop_n(ForwardIt first, std::size_t n,
+		const std::chrono::steady_clock::time_point &deadline)
+	{
+		if (n == 0)
+			return 0;
+
+		// Keeps the previous frames of the destination to return them to the pool later.
+		std::vector<ImageFrame> imgOld;
+		if (this->pool_)
+			imgOld.reserve(n);
+		std::size_t m = 0;
+		{
+			// Wait until the deadline if buffer is empty.
+			std::unique_lock<std::mutex> lock(this->mutex_);
+			if (!this->WaitForFrames(lock, deadline))
+				return 0;	// timed out.
+
+			// Move as many frames as available up to n.
+			const auto now = StatsClock::now();
+			m = std::min(n, this->count_.load());
+			this->popped_ += m;
+			for (std::size_t i = 0; i != m; ++i, ++first)
+			{
+				if (this->pool_ && !first->data.empty())
+					imgOld.push_back(std::move(*first));
+				*first = std::move(this->data_[this->front_.load()]);
+				this->latency_.record(now - this->stamps_[this->front_.load()]);
+				this->front_ = (this->front_.load() + 1) % this->capacity_;
+				--this->count_;
+			}
+
+			// Notify once for the batch; every slot may wake up a producer.
+			if (m == 1)
+				this->not_full_.notify_one();
+			else
+				this->not_full_.notify_all();
+		}
+
+		for (auto &img : imgOld)
+			this->pool_->release(std::move(img));
+		return m;
+	}
+
+	inline void ImageBuffer::SetOverflow(Overflow policy,
+		const std::chrono::milliseconds &timeout)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		this->overflow_ = policy;
+		this->timeout_ = timeout;
+	}
+
+	inline Overflow ImageBuffer::GetOverflow(void) const
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		return this->overflow_;
+	}
+
+	inline void ImageBuffer::SetMaxSpin(const std::chrono::microseconds &maxSpin)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		this->spin_.SetMaximum(maxSpin);
+	}
+
+	inline std::size_t ImageBuffer::dropped(void) const
+	{
+		return this->dropped_.load();
+	}
+
+	inline std::size_t ImageBuffer::overwritten(void) const
+	{
+		return this->overwritten_.load();
+	}
+
+	inline ImageBufferStats ImageBuffer::stats(void) const
+	{
+		ImageBufferStats snapshot;
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		snapshot.capacity = this->capacity_;
+		snapshot.size = this->count_.load();
+		snapshot.highWater = this->highWater_;
+		snapshot.pushed = this->pushed_;
+		snapshot.popped = this->popped_;
+		snapshot.dropped = this->dropped_.load();
+		snapshot.overwritten = this->overwritten_.load();
+		snapshot.producerBlocked = this->blocked_;
+		snapshot.consumerIdle = this->idle_;
+		snapshot.latency = this->latency_;
+		snapshot.elapsed = StatsClock::now() - this->since_;
+		return snapshot;
+	}
+
+	// The frames in the buffer are not counted again in the high-water mark.
+	inline void ImageBuffer::reset_stats(void)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		this->highWater_ = this->count_.load();
+		this->pushed_ = 0;
+		this->popped_ = 0;
+		this->dropped_ = 0;
+		this->overwritten_ = 0;
+		this->blocked_ = StatsClock::duration(0);
+		this->idle_ = StatsClock::duration(0);
+		this->latency_.reset();
+		this->since_ = StatsClock::now();
+	}
+
+	// Measures the time waited only if the buffer is full on entry.
+	inline bool ImageBuffer::WaitForRoom(std::unique_lock<std::mutex> &lock)
+	{
+		auto not_full = [this](){ return this->count_.load() != this->capacity_; };
+		if (not_full())
 			return true;
+
+		bool room = false;
+		const auto start = StatsClock::now();
+		switch (this->overflow_)
+		{
+		case Overflow::Block:
+			this->not_full_.wait(lock, not_full);
+			room = true;
+			break;
+		case Overflow::BlockWithTimeout:
+			room = this->not_full_.wait_until(lock, Internal::GetDeadline(this->timeout_),
+				not_full);
+			break;
+		default:
+			return false;
+		}
+		this->blocked_ += StatsClock::now() - start;
+		return room;
+	}
+
+	/* Spins with the lock released, and then sleeps unless a frame came and is still there
+	after locking again. Measures the time waited only if the buffer is empty on entry. */
+	inline bool ImageBuffer::WaitForFrames(std::unique_lock<std::mutex> &lock,
+		const std::chrono::steady_clock::time_point &deadline)
+	{
+		auto not_empty = [this](){ return this->count_.load() != 0; };
+		if (not_empty())
+			return true;
+
+		bool ready = false;
+		const auto start = StatsClock::now();
+		const auto spin = this->spin_.GetTime();
+		if (spin.count() != 0)
+		{
+			lock.unlock();
+			Internal::AdaptiveSpin::Spin(not_empty, start, spin, deadline);
+			lock.lock();
+			ready = not_empty();
 		}
-		else
+		if (!ready)
+			ready = this->not_empty_.wait_until(lock, deadline, not_empty);
+
+		const auto waited = StatsClock::now() - start;
+		this->idle_ += waited;
+		this->spin_.Update(waited, ready);
+		return ready;
+	}
+
+	inline void ImageBuffer::Enqueued(const StatsClock::time_point &now)
+	{
+		this->stamps_[this->back_.load()] = now;
+		++this->pushed_;
+	}
+
+	inline void ImageBuffer::PopFront(ImageFrame &imgDst, ImageFrame &imgOld)
+	{
+		// Move data instead of copying to a temporary variable.
+		if (this->pool_ && !imgDst.data.empty())
+			imgOld = std::move(imgDst);
+		imgDst = std::move(this->data_[this->front_.load()]);
+		this->latency_.record(StatsClock::now() - this->stamps_[this->front_.load()]);
+		++this->popped_;
+
+		// Update counter.
+		this->front_ = (this->front_.load() + 1) % this->capacity_;
+		--this->count_;
+
+		// Notify that buffer is not full.
+		this->not_full_.notify_one();
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// SpscImageBuffer
+
+	inline SpscImageBuffer::SpscImageBuffer(std::size_t capacity) : capacity_(capacity),
+		back_(0), front_(0), producer_waiting_(false), consumer_waiting_(false)
+	{
+		this->data_ = new ImageFrame[this->capacity_];
+	}
+
+	inline SpscImageBuffer::SpscImageBuffer(std::size_t capacity, FramePool &pool) :
+		SpscImageBuffer(capacity)
+	{
+		this->pool_ = &pool;
+	}
+
+	inline SpscImageBuffer::~SpscImageBuffer(void)
+	{
+		delete[] this->data_;
+	}
+
+	inline void SpscImageBuffer::push(ImageFrame &&imgSrc)
+	{
+		auto back = this->back_.load(std::memory_order_relaxed);
+
+		// Re-read front_ only if the buffer looks full with the cached value.
+		if (back - this->front_cache_ == this->capacity_)
+		{
+			this->front_cache_ = this->front_.load(std::memory_order_acquire);
+			if (back - this->front_cache_ == this->capacity_)
+				this->WaitForRoom(back);
+		}
+
+		// Move data instead of copying, and then publish it.
+		this->data_[back % this->capacity_] = std::move(imgSrc);
+		this->back_.store(back + 1, std::memory_order_release);
+
+		// Wake up the consumer only if it is sleeping.
+		// The fence pairs with the one in try_pop() so that either the consumer sees the
+		// new back_ or the producer sees consumer_waiting_.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (this->consumer_waiting_.load(std::memory_order_relaxed))
+		{
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			this->not_empty_.notify_one();
+		}
+	}
+
+	inline bool SpscImageBuffer::try_pop(ImageFrame &imgDst)
+	{
+		return this->try_pop(imgDst, DefaultWaitTime);
+	}
+
+	template <typename Rep, typename Period>
+	bool SpscImageBuffer::try_pop(ImageFrame &imgDst,
+		const std::chrono::duration<Rep, Period> &wait_time)
+	{
+		return this->try_pop(imgDst, Internal::GetDeadline(wait_time));
+	}
+
+	inline bool SpscImageBuffer::try_pop(ImageFrame &imgDst,
+		const std::chrono::steady_clock::time_point &deadline)
+	{
+		auto front = this->front_.load(std::memory_order_relaxed);
+		if (!this->HasFrames(front) && !this->WaitForFrames(front, deadline))
 			return false;	// timed out.
+		this->PopFront(front, imgDst);
+		return true;
+	}
+
+	inline bool SpscImageBuffer::try_pop_now(ImageFrame &imgDst)
+	{
+		auto front = this->front_.load(std::memory_order_relaxed);
+		if (!this->HasFrames(front))
+			return false;
+		this->PopFront(front, imgDst);
+		return true;
+	}
+
+	inline void SpscImageBuffer::PopFront(std::size_t front, ImageFrame &imgDst)
+	{
+		// Move data instead of copying to a temporary variable, and then release the slot.
+		ImageFrame imgOld;
+		if (this->pool_ && !imgDst.data.empty())
+			imgOld = std::move(imgDst);
+		imgDst = std::move(this->data_[front % this->capacity_]);
+		this->front_.store(front + 1, std::memory_order_release);
+
+		// Wake up the producer only if it is sleeping.
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (this->producer_waiting_.load(std::memory_order_relaxed))
+		{
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			this->not_full_.notify_one();
+		}
+
+		if (this->pool_)
+			this->pool_->release(std::move(imgOld));
+	}
+
+	template <typename InputIt>
+	void SpscImageBuffer::push_n(InputIt first, std::size_t n)
+	{
+		auto back = this->back_.load(std::memory_order_relaxed);
+		while (n != 0)
+		{
+			// Re-read front_ only if the cached value has no room for the whole batch.
+			if (back - this->front_cache_ + n > this->capacity_)
+			{
+				this->front_cache_ = this->front_.load(std::memory_order_acquire);
+				if (back - this->front_cache_ == this->capacity_)
+					this->WaitForRoom(back);
+			}
+
+			// Move as many frames as the buffer has room for, and publish them at once.
+			auto m = std::min(n, this->capacity_ - (back - this->front_cache_));
+			for (std::size_t i = 0; i != m; ++i, ++first, ++back)
+				this->data_[back % this->capacity_] = std::move(*first);
+			this->back_.store(back, std::memory_order_release);
+			n -= m;
+
+			// Wake up the consumer only if it is sleeping; see push().
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			if (this->consumer_waiting_.load(std::memory_order_relaxed))
+			{
+				std::lock_guard<std::mutex> lock(this->mutex_);
+				this->not_empty_.notify_one();
+			}
+		}
+	}
+
+	template <typename ForwardIt>
+	std::size_t SpscImageBuffer::try_pop_n(ForwardIt first, std::size_t n)
+	{
+		return this->try_pop_n(first, n, DefaultWaitTime);
+	}
+
+	template <typename ForwardIt, typename Rep, typename Period>
+	std::size_t SpscImageBuffer::try_pop_n(ForwardIt first, std::size_t n,
+		const std::chrono::duration<Rep, Period> &wait_time)
+	{
+		return this->try_pop_n(first, n, Internal::GetDeadline(wait_time));
+	}
+
+	template <typename ForwardIt>
+	std::size_t SpscImageBuffer::try_pop_n(ForwardIt first, std::size_t n,
+		const std::chrono::steady_clock::time_point &deadline)
+	{
+		if (n == 0)
+			return 0;
+
+		// Re-read back_ only if the cached value has fewer frames than the batch.
+		auto front = this->front_.load(std::memory_order_relaxed);
+		if (this->back_cache_ - front < n)
+		{
+			this->back_cache_ = this->back_.load(std::memory_order_acquire);
+			if (front == this->back_cache_ && !this->WaitForFrames(front, deadline))
+				return 0;	// timed out.
+		}
+
+		// Move as many frames as available up to n, and then release the slots at once.
+		std::vector<ImageFrame> imgOld;
+		if (this->pool_)
+			imgOld.reserve(n);
+		auto m = std::min(n, this->back_cache_ - front);
+		for (std::size_t i = 0; i != m; ++i, ++first, ++front)
+		{
+			if (this->pool_ && !first->data.empty())
+				imgOld.push_back(std::move(*first));
+			*first = std::move(this->data_[front % this->capacity_]);
+		}
+		this->front_.store(front, std::memory_order_release);
+
+		// Wake up the producer only if it is sleeping; see try_pop().
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (this->producer_waiting_.load(std::memory_order_relaxed))
+		{
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			this->not_full_.notify_one();
+		}
+
+		for (auto &img : imgOld)
+			this->pool_->release(std::move(img));
+		return m;
+	}
+
+	// Full; wait indefinitely like ImageBuffer::push().
+	inline void SpscImageBuffer::WaitForRoom(std::size_t back)
+	{
+		std::unique_lock<std::mutex> lock(this->mutex_);
+		this->producer_waiting_.store(true);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		this->not_full_.wait(lock, [this, back](){
+			return back - this->front_.load(std::memory_order_acquire) !=
+				this->capacity_; });
+		this->producer_waiting_.store(false);
+		this->front_cache_ = this->front_.load(std::memory_order_acquire);
+	}
+
+	inline void SpscImageBuffer::SetMaxSpin(const std::chrono::microseconds &maxSpin)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		this->spin_.SetMaximum(maxSpin);
+	}
+
+	// Empty; spin with the lock released, as the producer does not notify a spinning
+	// consumer, and then wait until the deadline.
+	inline bool SpscImageBuffer::WaitForFrames(std::size_t front,
+		const std::chrono::steady_clock::time_point &deadline)
+	{
+		auto not_empty = [this, front](){
+			return this->back_.load(std::memory_order_acquire) != front; };
+		std::unique_lock<std::mutex> lock(this->mutex_);
+		bool ready = false;
+		const auto start = StatsClock::now();
+		const auto spin = this->spin_.GetTime();
+		if (spin.count() != 0)
+		{
+			lock.unlock();
+			ready = Internal::AdaptiveSpin::Spin(not_empty, start, spin, deadline);
+			lock.lock();
+		}
+		if (!ready)
+		{
+			this->consumer_waiting_.store(true);
+			std::atomic_thread_fence(std::memory_order_seq_cst);
+			ready = this->not_empty_.wait_until(lock, deadline, not_empty);
+			this->consumer_waiting_.store(false);
+		}
+
+		this->spin_.Update(StatsClock::now() - start, ready);
+		if (ready)
+			this->back_cache_ = this->back_.load(std::memory_order_acquire);
+		return ready;
+	}
+
+	// Re-read back_ only if the buffer looks empty with the cached value.
+	inline bool SpscImageBuffer::HasFrames(std::size_t front)
+	{
+		if (front != this->back_cache_)
+			return true;
+		this->back_cache_ = this->back_.load(std::memory_order_acquire);
+		return front != this->back_cache_;
 	}
 
+	// SpscImageBuffer
+	////////////////////////////////////////////////////////////////////////////////////////
 }
 #endif
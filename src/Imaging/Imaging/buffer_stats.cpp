@@ -0,0 +1,33 @@
+#if defined(_WIN32)
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+#include "buffer_stats.h"
+
+namespace Imaging
+{
+	// static
+	StatsClock::time_point StatsClock::now(void)
+	{
+#if defined(_WIN32)
+		// Queried on every call instead of cached in a function-local static, which Visual
+		// Studio 2013 does not initialize in a thread safe way; it only reads a value the
+		// system fixed at boot.
+		LARGE_INTEGER frequency, counter;
+		::QueryPerformanceFrequency(&frequency);
+		::QueryPerformanceCounter(&counter);
+
+		// Whole seconds and the rest apart, so the nanoseconds do not overflow.
+		const LONGLONG seconds = counter.QuadPart / frequency.QuadPart;
+		const LONGLONG rest = counter.QuadPart % frequency.QuadPart;
+		return time_point(duration(seconds * 1000000000 +
+			rest * 1000000000 / frequency.QuadPart));
+#else
+		return time_point(std::chrono::duration_cast<duration>(
+			std::chrono::steady_clock::now().time_since_epoch()));
+#endif
+	}
+}
@@ -0,0 +1,227 @@
+#if !defined(BUFFER_STATS_H)
+#define BUFFER_STATS_H
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+namespace Imaging
+{
+	/* Monotonic clock of the buffer statistics, in nanoseconds.
+
+	std::chrono::steady_clock and high_resolution_clock of Visual Studio 2013 are the system
+	clock, which ticks in about 1 ms and may jump; this one reads QueryPerformanceCounter()
+	on Windows, and std::chrono::steady_clock elsewhere. */
+	struct StatsClock
+	{
+		typedef std::chrono::nanoseconds duration;
+		typedef duration::rep rep;
+		typedef duration::period period;
+		typedef std::chrono::time_point<StatsClock> time_point;
+		static const bool is_steady = true;
+
+		static time_point now(void);
+	};
+
+	/* Histogram of durations with a bounded relative error, in the manner of an HDR
+	histogram.
+
+	The durations below 2^SubBucketBits ns have a bucket each, and every power of two above
+	is split into 2^SubBucketBits buckets of equal width, so a bucket is at most 1/32
+	(about 3%) as wide as the durations in it, from nanoseconds to minutes. Durations from
+	2^MaxExponent ns (about 18 minutes) on are counted in the last bucket.
+	record() is a few shifts and an increment without allocating; the buckets take about
+	9 KB. percentile() returns the upper bound of the bucket holding the percentile,
+	clamped to the range of the recorded durations. */
+	class LatencyHistogram
+	{
+	public:
+		typedef StatsClock::duration Duration;
+
+		static const unsigned int SubBucketBits = 5;
+		static const unsigned int MaxExponent = 40;
+		static const std::size_t NumBuckets =
+			std::size_t(MaxExponent - SubBucketBits + 1) << SubBucketBits;
+
+		LatencyHistogram(void);
+
+		void record(const Duration &d);
+		void reset(void);
+
+		// Adds the durations of another histogram, e.g. of every stage of a pipeline.
+		LatencyHistogram &operator+=(const LatencyHistogram &rhs);
+
+		std::uint64_t count(void) const;
+		Duration minimum(void) const;
+		Duration maximum(void) const;
+		Duration mean(void) const;
+
+		// 'p' from 0.0 to 1.0, e.g. 0.99; zero if nothing is recorded.
+		Duration percentile(double p) const;
+
+	protected:
+		static std::size_t GetBucket(std::uint64_t ns);
+
+		// Largest duration in the bucket.
+		static std::uint64_t GetUpperBound(std::size_t bucket);
+
+		std::vector<std::uint64_t> buckets_;
+		std::uint64_t count_ = 0;
+		std::uint64_t min_ = 0;
+		std::uint64_t max_ = 0;
+		double sum_ = 0.0;
+	};
+
+	/* Snapshot of the counters of an ImageBuffer; see ImageBuffer::stats().
+
+	Of a stage between two buffers, a high 'producerBlocked' of its output means the next
+	stage is the bottleneck, and a high 'consumerIdle' of its input means the stage before
+	is; 'highWater' near the capacity means the buffer was full at some point. */
+	struct ImageBufferStats
+	{
+		typedef StatsClock::duration Duration;
+
+		std::size_t capacity = 0;
+		std::size_t size = 0;			// frames in the buffer at the snapshot.
+		std::size_t highWater = 0;		// most frames in the buffer at once.
+
+		std::uint64_t pushed = 0;		// frames queued, including over the oldest.
+		std::uint64_t popped = 0;
+		std::size_t dropped = 0;		// see ImageBuffer::dropped().
+		std::size_t overwritten = 0;	// see ImageBuffer::overwritten().
+
+		// Total time push() waited for room, and try_pop() for frames (timed out too).
+		Duration producerBlocked = Duration(0);
+		Duration consumerIdle = Duration(0);
+
+		// Time from push() to try_pop() of each frame popped.
+		LatencyHistogram latency;
+
+		// Time since the buffer was created or the statistics were reset.
+		Duration elapsed = Duration(0);
+	};
+}
+
+namespace Imaging
+{
+	inline LatencyHistogram::LatencyHistogram(void) : buckets_(NumBuckets, 0)
+	{}
+
+	inline void LatencyHistogram::record(const Duration &d)
+	{
+		const std::uint64_t ns = d.count() > 0 ? static_cast<std::uint64_t>(d.count()) : 0;
+		++this->buckets_[LatencyHistogram::GetBucket(ns)];
+		if (this->count_ == 0 || ns < this->min_)
+			this->min_ = ns;
+		if (ns > this->max_)
+			this->max_ = ns;
+		this->sum_ += static_cast<double>(ns);
+		++this->count_;
+	}
+
+	inline void LatencyHistogram::reset(void)
+	{
+		std::fill(this->buckets_.begin(), this->buckets_.end(), 0);
+		this->count_ = 0;
+		this->min_ = 0;
+		this->max_ = 0;
+		this->sum_ = 0.0;
+	}
+
+	inline LatencyHistogram &LatencyHistogram::operator+=(const LatencyHistogram &rhs)
+	{
+		if (rhs.count_ == 0)
+			return *this;
+		for (std::size_t n = 0; n != NumBuckets; ++n)
+			this->buckets_[n] += rhs.buckets_[n];
+		if (this->count_ == 0 || rhs.min_ < this->min_)
+			this->min_ = rhs.min_;
+		if (rhs.max_ > this->max_)
+			this->max_ = rhs.max_;
+		this->sum_ += rhs.sum_;
+		this->count_ += rhs.count_;
+		return *this;
+	}
+
+	inline std::uint64_t LatencyHistogram::count(void) const
+	{
+		return this->count_;
+	}
+
+	inline LatencyHistogram::Duration LatencyHistogram::minimum(void) const
+	{
+		return Duration(static_cast<Duration::rep>(this->min_));
+	}
+
+	inline LatencyHistogram::Duration LatencyHistogram::maximum(void) const
+	{
+		return Duration(static_cast<Duration::rep>(this->max_));
+	}
+
+	inline LatencyHistogram::Duration LatencyHistogram::mean(void) const
+	{
+		if (this->count_ == 0)
+			return Duration(0);
+		return Duration(static_cast<Duration::rep>(this->sum_ / this->count_));
+	}
+
+	inline LatencyHistogram::Duration LatencyHistogram::percentile(double p) const
+	{
+		if (this->count_ == 0)
+			return Duration(0);
+
+		// Rank of the percentile from 1 to count_.
+		p = std::min(std::max(p, 0.0), 1.0);
+		auto rank = std::max<std::uint64_t>(1,
+			static_cast<std::uint64_t>(std::ceil(p * this->count_)));
+		std::uint64_t seen = 0;
+		std::size_t n = 0;
+		for (; n != NumBuckets - 1; ++n)
+		{
+			seen += this->buckets_[n];
+			if (seen >= rank)
+				break;
+		}
+		auto ns = std::min(std::max(LatencyHistogram::GetUpperBound(n), this->min_),
+			this->max_);
+		return Duration(static_cast<Duration::rep>(ns));
+	}
+
+	/* A duration from 2^e ns (e >= SubBucketBits) is in the sub-bucket of its top
+	SubBucketBits + 1 bits, so the buckets of one power of two follow those of the one
+	below, and the durations below 2^(SubBucketBits + 1) ns are their own bucket. */
+	// static
+	inline std::size_t LatencyHistogram::GetBucket(std::uint64_t ns)
+	{
+		const std::uint64_t limit = std::uint64_t(1) << MaxExponent;
+		if (ns >= limit)
+			ns = limit - 1;
+		if (ns < (std::uint64_t(1) << SubBucketBits))
+			return static_cast<std::size_t>(ns);
+
+		// Index of the highest set bit by halving the range.
+		unsigned int e = 0;
+		for (unsigned int shift = 32; shift != 0; shift /= 2)
+			if ((ns >> (e + shift)) != 0)
+				e += shift;
+
+		const unsigned int shift = e - SubBucketBits;
+		return (std::size_t(shift) << SubBucketBits) +
+			static_cast<std::size_t>(ns >> shift);
+	}
+
+	// static
+	inline std::uint64_t LatencyHistogram::GetUpperBound(std::size_t bucket)
+	{
+		const std::size_t subBuckets = std::size_t(1) << SubBucketBits;
+		if (bucket < 2 * subBuckets)
+			return bucket;
+		const unsigned int shift = static_cast<unsigned int>(bucket / subBuckets - 1);
+		const std::uint64_t sub = bucket % subBuckets + subBuckets;
+		return ((sub + 1) << shift) - 1;
+	}
+}
+
+#endif
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+#include "copy.h"
+#include "thread_pool.h"
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define IMAGING_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+namespace Imaging
+{
+	namespace Internal
+	{
+		// A band smaller than this costs more to schedule than it saves.
+		const std::size_t MinBytesPerBand = 1 << 20;
+
+		/* Non-temporal stores require a 16-byte aligned destination, so the bytes up to
+		the first boundary and the last partial vector are copied as usual. */
+		void CopyBlock(const char *src, char *dst, std::size_t n, bool nonTemporal)
+		{
+#if defined(IMAGING_HAVE_SSE2)
+			if (nonTemporal)
+			{
+				std::size_t head = (16 - reinterpret_cast<std::uintptr_t>(dst) % 16) % 16;
+				head = std::min(head, n);
+				std::memcpy(dst, src, head);
+				src += head, dst += head, n -= head;
+
+				__m128i *itDst = reinterpret_cast<__m128i *>(dst);
+				const __m128i *itSrc = reinterpret_cast<const __m128i *>(src);
+				for (; n >= 64; n -= 64, itSrc += 4, itDst += 4)
+				{
+					__m128i v0 = _mm_loadu_si128(itSrc);
+					__m128i v1 = _mm_loadu_si128(itSrc + 1);
+					__m128i v2 = _mm_loadu_si128(itSrc + 2);
+					__m128i v3 = _mm_loadu_si128(itSrc + 3);
+					_mm_stream_si128(itDst, v0);
+					_mm_stream_si128(itDst + 1, v1);
+					_mm_stream_si128(itDst + 2, v2);
+					_mm_stream_si128(itDst + 3, v3);
+				}
+				for (; n >= 16; n -= 16, ++itSrc, ++itDst)
+					_mm_stream_si128(itDst, _mm_loadu_si128(itSrc));
+				std::memcpy(itDst, itSrc, n);
+				return;
+			}
+#else
+			(void)nonTemporal;
+#endif
+			std::memcpy(dst, src, n);
+		}
+
+		void CopyLines(const char *src, std::size_t stepSrc, char *dst, std::size_t stepDst,
+			std::size_t bytesPerLine, std::size_t nLines, bool nonTemporal)
+		{
+			for (std::size_t y = 0; y != nLines; ++y, src += stepSrc, dst += stepDst)
+				CopyBlock(src, dst, bytesPerLine, nonTemporal);
+		}
+
+		/* Non-temporal stores are weakly ordered, so they must be flushed before the band
+		is reported done to the thread waiting for it. */
+		void FenceNonTemporal(bool nonTemporal)
+		{
+#if defined(IMAGING_HAVE_SSE2)
+			if (nonTemporal)
+				_mm_sfence();
+#else
+			(void)nonTemporal;
+#endif
+		}
+	}
+
+	void CopyLines(const char *src, std::size_t stepSrc, char *dst, std::size_t stepDst,
+		std::size_t bytesPerLine, std::size_t nLines)
+	{
+		const std::size_t bytesTotal = bytesPerLine * nLines;
+		if (bytesTotal == 0)
+			return;
+		const bool nonTemporal = bytesTotal >= NonTemporalCopyBytes;
+		const bool contiguous = stepSrc == bytesPerLine && stepDst == bytesPerLine;
+
+		// One band per thread, but not smaller than MinBytesPerBand or a line.
+		std::size_t nBands = 1;
+		if (bytesTotal >= ParallelCopyBytes)
+		{
+			nBands = std::min(ThreadPool::GetInstance().GetNumThreads(),
+				bytesTotal / Internal::MinBytesPerBand);
+			if (!contiguous)
+				nBands = std::min(nBands, nLines);
+		}
+
+		if (nBands <= 1)
+		{
+			if (contiguous)
+				Internal::CopyBlock(src, dst, bytesTotal, nonTemporal);
+			else
+				Internal::CopyLines(src, stepSrc, dst, stepDst, bytesPerLine, nLines,
+				nonTemporal);
+			Internal::FenceNonTemporal(nonTemporal);
+		}
+		else if (contiguous)
+		{
+			// Multiples of a cache line, so neighboring bands do not share one.
+			const std::size_t bytesPerBand = (bytesTotal / nBands + 63) / 64 * 64;
+			ThreadPool::GetInstance().ParallelFor(nBands, [=](std::size_t n)
+			{
+				std::size_t first = n * bytesPerBand;
+				if (first >= bytesTotal)
+					return;
+				std::size_t bytes = std::min(bytesPerBand, bytesTotal - first);
+				Internal::CopyBlock(src + first, dst + first, bytes, nonTemporal);
+				Internal::FenceNonTemporal(nonTemporal);
+			});
+		}
+		else
+		{
+			ThreadPool::GetInstance().ParallelFor(nBands, [=](std::size_t n)
+			{
+				std::size_t first = nLines * n / nBands, last = nLines * (n + 1) / nBands;
+				Internal::CopyLines(src + first * stepSrc, stepSrc, dst + first * stepDst,
+					stepDst, bytesPerLine, last - first, nonTemporal);
+				Internal::FenceNonTemporal(nonTemporal);
+			});
+		}
+	}
+}
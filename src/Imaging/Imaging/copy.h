@@ -0,0 +1,30 @@
+#if !defined(COPY_H)
+#define COPY_H
+
+#include <cstddef>
+
+namespace Imaging
+{
+	/* Copies 'nLines' lines of 'bytesPerLine' bytes between buffers with their own line
+	steps, i.e. the raw pointer version of Utilities::CopyLines().
+
+	Small copies run on the calling thread. If the total size reaches ParallelCopyBytes,
+	the lines are split into bands that are copied by ThreadPool::GetInstance().
+	If the destination reaches NonTemporalCopyBytes, which is larger than the last level
+	cache of typical desktop CPUs, SSE2 non-temporal stores write the destination directly
+	to memory instead of evicting the rest of the cache with data that nobody reads soon.
+
+	If both buffers have no gap between lines, they are copied as one contiguous block, and
+	the block is split into bands regardless of the line boundaries.
+	Source and destination must not overlap. */
+	void CopyLines(const char *src, std::size_t stepSrc, char *dst, std::size_t stepDst,
+		std::size_t bytesPerLine, std::size_t nLines);
+
+	// Total number of bytes to copy in parallel.
+	const std::size_t ParallelCopyBytes = 4 << 20;
+
+	// Total number of bytes to copy with non-temporal stores.
+	const std::size_t NonTemporalCopyBytes = 16 << 20;
+}
+
+#endif
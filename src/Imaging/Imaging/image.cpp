@@ -1,50 +1,13 @@
+#include <cstdint>
 #include <sstream>
 
 #include "utilities/containers.h"
+#include "copy.h"
 #include "image.h"
+#include "view.h"
 
 namespace Imaging
 {
-	////////////////////////////////////////////////////////////////////////////////////
-	// DataType and functions using DataType.
-
-	std::size_t GetNumBytes(DataType ty)
-	{
-		switch (ty)
-		{
-		case DataType::UNDEFINED:
-			throw std::runtime_error("Data type is undefined.");
-		case DataType::CHAR:
-			return sizeof(char);
-		case DataType::SCHAR:
-			return sizeof(signed char);
-		case DataType::UCHAR:
-			return sizeof(unsigned char);
-		case DataType::SHORT:
-			return sizeof(short);
-		case DataType::USHORT:
-			return sizeof(unsigned short);
-		case DataType::INT:
-			return sizeof(int);
-		case DataType::UINT:
-			return sizeof(unsigned int);
-		case DataType::FLOAT:
-			return sizeof(float);
-		case DataType::LONGLONG:
-			return sizeof(long long);
-		case DataType::ULONGLONG:
-			return sizeof(unsigned long long);
-		case DataType::DOUBLE:
-			return sizeof(double);
-		default:
-			throw std::logic_error("Unknown data type.");
-		}
-	}
-
-	// DataType and functions using DataType.
-	////////////////////////////////////////////////////////////////////////////////////
-
-
 	////////////////////////////////////////////////////////////////////////////////////
 	// ImageFrame
 
@@ -55,12 +18,13 @@ namespace Imaging
 	{
 		// Check source dimension.
 		ImageFrame::EvalSize(src.dataType, src.data.size(), src.size.width, src.size.height,
-			src.depth);
+			src.depth, src.alignment);
 
 		// Copy image data.
 		this->data_ = src.data;
 
 		// Update dimension.
+		this->alignment_ = src.alignment;
 		this->bytesPerLine_ = src.bytesPerLine;
 		this->dataType_ = src.dataType;
 		this->depth_ = src.depth;
@@ -78,18 +42,20 @@ namespace Imaging
 	{
 		// Check source dimension.
 		ImageFrame::EvalSize(src.dataType, src.data.size(), src.size.width, src.size.height,
-			src.depth);
+			src.depth, src.alignment);
 
 		// Move image data.
 		this->data_ = std::move(src.data_);
 
 		// Update dimension.
+		this->alignment_ = src.alignment;
 		this->bytesPerLine_ = src.bytesPerLine;
 		this->dataType_ = src.dataType;
 		this->depth_ = src.depth;
 		this->size_ = src.size;
 
 		// Update dimension at the source.
+		src.alignment_ = 1;
 		src.bytesPerLine_ = 0;
 		src.dataType_ = DataType::UNDEFINED;
 		src.depth_ = 0;
@@ -98,6 +64,11 @@ namespace Imaging
 		return *this;
 	}
 
+	ImageFrame::ImageFrame(const ConstImageView &viewSrc, SizeType align) : ImageFrame()
+	{
+		this->CopyFrom(viewSrc, align);
+	}
+
 	// Constructors.
 	////////////////////////////////////////////////////////////////////////////////////
 
@@ -105,12 +76,29 @@ namespace Imaging
 	////////////////////////////////////////////////////////////////////////////////////
 	// Methods.
 
+	void ImageFrame::Adopt(ByteType *src, DataType ty, const Size2D<SizeType> &sz,
+		SizeType d, SizeType stepBytes, const std::shared_ptr<void> &owner)
+	{
+		auto align = ImageFrame::EvalLayout(src, ty, sz.width, d, stepBytes);
+
+		// Refer to the image data.
+		this->data_.Adopt(src, stepBytes * sz.height, owner);
+
+		// Update dimension.
+		this->alignment_ = align;
+		this->bytesPerLine_ = stepBytes;
+		this->dataType_ = ty;
+		this->depth_ = d;
+		this->size_ = sz;
+	}
+
 	void ImageFrame::Clear()
 	{
 		// Clear memory.
 		this->data_.clear();
 
 		// Update dimension.
+		this->alignment_ = 1;
 		this->bytesPerLine_ = 0;
 		this->dataType_ = DataType::UNDEFINED;
 		this->depth_ = 0;
@@ -124,9 +112,10 @@ namespace Imaging
 		ImageFrame::EvalSize(ty, srcData.size(), sz.width, sz.height, d);
 
 		// Copy image data.
-		this->data_ = srcData;
+		this->data_.assign(srcData.data(), srcData.data() + srcData.size());
 
 		// Update dimension.
+		this->alignment_ = 1;
 		this->bytesPerLine_ = ImageFrame::GetBytesPerLine(ty, sz.width, d);
 		this->dataType_ = ty;
 		this->depth_ = d;
@@ -134,32 +123,65 @@ namespace Imaging
 	}
 
 	void ImageFrame::CopyFrom(const ByteType *src, DataType ty, const Size2D<SizeType> &sz,
-		SizeType d, SizeType stepBytes)
+		SizeType d, SizeType stepBytes, SizeType align)
 	{
+		ImageFrame::EvalAlignment(align);
+
 		// Compute memory requirement.
-		auto bytes_line = ImageFrame::GetBytesPerLine(ty, sz.width, d);
+		auto bytes_line = ImageFrame::GetBytesPerLine(ty, sz.width, d, align);
 		auto bytes_total = sz.height * bytes_line;
 
+		// A source within the image data of this object, e.g. a view of its ROI, would be
+		// freed or overwritten while copying; keep it alive and copy to a new block.
+		std::shared_ptr<void> srcOwner;
+		auto first = reinterpret_cast<std::uintptr_t>(this->data.data());
+		auto pos = reinterpret_cast<std::uintptr_t>(src);
+		if (pos >= first && pos < first + this->data.size())
+			srcOwner = this->data.owner();
+
 		// Copy image data considering padding bytes.
+		// Adopted image data may not be aligned enough for the new alignment, and shared
+		// image data must not be overwritten; see ImageData::IsShared().
+		if (srcOwner || first % align != 0 || this->data.IsShared())
+			this->data_.clear();
+		if (this->data.size() != bytes_total)
+		{	// Every byte is overwritten unless the padding bytes differ.
+			this->data_.clear();
+			this->data_.resize(bytes_total,
+				bytes_line == stepBytes ? Init::None : Init::Zero);
+		}
 		if (bytes_line == stepBytes)	// identical padding bytes.
-			this->data_.assign(src, src + bytes_total);
+			CopyLines(src, bytes_total, this->data_.data(), bytes_total, bytes_total, 1);
 		else
-		{	// different padding bytes.
-			if (this->data.size() != bytes_total)
-				this->data_.resize(bytes_total);
-			auto itDst = this->data_.begin();
-			Utilities::CopyLines(src, stepBytes, itDst, bytes_line, stepBytes, sz.height);
+		{	// different padding bytes; copy only the effective bytes of each line.
+			auto bytes_effective = ImageFrame::GetBytesPerLine(ty, sz.width, d);
+			CopyLines(src, stepBytes, this->data_.data(), bytes_line, bytes_effective,
+				sz.height);
 			//for (auto H = 0; H != sz.height; ++H, src += stepBytes, itDst += bytes_line)
 			//	std::copy_n(src, sz.width * d * GetNumBytes(ty), itDst);
 		}
 
 		// Update dimension.
+		this->alignment_ = align;
 		this->bytesPerLine_ = bytes_line;
 		this->dataType_ = ty;
 		this->depth_ = d;
 		this->size_ = sz;
 	}
 
+	void ImageFrame::CopyFrom(const ConstImageView &viewSrc, SizeType align)
+	{
+		if (viewSrc.IsEmpty())
+		{
+			ImageFrame::EvalAlignment(align);
+			this->Clear();
+			return;
+		}
+
+		this->CopyFrom(viewSrc.Cbegin(), viewSrc.dataType, viewSrc.size, viewSrc.depth,
+			viewSrc.bytesPerLine, align);
+	}
+
 	ImageFrame ImageFrame::CopyTo(const ROI &roiSrc) const
 	{
 		// Check source ROI.
@@ -168,24 +190,28 @@ namespace Imaging
 		ImageFrame imgDst;
 
 		// Update dimension first.
+		imgDst.alignment_ = this->alignment;
 		imgDst.bytesPerLine_ = ImageFrame::GetBytesPerLine(this->dataType,
-			roiSrc.size.width, this->depth);
+			roiSrc.size.width, this->depth, this->alignment);
 		imgDst.dataType_ = this->dataType;
 		imgDst.depth_ = this->depth;
 		imgDst.size_ = roiSrc.size;
 
 		// Copy image data.
 		if (roiSrc == ROI{ { 0, 0 }, this->size })
-			imgDst.data_ = this->data;	// Copy entire image.
+		{	// Copy entire image including padding bytes.
+			imgDst.data_.resize(this->data.size(), Init::None);
+			CopyLines(this->data.data(), this->data.size(), imgDst.data_.data(),
+				this->data.size(), this->data.size(), 1);
+		}
 		else
 		{	// Copy ROI line by line after computing the number of bytes.
-			imgDst.Reset(this->dataType, roiSrc.size, this->depth);
-			auto itSrc = this->Cbegin(roiSrc.origin);
-			auto itDst = imgDst.Begin();
 			auto bytes_line_roi = GetNumBytes(this->dataType) * roiSrc.size.width *
 				this->depth;
-			Utilities::CopyLines(itSrc, this->bytesPerLine, itDst, imgDst.bytesPerLine,
-				bytes_line_roi,	roiSrc.size.height);
+			imgDst.Reset(this->dataType, roiSrc.size, this->depth, this->alignment,
+				imgDst.bytesPerLine == bytes_line_roi ? Init::None : Init::Zero);
+			CopyLines(this->data.data() + this->GetOffset(roiSrc.origin), this->bytesPerLine,
+				imgDst.data_.data(), imgDst.bytesPerLine, bytes_line_roi, roiSrc.size.height);
 		}
 
 		return imgDst;
@@ -204,11 +230,53 @@ namespace Imaging
 		}
 	}
 
+	// static
+	void ImageFrame::EvalAlignment(SizeType align)
+	{
+		if (align == 0 || (align & (align - 1)) != 0 || align > ImageFrame::BufferAlignment)
+		{
+			std::ostringstream errMsg;
+			errMsg << "The line alignment (" << align << ") must be a power of two up to " <<
+				ImageFrame::BufferAlignment << ".";
+			throw std::invalid_argument(errMsg.str());
+		}
+	}
+
+	// static
+	ImageFrame::SizeType ImageFrame::FindAlignment(const ByteType *src, DataType ty,
+		SizeType w, SizeType d, SizeType stepBytes)
+	{
+		auto addr = reinterpret_cast<std::uintptr_t>(src);
+		for (SizeType align = ImageFrame::BufferAlignment; align != 0; align /= 2)
+			if (ImageFrame::GetBytesPerLine(ty, w, d, align) == stepBytes && addr % align == 0)
+				return align;
+		return 0;
+	}
+
+	// static
+	ImageFrame::SizeType ImageFrame::EvalLayout(const ByteType *src, DataType ty,
+		SizeType w, SizeType d, SizeType stepBytes)
+	{
+		auto align = ImageFrame::FindAlignment(src, ty, w, d, stepBytes);
+		if (align == 0)
+		{
+			std::ostringstream errMsg;
+			errMsg << "The source lines (" << stepBytes << " bytes/line at " <<
+				static_cast<const void *>(src) << ") are not laid out with a line alignment.";
+			throw std::invalid_argument(errMsg.str());
+		}
+		return align;
+	}
+
 	// static
 	void ImageFrame::EvalSize(DataType ty, SizeType length, SizeType w, SizeType h,
-		SizeType d)
+		SizeType d, SizeType align)
 	{
-		auto bytes_line = ImageFrame::GetBytesPerLine(ty, w, d);
+		// An empty frame has no data type, e.g. the end of a stream passed through a buffer.
+		if (ty == DataType::UNDEFINED && length == 0)
+			return;
+
+		auto bytes_line = ImageFrame::GetBytesPerLine(ty, w, d, align);
 		auto bytes_total = bytes_line * h;
 		if (length != bytes_total)
 		{
@@ -225,27 +293,48 @@ namespace Imaging
 		// Check source dimension.
 		ImageFrame::EvalSize(ty, srcData.size(), sz.width, sz.height, d);
 
-		// Move image data.
-		this->data_ = std::move(srcData);
+		// Take over the std::vector. The owner points to the first byte, as that of a block
+		// allocated by a storage does, so the image data is not regarded as shared.
+		if (srcData.empty())
+			this->data_.clear();
+		else
+		{
+			auto holder = std::make_shared<std::vector<ByteType>>(std::move(srcData));
+			this->data_.Adopt(holder->data(), holder->size(),
+				std::shared_ptr<void>(holder, holder->data()));
+		}
 
 		// Update dimension.
+		this->alignment_ = 1;
 		this->bytesPerLine_ = ImageFrame::GetBytesPerLine(ty, sz.width, d);
 		this->dataType_ = ty;
 		this->depth_ = d;
 		this->size_ = sz;
 	}
 
-	void ImageFrame::Reset(DataType ty, const Size2D<SizeType> &sz, SizeType d)
+	void ImageFrame::Reset(DataType ty, const Size2D<SizeType> &sz, SizeType d,
+		SizeType align, Init init)
 	{
+		ImageFrame::EvalAlignment(align);
+
 		// Compute memory requirement.
-		auto bytes_line = ImageFrame::GetBytesPerLine(ty, sz.width, d);
+		auto bytes_line = ImageFrame::GetBytesPerLine(ty, sz.width, d, align);
 		auto bytes_total = sz.height * bytes_line;
 
 		// Memory re-allocation.
+		// Adopted image data may not be aligned enough for the new alignment.
+		if (reinterpret_cast<std::uintptr_t>(this->data.data()) % align != 0)
+			this->data_.clear();
 		if (this->data.size() != bytes_total)
-			this->data_.resize(bytes_total);
+		{
+			// Nothing to keep either if the caller overwrites the image data.
+			if (init == Init::None)
+				this->data_.clear();
+			this->data_.resize(bytes_total, init);
+		}
 
 		// Update dimension.
+		this->alignment_ = align;
 		this->bytesPerLine_ = bytes_line;
 		this->dataType_ = ty;
 		this->depth_ = d;
@@ -1,9 +1,12 @@
 #if !defined(IMAGE_H)
 #define IMAGE_H
 
+#include <memory>
+#include <stdexcept>
 #include <vector>
 
 #include "coordinates.h"
+#include "image_data.h"
 
 namespace Imaging
 {
@@ -110,20 +113,67 @@ namespace Imaging
 	// GetDataType<T>()
 	////////////////////////////////////////////////////////////////////////////////////
 
-	std::size_t GetNumBytes(DataType ty);
+	/* Defined inline, so the switch statement is folded into a constant when the data type
+	is known at the call site, or a table lookup otherwise. */
+	inline std::size_t GetNumBytes(DataType ty)
+	{
+		switch (ty)
+		{
+		case DataType::UNDEFINED:
+			throw std::runtime_error("Data type is undefined.");
+		case DataType::CHAR:
+			return sizeof(char);
+		case DataType::SCHAR:
+			return sizeof(signed char);
+		case DataType::UCHAR:
+			return sizeof(unsigned char);
+		case DataType::SHORT:
+			return sizeof(short);
+		case DataType::USHORT:
+			return sizeof(unsigned short);
+		case DataType::INT:
+			return sizeof(int);
+		case DataType::UINT:
+			return sizeof(unsigned int);
+		case DataType::FLOAT:
+			return sizeof(float);
+		case DataType::LONGLONG:
+			return sizeof(long long);
+		case DataType::ULONGLONG:
+			return sizeof(unsigned long long);
+		case DataType::DOUBLE:
+			return sizeof(double);
+		default:
+			throw std::logic_error("Unknown data type.");
+		}
+	}
 
 	// DataType and functions using DataType.
 	////////////////////////////////////////////////////////////////////////////////////
 
+	// Non-owning views of image data; defined in view.h.
+	template <typename B>
+	class BasicImageView;
+	typedef BasicImageView<const char> ConstImageView;
+
 
 	/* Pixel-based bitmap (raster) image.
 
-	This class template stores image data as a std::vector<byte>, so it is equivalent to raw
-	pointer and capable of padding bytes if necessary. The byte unit type can be either
+	This class template stores image data as an ImageData, a std::vector<byte> like
+	container with shared ownership, so it is equivalent to raw pointer and capable of
+	padding bytes if necessary. The byte unit type can be either
 	{char, unsigned char, signed char}.
 	The image data can be accessed through iterators by accessing methods.
 	The dimension of image data can be changed during the runtime by resizing the
-	std::vector<byte>.
+	ImageData.
+
+	The ImageData allocates aligned memory, so the first line always starts at a
+	BufferAlignment boundary. Each line is padded up to a multiple of 'alignment' bytes,
+	so every line starts at an 'alignment' boundary as well. The default alignment is 1,
+	which means no padding bytes.
+	An ImageFrame can also refer to image data owned by others without copying it (see
+	Adopt()), e.g. the data of a cv::Mat. Then the first line starts at an 'alignment'
+	boundary, which is as far as the owner aligns it.
 
 	Since the data type of images are usually known after loading an image file, which is
 	runtime instead of compile time, template based	image class is not a practical design.
@@ -140,7 +190,8 @@ namespace Imaging
 	length: number of frames per block (not used in this class)
 	c: position of a channel at given pixel; [0 ~ depth)
 	x: position of a pixel at given line; [0 ~ width)
-	y: position of a line at given frame; [0 ~ height) */
+	y: position of a line at given frame; [0 ~ height)
+	alignment: number of bytes each line is aligned to; power of two, [1 ~ BufferAlignment] */
 
 	class ImageFrame
 	{
@@ -149,10 +200,13 @@ namespace Imaging
 		// Types and constants.
 
 		typedef char ByteType;
+		// Alignment of the first byte of image data; cache line and AVX-512 friendly.
+		static const std::size_t BufferAlignment = ImageData::Alignment;
+		typedef ImageData DataContainer;
 		// for pixel coordinate and raw (byte) data position.
-		typedef std::vector<ByteType>::size_type SizeType;
-		typedef std::vector<ByteType>::iterator Iterator;
-		typedef std::vector<ByteType>::const_iterator ConstIterator;
+		typedef DataContainer::size_type SizeType;
+		typedef DataContainer::iterator Iterator;
+		typedef DataContainer::const_iterator ConstIterator;
 		typedef RectTypeB<SizeType, SizeType> ROI;
 
 		// Types and constants.
@@ -170,11 +224,13 @@ namespace Imaging
 
 		////////////////////////////////////////////////////////////////////////////////////
 		// Custom constructors.
-		ImageFrame(DataType ty, const Size2D<SizeType> &sz, SizeType d = 1);
+		ImageFrame(DataType ty, const Size2D<SizeType> &sz, SizeType d = 1,
+			SizeType align = 1, Init init = Init::Zero);
 		ImageFrame(const std::vector<ByteType> &srcData, DataType ty,
 			const Size2D<SizeType> &sz, SizeType d = 1);
 		ImageFrame(std::vector<ByteType> &&srcData, DataType ty,
 			const Size2D<SizeType> &sz, SizeType d = 1);
+		explicit ImageFrame(const ConstImageView &viewSrc, SizeType align = 1);
 		// Custom constructors.
 		////////////////////////////////////////////////////////////////////////////////////
 
@@ -183,14 +239,33 @@ namespace Imaging
 		Iterator Begin(const Point2D<SizeType> &pt = { 0, 0 });
 		ConstIterator Cbegin(const Point2D<SizeType> &pt = { 0, 0 }) const;
 
+		const SizeType &alignment = this->alignment_;
 		const SizeType &bytesPerLine = this->bytesPerLine_;
-		const std::vector<ByteType> &data = this->data_;
+		const DataContainer &data = this->data_;
 		const DataType &dataType = this->dataType_;
 		const SizeType &depth = this->depth_;
 		const Size2D<SizeType> &size = this->size_;
 
 		////////////////////////////////////////////////////////////////////////////////////
 		// Methods.
+
+		/* Refers to image data owned by others instead of copying it, e.g. the data of a
+		cv::Mat. 'owner' keeps the data alive while this object, or any other object sharing
+		the data, refers to it.
+		The lines must be laid out as Reset() would with some line alignment, i.e.
+		'stepBytes' is the effective bytes/line rounded up to a power of two up to
+		BufferAlignment, and 'src' is aligned to it. Throws std::invalid_argument otherwise.
+		NOTE: As CopyFrom(), users must ensure that the size of source data is correct. */
+		void Adopt(ByteType *src, DataType ty, const Size2D<SizeType> &sz, SizeType d,
+			SizeType stepBytes, const std::shared_ptr<void> &owner);
+
+		/* Refers to a buffer owned by others, e.g. a DMA buffer of a camera driver, and calls
+		deleter(src) when the last object sharing the buffer releases it.
+		If this throws because of the layout, the deleter is not called. */
+		template <typename Deleter>
+		void Adopt(ByteType *src, DataType ty, const Size2D<SizeType> &sz, SizeType d,
+			SizeType stepBytes, Deleter deleter);
+
 		void Clear(void);
 
 		/* Copies image data from an std::vector<byte> with an identical allocation scheme.
@@ -200,28 +275,63 @@ namespace Imaging
 
 		/* Copies image data from a raw pointer.
 		The source data may have its own padding bytes.
-		Destination is resized per the size of source data.
+		Destination is resized per the size of source data, and its lines are aligned to
+		'align' bytes regardless of the padding bytes of the source.
+		The source may be within the image data of this object, e.g. a view of its ROI.
 		NOTE: Since there is no way to check the dimension of source data, users must ensure
 		that the size of source data is correct. */
 		void CopyFrom(const ByteType *src, DataType ty, const Size2D<SizeType> &sz,
-			SizeType d, SizeType stepBytes);
+			SizeType d, SizeType stepBytes, SizeType align = 1);
 
-		/* Creates a seprate ImageFrame object with the image data within the ROI.
+		/* Copies image data from a view, e.g. an ROI of another ImageFrame.
 		Destination is resized per the size of source data. */
+		void CopyFrom(const ConstImageView &viewSrc, SizeType align = 1);
+
+		/* Creates a seprate ImageFrame object with the image data within the ROI.
+		Destination is resized per the size of source data, and keeps the line alignment of
+		this object. */
 		ImageFrame CopyTo(const ROI &roiSrc) const;
 
-		static SizeType GetBytesPerLine(DataType ty, SizeType w, SizeType d);
+		// Throws std::invalid_argument unless 'align' is a valid line alignment.
+		static void EvalAlignment(SizeType align);
+
+		/* Largest line alignment which lays out lines of 'stepBytes' bytes at 'src', i.e.
+		the layout Adopt() accepts; 0 if there is none. */
+		static SizeType FindAlignment(const ByteType *src, DataType ty, SizeType w,
+			SizeType d, SizeType stepBytes);
+
+		// FindAlignment() which throws std::invalid_argument if there is no alignment.
+		static SizeType EvalLayout(const ByteType *src, DataType ty, SizeType w, SizeType d,
+			SizeType stepBytes);
+
+		// Number of bytes per line including padding bytes for the given line alignment.
+		static SizeType GetBytesPerLine(DataType ty, SizeType w, SizeType d,
+			SizeType align = 1);
 
 		bool HaveZeroPaddingBytes(void) const;
 
 		/* Moves image data from an std::vector<byte> with an identical allocation scheme.
-		Destination is resized per the size of source data. */
+		Destination is resized per the size of source data.
+		The image data is not copied; this object takes over the std::vector as the owner of
+		its image data (see Adopt()), whose lines have no padding bytes (alignment 1). */
 		void MoveFrom(std::vector<ByteType> &&srcData, DataType ty,
 			const Size2D<SizeType> &sz, SizeType d = 1);
 
+		/* Resizes the image data per the given dimension.
+		The image data is kept if its size does not change. Otherwise, Init::Zero keeps the
+		bytes up to the new size and zero-fills the rest as std::vector<byte>::resize() does,
+		and Init::None allocates new image data without touching it, for a caller writing
+		every byte anyway, e.g. with sensor data. */
 		template <typename T>
-		void Reset(const Size2D<SizeType> &sz, SizeType d = 1);
-		void Reset(DataType ty, const Size2D<SizeType> &sz, SizeType d = 1);
+		void Reset(const Size2D<SizeType> &sz, SizeType d = 1, SizeType align = 1,
+			Init init = Init::Zero);
+		void Reset(DataType ty, const Size2D<SizeType> &sz, SizeType d = 1,
+			SizeType align = 1, Init init = Init::Zero);
+
+		/* Selects the storage of the image data allocated from now on, e.g. huge pages or a
+		mapped file (see storage.h); nullptr selects the heap. The current image data stays
+		until its size changes. Copying or moving an ImageFrame does not carry the storage. */
+		void SetStorage(const std::shared_ptr<Storage> &storage);
 
 	protected:
 		////////////////////////////////////////////////////////////////////////////////////
@@ -233,12 +343,14 @@ namespace Imaging
 		void EvalPosition(const Point2D<SizeType> &pt) const;
 		void EvalRoi(const ROI &roi) const;
 		void EvalRoi(const Point2D<SizeType> &orgn, const Size2D<SizeType> &sz) const;
-		static void EvalSize(DataType ty, SizeType length, SizeType w, SizeType h, SizeType d);
+		static void EvalSize(DataType ty, SizeType length, SizeType w, SizeType h, SizeType d,
+			SizeType align = 1);
 
 		////////////////////////////////////////////////////////////////////////////////////
 		// Data.
+		SizeType alignment_ = 1;
 		SizeType bytesPerLine_ = 0;
-		std::vector<ByteType> data_;
+		DataContainer data_;
 		DataType dataType_ = DataType::UNDEFINED;
 		SizeType depth_ = 0;
 		Size2D<SizeType> size_ = Size2D<SizeType>(0, 0);
@@ -271,10 +383,10 @@ namespace Imaging
 		*this = std::move(src);
 	}
 
-	inline ImageFrame::ImageFrame(DataType ty, const Size2D<SizeType> &sz, SizeType d) :
-		ImageFrame()
+	inline ImageFrame::ImageFrame(DataType ty, const Size2D<SizeType> &sz, SizeType d,
+		SizeType align, Init init) : ImageFrame()
 	{
-		this->Reset(ty, sz, d);
+		this->Reset(ty, sz, d, align, init);
 	}
 
 	inline ImageFrame::ImageFrame(const std::vector<ByteType> &srcData, DataType ty,
@@ -317,11 +429,10 @@ namespace Imaging
 		}
 	}
 
+	// Uses the actual bytes/line, which includes padding bytes.
 	inline ImageFrame::SizeType ImageFrame::GetOffset(const Point2D<SizeType> &pt) const
 	{
-		auto bytes_line = ImageFrame::GetBytesPerLine(this->dataType, this->size.width,
-			this->depth);
-		return bytes_line * pt.y + GetNumBytes(this->dataType) * this->depth * pt.x;
+		return this->bytesPerLine * pt.y + GetNumBytes(this->dataType) * this->depth * pt.x;
 	}
 
 	// Accessors.
@@ -341,36 +452,39 @@ namespace Imaging
 	}
 
 	// static.
+	// Rounds up the effective bytes/line to the next multiple of the alignment.
 	inline ImageFrame::SizeType ImageFrame::GetBytesPerLine(DataType ty, SizeType w,
-		SizeType d)
+		SizeType d, SizeType align)
 	{
-		return w * d * GetNumBytes(ty) + 0;
+		auto bytes_effective = w * d * GetNumBytes(ty);
+		return (bytes_effective + align - 1) / align * align;
 	}
 
 	inline bool ImageFrame::HaveZeroPaddingBytes(void) const
 	{
 		auto bytes_line = this->size.width * this->depth * GetNumBytes(this->dataType);
-		return bytes_line == ImageFrame::GetBytesPerLine(this->dataType, this->size.width,
-			this->depth);
+		return bytes_line == this->bytesPerLine;
+	}
+
+	template <typename Deleter>
+	void ImageFrame::Adopt(ByteType *src, DataType ty, const Size2D<SizeType> &sz,
+		SizeType d, SizeType stepBytes, Deleter deleter)
+	{
+		// Check the layout before taking over the buffer, so the caller keeps it on failure.
+		ImageFrame::EvalLayout(src, ty, sz.width, d, stepBytes);
+		this->Adopt(src, ty, sz, d, stepBytes, std::shared_ptr<void>(src, deleter));
 	}
 
 	template <typename T>
-	void ImageFrame::Reset(const Size2D<SizeType> &sz, SizeType d)
+	void ImageFrame::Reset(const Size2D<SizeType> &sz, SizeType d, SizeType align,
+		Init init)
+	{
+		this->Reset(GetDataType<T>(), sz, d, align, init);
+	}
+
+	inline void ImageFrame::SetStorage(const std::shared_ptr<Storage> &storage)
 	{
-		// Compute memory requirement.
-		DataType ty = GetDataType<T>();
-		auto bytes_line = ImageFrame::GetBytesPerLine(ty, sz.width, d);
-		auto bytes_total = sz.height * bytes_line;
-
-		// Memory re-allocation.
-		if (this->data.size() != bytes_total)
-			this->data_.resize(bytes_total);
-
-		// Update dimension.
-		this->bytesPerLine_ = bytes_line;
-		this->dataType_ = ty;
-		this->depth_ = d;
-		this->size_ = sz;
+		this->data_.SetStorage(storage);
 	}
 
 	// Methods.
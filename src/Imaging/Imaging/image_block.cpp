@@ -0,0 +1,202 @@
+#include <sstream>
+#include <stdexcept>
+
+#include "copy.h"
+#include "image_block.h"
+
+namespace Imaging
+{
+	////////////////////////////////////////////////////////////////////////////////////////
+	// ImageBlock
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Constructors.
+
+	ImageBlock &ImageBlock::operator=(const ImageBlock &src)
+	{
+		// Copy image data.
+		this->data_ = src.data;
+
+		// Update dimension.
+		this->alignment_ = src.alignment;
+		this->bytesPerLine_ = src.bytesPerLine;
+		this->bytesPerFrame_ = src.bytesPerFrame;
+		this->dataType_ = src.dataType;
+		this->depth_ = src.depth;
+		this->length_ = src.length;
+		this->size_ = src.size;
+
+		return *this;
+	}
+
+	ImageBlock &ImageBlock::operator=(ImageBlock &&src)
+	{
+		// Move image data.
+		this->data_ = std::move(src.data_);
+
+		// Update dimension.
+		this->alignment_ = src.alignment;
+		this->bytesPerLine_ = src.bytesPerLine;
+		this->bytesPerFrame_ = src.bytesPerFrame;
+		this->dataType_ = src.dataType;
+		this->depth_ = src.depth;
+		this->length_ = src.length;
+		this->size_ = src.size;
+
+		// Update dimension at the source.
+		src.Clear();
+
+		return *this;
+	}
+
+	// Constructors.
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Methods.
+
+	void ImageBlock::Clear(void)
+	{
+		// Clear memory.
+		this->data_.clear();
+
+		// Update dimension.
+		this->alignment_ = 1;
+		this->bytesPerLine_ = 0;
+		this->bytesPerFrame_ = 0;
+		this->dataType_ = DataType::UNDEFINED;
+		this->depth_ = 0;
+		this->length_ = 0;
+		this->size_ = { 0, 0 };
+	}
+
+	void ImageBlock::CopyFrom(SizeType n, const ConstImageView &viewSrc)
+	{
+		this->EvalFrame(n);
+		if (viewSrc.dataType != this->dataType || viewSrc.depth != this->depth ||
+			viewSrc.size != this->size)
+		{
+			std::ostringstream errMsg;
+			errMsg << "The source (" << viewSrc.size.width << " x " <<
+				viewSrc.size.height << " x " << viewSrc.depth <<
+				") is not matched with the frames of the block (" << this->size.width <<
+				" x " << this->size.height << " x " << this->depth << ").";
+			throw std::invalid_argument(errMsg.str());
+		}
+		if (viewSrc.IsEmpty())
+			return;
+
+		auto bytes_effective = ImageFrame::GetBytesPerLine(this->dataType, this->size.width,
+			this->depth);
+		CopyLines(&(*viewSrc.Cbegin()), viewSrc.bytesPerLine, &(*this->Begin(n)),
+			this->bytesPerLine, bytes_effective, this->size.height);
+	}
+
+	void ImageBlock::EvalFrame(SizeType n) const
+	{
+		if (n >= this->length)
+		{
+			std::ostringstream errMsg;
+			errMsg << "Frame " << n << " is out of range (" << this->length << " frames).";
+			throw std::out_of_range(errMsg.str());
+		}
+	}
+
+	void ImageBlock::EvalPosition(SizeType n, const Point2D<SizeType> &pt) const
+	{
+		this->EvalFrame(n);
+		if (pt.x >= this->size.width || pt.y >= this->size.height)
+		{
+			std::ostringstream errMsg;
+			errMsg << "[" << pt.x << ", " << pt.y << "] is out of range.";
+			throw std::out_of_range(errMsg.str());
+		}
+	}
+
+	// The frame starts at a BufferAlignment boundary, so adopting it never fails.
+	ImageFrame ImageBlock::GetFrame(SizeType n) const
+	{
+		this->EvalFrame(n);
+		ImageFrame imgDst;
+		if (this->bytesPerFrame != 0)
+			imgDst.Adopt(const_cast<ByteType *>(&(*this->Cbegin(n))), this->dataType,
+			this->size, this->depth, this->bytesPerLine, this->data.owner());
+		return imgDst;
+	}
+
+	ImageView ImageBlock::GetView(SizeType n)
+	{
+		this->EvalFrame(n);
+		return ImageView(this->data_.begin() + this->GetOffset(n, { 0, 0 }), this->dataType,
+			this->size, this->depth, this->bytesPerLine);
+	}
+
+	ConstImageView ImageBlock::GetView(SizeType n) const
+	{
+		this->EvalFrame(n);
+		return ConstImageView(this->data.cbegin() + this->GetOffset(n, { 0, 0 }),
+			this->dataType, this->size, this->depth, this->bytesPerLine);
+	}
+
+	void ImageBlock::Reset(DataType ty, const Size2D<SizeType> &sz, SizeType d, SizeType n,
+		SizeType align, Init init)
+	{
+		ImageFrame::EvalAlignment(align);
+
+		// Compute memory requirement; every frame starts at a BufferAlignment boundary.
+		auto bytes_line = ImageFrame::GetBytesPerLine(ty, sz.width, d, align);
+		auto bytes_frame = (bytes_line * sz.height + ImageFrame::BufferAlignment - 1) /
+			ImageFrame::BufferAlignment * ImageFrame::BufferAlignment;
+		auto bytes_total = bytes_frame * n;
+
+		// Memory re-allocation.
+		if (this->data.size() != bytes_total)
+		{
+			// Nothing to keep either if the caller overwrites the image data.
+			if (init == Init::None)
+				this->data_.clear();
+			this->data_.resize(bytes_total, init);
+		}
+
+		// Update dimension.
+		this->alignment_ = align;
+		this->bytesPerLine_ = bytes_line;
+		this->bytesPerFrame_ = bytes_frame;
+		this->dataType_ = ty;
+		this->depth_ = d;
+		this->length_ = n;
+		this->size_ = sz;
+	}
+
+	ImageBlock ImageBlock::Slice(SizeType first, SizeType count) const
+	{
+		if (first > this->length || count > this->length - first)
+		{
+			std::ostringstream errMsg;
+			errMsg << "Frames [" << first << ", " << first + count <<
+				") are out of range (" << this->length << " frames).";
+			throw std::out_of_range(errMsg.str());
+		}
+
+		ImageBlock blockDst;
+		if (count != 0 && this->bytesPerFrame != 0)
+			blockDst.data_.Adopt(const_cast<ByteType *>(this->data.data()) +
+			this->bytesPerFrame * first, this->bytesPerFrame * count, this->data.owner());
+
+		// Update dimension.
+		blockDst.alignment_ = this->alignment;
+		blockDst.bytesPerLine_ = this->bytesPerLine;
+		blockDst.bytesPerFrame_ = this->bytesPerFrame;
+		blockDst.dataType_ = this->dataType;
+		blockDst.depth_ = this->depth;
+		blockDst.length_ = count;
+		blockDst.size_ = this->size;
+		return blockDst;
+	}
+
+	// Methods.
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	// ImageBlock
+	////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,176 @@
+#if !defined(IMAGE_BLOCK_H)
+#define IMAGE_BLOCK_H
+
+#include <vector>
+
+#include "image.h"
+#include "view.h"
+
+namespace Imaging
+{
+	/* Block of frames with an identical dimension in a single allocation, e.g. a z-stack or
+	a burst of captured images.
+
+	The frames are stored one after another in the order described at ImageFrame, i.e.
+	channel -> pixel -> line -> frame, and 'length' is the number of frames. Each frame is
+	laid out as an ImageFrame with the same line alignment, and starts at a BufferAlignment
+	boundary; bytesPerFrame is the distance between frames, which includes the padding
+	bytes up to the boundary.
+
+	Frames and slices of frames can be taken without copying image data. GetFrame() and
+	Slice() share the image data with this block as ImageFrame::Adopt() does, so they stay
+	valid after the block is destroyed or reset, and modifying one modifies the other. */
+	class ImageBlock
+	{
+	public:
+		////////////////////////////////////////////////////////////////////////////////////
+		// Types and constants.
+		typedef ImageFrame::ByteType ByteType;
+		typedef ImageFrame::SizeType SizeType;
+		typedef ImageFrame::Iterator Iterator;
+		typedef ImageFrame::ConstIterator ConstIterator;
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Default constructors.
+		ImageBlock(void) = default;
+		ImageBlock(const ImageBlock &src);
+		ImageBlock(ImageBlock &&src);
+		ImageBlock &operator=(const ImageBlock &src);
+		ImageBlock &operator=(ImageBlock &&src);
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Custom constructors.
+		ImageBlock(DataType ty, const Size2D<SizeType> &sz, SizeType d, SizeType n,
+			SizeType align = 1, Init init = Init::Zero);
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Accessors.
+		Iterator Begin(SizeType n, const Point2D<SizeType> &pt = { 0, 0 });
+		ConstIterator Cbegin(SizeType n, const Point2D<SizeType> &pt = { 0, 0 }) const;
+
+		const SizeType &alignment = this->alignment_;
+		const SizeType &bytesPerLine = this->bytesPerLine_;
+		const SizeType &bytesPerFrame = this->bytesPerFrame_;
+		const ImageData &data = this->data_;
+		const DataType &dataType = this->dataType_;
+		const SizeType &depth = this->depth_;
+		const SizeType &length = this->length_;
+		const Size2D<SizeType> &size = this->size_;
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Methods.
+		void Clear(void);
+
+		// Copies a frame into the n-th frame; the dimension must be identical.
+		void CopyFrom(SizeType n, const ConstImageView &viewSrc);
+
+		// n-th frame sharing the image data with this block.
+		ImageFrame GetFrame(SizeType n) const;
+
+		// Views of the n-th frame.
+		ImageView GetView(SizeType n);
+		ConstImageView GetView(SizeType n) const;
+
+		/* Pushes the frames into an ImageBuffer or a SpscImageBuffer in order as a batch
+		(see push_n()), sharing the image data with this block. So the frames are not
+		copied, but a frame overwritten in this block after the push is overwritten for the
+		consumer as well. */
+		template <typename BufferType>
+		void PushTo(BufferType &buffer) const;
+
+		/* Resizes the image data per the given dimension.
+		As ImageFrame::Reset(), the image data is kept if its size does not change, and
+		Init::None leaves new image data uninitialized. */
+		void Reset(DataType ty, const Size2D<SizeType> &sz, SizeType d, SizeType n,
+			SizeType align = 1, Init init = Init::Zero);
+
+		// Selects the storage of the image data allocated from now on; see ImageFrame.
+		void SetStorage(const std::shared_ptr<Storage> &storage);
+
+		// Block of 'count' frames from the first-th frame sharing the image data.
+		ImageBlock Slice(SizeType first, SizeType count) const;
+
+	protected:
+		////////////////////////////////////////////////////////////////////////////////////
+		// Accessors.
+		SizeType GetOffset(SizeType n, const Point2D<SizeType> &pt) const;
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Methods.
+		void EvalFrame(SizeType n) const;
+		void EvalPosition(SizeType n, const Point2D<SizeType> &pt) const;
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Data.
+		SizeType alignment_ = 1;
+		SizeType bytesPerLine_ = 0;
+		SizeType bytesPerFrame_ = 0;
+		ImageData data_;
+		DataType dataType_ = DataType::UNDEFINED;
+		SizeType depth_ = 0;
+		SizeType length_ = 0;
+		Size2D<SizeType> size_ = Size2D<SizeType>(0, 0);
+	};
+}
+
+namespace Imaging
+{
+	////////////////////////////////////////////////////////////////////////////////////////
+	// ImageBlock
+
+	inline ImageBlock::ImageBlock(const ImageBlock &src) : ImageBlock()
+	{
+		*this = src;
+	}
+
+	inline ImageBlock::ImageBlock(ImageBlock &&src) : ImageBlock()
+	{
+		*this = std::move(src);
+	}
+
+	inline ImageBlock::ImageBlock(DataType ty, const Size2D<SizeType> &sz, SizeType d,
+		SizeType n, SizeType align, Init init) : ImageBlock()
+	{
+		this->Reset(ty, sz, d, n, align, init);
+	}
+
+	inline ImageBlock::Iterator ImageBlock::Begin(SizeType n, const Point2D<SizeType> &pt)
+	{
+		this->EvalPosition(n, pt);
+		return this->data_.begin() + this->GetOffset(n, pt);
+	}
+
+	inline ImageBlock::ConstIterator ImageBlock::Cbegin(SizeType n,
+		const Point2D<SizeType> &pt) const
+	{
+		this->EvalPosition(n, pt);
+		return this->data.cbegin() + this->GetOffset(n, pt);
+	}
+
+	inline ImageBlock::SizeType ImageBlock::GetOffset(SizeType n,
+		const Point2D<SizeType> &pt) const
+	{
+		return this->bytesPerFrame * n + this->bytesPerLine * pt.y +
+			GetNumBytes(this->dataType) * this->depth * pt.x;
+	}
+
+	template <typename BufferType>
+	void ImageBlock::PushTo(BufferType &buffer) const
+	{
+		std::vector<ImageFrame> frames;
+		frames.reserve(this->length);
+		for (SizeType n = 0; n != this->length; ++n)
+			frames.push_back(this->GetFrame(n));
+		buffer.push_n(frames.begin(), frames.size());
+	}
+
+	inline void ImageBlock::SetStorage(const std::shared_ptr<Storage> &storage)
+	{
+		this->data_.SetStorage(storage);
+	}
+
+	// ImageBlock
+	////////////////////////////////////////////////////////////////////////////////////////
+}
+
+#endif
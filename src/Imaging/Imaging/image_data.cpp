@@ -0,0 +1,125 @@
+#include <algorithm>
+#include <cstring>
+
+#include "copy.h"
+#include "image_data.h"
+
+namespace Imaging
+{
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Constructors.
+
+	ImageData::ImageData(const ImageData &src)
+	{
+		*this = src;
+	}
+
+	ImageData::ImageData(ImageData &&src)
+	{
+		*this = std::move(src);
+	}
+
+	ImageData &ImageData::operator=(const ImageData &src)
+	{
+		if (this != &src)
+			this->assign(src.cbegin(), src.cend());
+		return *this;
+	}
+
+	ImageData &ImageData::operator=(ImageData &&src)
+	{
+		if (this != &src)
+		{
+			this->owner_ = std::move(src.owner_);
+			this->begin_ = src.begin_;
+			this->size_ = src.size_;
+			src.begin_ = nullptr;
+			src.size_ = 0;
+		}
+		return *this;
+	}
+
+	// Constructors.
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Methods.
+
+	// Reuses the block if it has the same size and is not shared.
+	void ImageData::assign(const_iterator first, const_iterator last)
+	{
+		// Keeps the previous block until copied, as the source may be in it.
+		std::shared_ptr<void> old;
+		size_type n = static_cast<size_type>(last - first);
+		if (n != this->size_ || this->IsShared())
+		{
+			old = std::move(this->owner_);
+			this->owner_ = this->storage()->Allocate(n);
+			this->begin_ = static_cast<char *>(this->owner_.get());
+			this->size_ = n;
+		}
+		CopyLines(first, n, this->begin_, n, n, 1);
+	}
+
+	// An adopted block may start anywhere in the object of its owner.
+	bool ImageData::IsShared(void) const
+	{
+		return this->owner_.use_count() > 1 || this->begin_ != this->owner_.get();
+	}
+
+	void ImageData::clear(void)
+	{
+		this->owner_.reset();
+		this->begin_ = nullptr;
+		this->size_ = 0;
+	}
+
+	void ImageData::resize(size_type n, Init init)
+	{
+		if (n == this->size_)
+			return;
+
+		const std::shared_ptr<Storage> &storage = this->storage();
+		std::shared_ptr<void> block = storage->Allocate(n);
+		char *dst = static_cast<char *>(block.get());
+		size_type nKept = std::min(n, this->size_);
+		CopyLines(this->begin_, nKept, dst, nKept, nKept, 1);
+		if (init == Init::Zero && !storage->IsInitialized())
+			std::memset(dst + nKept, 0, n - nKept);
+
+		this->owner_ = std::move(block);
+		this->begin_ = dst;
+		this->size_ = n;
+	}
+
+	void ImageData::Adopt(char *src, size_type n, const std::shared_ptr<void> &owner)
+	{
+		if (n == 0)
+		{
+			this->clear();
+			return;
+		}
+		this->owner_ = owner;
+		this->begin_ = src;
+		this->size_ = n;
+	}
+
+	void ImageData::SetStorage(const std::shared_ptr<Storage> &storage)
+	{
+		this->storage_ = storage;
+	}
+
+	// Methods.
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	bool operator==(const ImageData &lhs, const ImageData &rhs)
+	{
+		return lhs.size() == rhs.size() && (lhs.data() == rhs.data() ||
+			std::memcmp(lhs.data(), rhs.data(), lhs.size()) == 0);
+	}
+
+	bool operator!=(const ImageData &lhs, const ImageData &rhs)
+	{
+		return !(lhs == rhs);
+	}
+}
@@ -0,0 +1,121 @@
+#if !defined(IMAGE_DATA_H)
+#define IMAGE_DATA_H
+
+#include <cstddef>
+#include <memory>
+
+#include "storage.h"
+
+namespace Imaging
+{
+	// Initialization of the bytes added by a resize.
+	enum struct Init
+	{
+		Zero,	// zero-filled as std::vector does.
+		None	// left as allocated, for a caller overwriting them anyway.
+	};
+
+	/* Contiguous bytes of image data with shared ownership.
+
+	This class is the container of ImageFrame, and it works as the std::vector<byte> it
+	replaces: copying an object copies the bytes, resize() keeps the existing bytes and
+	zero-fills the new ones unless Init::None, and an allocated block is aligned to
+	Alignment bytes.
+
+	Blocks are allocated by a Storage, the aligned heap unless SetStorage() selects another
+	backend (see storage.h). Blocks from a storage which initializes them, e.g. a mapped
+	file, are not zero-filled. The storage is a property of this object and is neither
+	copied nor moved with the data, e.g. a copy of an image in a mapped file goes to the
+	heap instead of mapping the same file.
+
+	The block is held by 'owner', a std::shared_ptr<void> whose deleter frees the block.
+	Other objects can keep the block alive by holding a copy of the owner, e.g. a cv::Mat
+	sharing the image data of an ImageFrame. The other way around, Adopt() refers to a block
+	owned by others, e.g. the data of a cv::Mat, without copying it; the owner must free
+	the block when it is destroyed.
+	While the block is shared, writing through any of the sharing objects is visible to all
+	of them. Operations changing the size (resize(), assign() with a different size)
+	allocate a new block and leave the others with the old one. So do assign() and copy
+	assignment to an object whose block IsShared(), as a copy must not overwrite the image
+	of others. */
+	class ImageData
+	{
+	public:
+		////////////////////////////////////////////////////////////////////////////////////
+		// Types and constants.
+		typedef char value_type;
+		typedef std::size_t size_type;
+		typedef char *iterator;
+		typedef const char *const_iterator;
+
+		static const std::size_t Alignment = Storage::Alignment;
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Default constructors.
+		ImageData(void) = default;
+		ImageData(const ImageData &src);
+		ImageData(ImageData &&src);
+		ImageData &operator=(const ImageData &src);
+		ImageData &operator=(ImageData &&src);
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Accessors.
+		iterator begin(void) { return this->begin_; }
+		iterator end(void) { return this->begin_ + this->size_; }
+		const_iterator begin(void) const { return this->begin_; }
+		const_iterator end(void) const { return this->begin_ + this->size_; }
+		const_iterator cbegin(void) const { return this->begin_; }
+		const_iterator cend(void) const { return this->begin_ + this->size_; }
+		char *data(void) { return this->begin_; }
+		const char *data(void) const { return this->begin_; }
+		char &operator[](size_type pos) { return this->begin_[pos]; }
+		const char &operator[](size_type pos) const { return this->begin_[pos]; }
+
+		bool empty(void) const { return this->size_ == 0; }
+		size_type size(void) const { return this->size_; }
+
+		// Holder of the block; empty if there is no data.
+		const std::shared_ptr<void> &owner(void) const { return this->owner_; }
+
+		/* True if other objects may refer to the block: the owner is held by others, or
+		the block is adopted from an owner which may share it, e.g. a cv::Mat. */
+		bool IsShared(void) const;
+
+		// Storage allocating the blocks of this object.
+		const std::shared_ptr<Storage> &storage(void) const
+		{
+			return this->storage_ ? this->storage_ : HeapStorage::GetInstance();
+		}
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Methods.
+		void assign(const_iterator first, const_iterator last);
+		void clear(void);
+
+		/* Allocates a new block unless the size is 'n'. With a MappedFileStorage, the file
+		is mapped again and the kept bytes are copied over the new mapping. */
+		void resize(size_type n, Init init = Init::Zero);
+
+		/* Refers to 'n' bytes at 'src' kept alive by 'owner' instead of copying them.
+		The alignment of 'src' is up to the owner. */
+		void Adopt(char *src, size_type n, const std::shared_ptr<void> &owner);
+
+		/* Selects the storage of the blocks allocated from now on; nullptr selects the heap.
+		The current block stays until the size changes. */
+		void SetStorage(const std::shared_ptr<Storage> &storage);
+
+	protected:
+		////////////////////////////////////////////////////////////////////////////////////
+		// Data.
+		std::shared_ptr<void> owner_;
+		char *begin_ = nullptr;
+		size_type size_ = 0;
+		// nullptr for the heap, which saves reference counting of the default.
+		std::shared_ptr<Storage> storage_;
+	};
+
+	bool operator==(const ImageData &lhs, const ImageData &rhs);
+	bool operator!=(const ImageData &lhs, const ImageData &rhs);
+}
+
+#endif
@@ -1,49 +1,169 @@
+#include <memory>
+#include <mutex>
+
+#include "copy.h"
 #include "opencv_interface.h"
 
 namespace Imaging
 {
-	cv::Mat CreateCvMat(const ImageFrame &imgSrc)
+	namespace Internal
 	{
-		cv::Mat cvDst = CreateCvMat(imgSrc.dataType, imgSrc.size, imgSrc.depth);
-
-		if (imgSrc.HaveZeroPaddingBytes())
-		{	// Copy entire data in one copy.
-#if defined(_MSC_VER)
-			std::copy_n(imgSrc.Cbegin(), imgSrc.data.size(),
-				stdext::checked_array_iterator<unsigned char *>(cvDst.ptr(), imgSrc.data.size()));
-#else
-			std::copy_n(imgSrc.Cbegin(), imgSrc.data.size(), cvDst.ptr());
-#endif
+		/* Reference count of cv::Mat objects sharing the image data of ImageFrame objects.
+		A cv::Mat only knows the address of 'refcount', so it is the first member. */
+		struct SharedBlock
+		{
+			int refcount;
+			std::shared_ptr<void> *owner;
+		};
+
+		int *CreateSharedBlock(const std::shared_ptr<void> &owner)
+		{
+			std::unique_ptr<std::shared_ptr<void>> ownerNew(new std::shared_ptr<void>(owner));
+			SharedBlock *block = new SharedBlock;
+			block->refcount = 1;
+			block->owner = ownerNew.release();
+			return &block->refcount;
 		}
-		else
-		{	// Compute effective bytes/line, and copy only the effective bytes line by line.
-			auto bytes_line = cvDst.cols * cvDst.channels() * cvDst.elemSize1();
-#if defined(_MSC_VER)
-			auto bytes_total = bytes_line * imgSrc.size.height;
-			Utilities::CopyLines(imgSrc.Cbegin(), imgSrc.bytesPerLine,
-				stdext::checked_array_iterator<unsigned char *>(cvDst.ptr(), bytes_total),
-				bytes_line, bytes_line, imgSrc.size.height);
-#else
-			Utilities::CopyLines(imgSrc.Cbegin(), imgSrc.bytesPerLine,
-				cvDst.ptr(), bytes_line, bytes_line, imgSrc.size.height);
-#endif
+
+		/* Keeps the image data alive while cv::Mat objects refer to it.
+		OpenCV 2.4 calls deallocate() when the last cv::Mat sharing the data is released, and
+		allocate() when one of them is reallocated by cv::Mat::create(), e.g. as the output
+		of an OpenCV function. The new data is allocated as an ImageFrame does, so
+		CreateImageFrameShared() shares it back without holding the cv::Mat. */
+		class FrameAllocator : public cv::MatAllocator
+		{
+		public:
+			void allocate(int dims, const int *sizes, int type, int *&refcount,
+				uchar *&datastart, uchar *&data, size_t *step) override
+			{
+				// Continuous data as cv::Mat::create() lays it out.
+				std::size_t bytes_total = CV_ELEM_SIZE(type);
+				for (int n = dims - 1; n >= 0; --n)
+				{
+					step[n] = bytes_total;
+					bytes_total *= sizes[n];
+				}
+
+				std::shared_ptr<void> owner =
+					HeapStorage::GetInstance()->Allocate(bytes_total);
+				refcount = CreateSharedBlock(owner);
+				datastart = data = static_cast<uchar *>(owner.get());
+			}
+
+			void deallocate(int *refcount, uchar *, uchar *) override
+			{
+				SharedBlock *block = reinterpret_cast<SharedBlock *>(refcount);
+				delete block->owner;
+				delete block;
+			}
+		};
+
+		/* Singleton; see Internal::poolFlag in thread_pool.cpp. Never destroyed, so cv::Mat
+		objects can still be released during the destruction of static objects. */
+		std::once_flag frameAllocatorFlag;
+		FrameAllocator *frameAllocator = nullptr;
+
+		cv::MatAllocator *GetFrameAllocator(void)
+		{
+			std::call_once(frameAllocatorFlag, [](void)
+			{
+				frameAllocator = new FrameAllocator;
+			});
+			return frameAllocator;
 		}
+
+		/* Makes an ImageFrame refer to the data of a cv::Mat if its lines are laid out with a
+		line alignment, and returns false otherwise or if the cv::Mat is empty. */
+		bool AdoptCvMat(const cv::Mat &cvSrc, ImageFrame &imgDst)
+		{
+			if (cvSrc.empty())
+				return false;
+			if (cvSrc.dims != 2)
+				throw std::runtime_error(
+				"Only a cv::Mat object with 2 dimensions is supported.");
+
+			// The last line is padded as well, so its padding bytes must be within the data.
+			ImageFrame::ByteType *src = reinterpret_cast<ImageFrame::ByteType *>(cvSrc.data);
+			auto ty = GetDataType(cvSrc.depth());
+			ImageSize sz;
+			Utilities::Cast(cvSrc.cols, sz.width);
+			Utilities::Cast(cvSrc.rows, sz.height);
+			if (cvSrc.data + cvSrc.step[0] * cvSrc.rows > cvSrc.datalimit ||
+				ImageFrame::FindAlignment(src, ty, sz.width, cvSrc.channels(),
+				cvSrc.step[0]) == 0)
+				return false;
+
+			// Share the reference of a cv::Mat created by CreateCvMatShared(), or hold a
+			// cv::Mat.
+			std::shared_ptr<void> owner;
+			if (cvSrc.allocator == GetFrameAllocator())
+				owner = *reinterpret_cast<SharedBlock *>(cvSrc.refcount)->owner;
+			else
+				owner = std::make_shared<cv::Mat>(cvSrc);
+
+			imgDst.Adopt(src, ty, sz, cvSrc.channels(), cvSrc.step[0], owner);
+			return true;
+		}
+	}
+
+	cv::Mat CreateCvMat(const ImageFrame &imgSrc)
+	{
+		return CreateCvMat(ConstImageView(imgSrc));
+	}
+
+	cv::Mat CreateCvMat(const ConstImageView &viewSrc)
+	{
+		cv::Mat cvDst = CreateCvMat(viewSrc.dataType, viewSrc.size, viewSrc.depth);
+		if (viewSrc.IsEmpty())
+			return cvDst;
+
+		// Compute effective bytes/line.
+		auto bytes_line = cvDst.cols * cvDst.channels() * cvDst.elemSize1();
+
+		// Copy entire data in one copy if there is no padding byte, line by line otherwise.
+		CopyLines(viewSrc.Cbegin(), viewSrc.bytesPerLine,
+			reinterpret_cast<ImageFrame::ByteType *>(cvDst.ptr()), bytes_line, bytes_line,
+			viewSrc.size.height);
 		return cvDst;
 	}
 
-	// Run only if source image frame does not have padding bytes.
 	cv::Mat CreateCvMatShared(ImageFrame &imgSrc)
 	{
-		if (imgSrc.HaveZeroPaddingBytes())
-		{
-			auto it = imgSrc.Begin();
-			return cv::Mat(Utilities::Cast<int>(imgSrc.size.height),
-				Utilities::Cast<int>(imgSrc.size.width),
-				GetOpenCvType(imgSrc.dataType, imgSrc.depth), &(*it));
+		if (imgSrc.data.empty())
+			return cv::Mat();
+
+		cv::Mat cvDst(Utilities::Cast<int>(imgSrc.size.height),
+			Utilities::Cast<int>(imgSrc.size.width),
+			GetOpenCvType(imgSrc.dataType, imgSrc.depth), imgSrc.Begin(), imgSrc.bytesPerLine);
+
+		// Hand a reference to the image data over to the cv::Mat.
+		cvDst.refcount = Internal::CreateSharedBlock(imgSrc.data.owner());
+		cvDst.allocator = Internal::GetFrameAllocator();
+		return cvDst;
+	}
+
+	ImageFrame CreateImageFrame(cv::Mat &&cvSrc)
+	{
+		ImageFrame imgDst;
+		if (!Internal::AdoptCvMat(cvSrc, imgDst) && !cvSrc.empty())
+		{	// Copy the effective bytes of each line.
+			ImageSize sz;
+			Utilities::Cast(cvSrc.cols, sz.width);
+			Utilities::Cast(cvSrc.rows, sz.height);
+			imgDst.CopyFrom(reinterpret_cast<const ImageFrame::ByteType *>(cvSrc.ptr()),
+				GetDataType(cvSrc.depth()), sz, cvSrc.channels(), cvSrc.step[0]);
 		}
-		else
-			throw std::runtime_error(
-			"Cannot create a Cv::Mat object with shared memory because of padding bytes.");
+		cvSrc.release();
+		return imgDst;
+	}
+
+	ImageFrame CreateImageFrameShared(const cv::Mat &cvSrc)
+	{
+		ImageFrame imgDst;
+		if (!Internal::AdoptCvMat(cvSrc, imgDst) && !cvSrc.empty())
+			throw std::runtime_error("Cannot create an ImageFrame object with shared memory "
+			"because the lines are not laid out with a line alignment.");
+		return imgDst;
 	}
 
 	DataType GetDataType(int cvType)
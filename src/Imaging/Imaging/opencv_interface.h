@@ -5,12 +5,31 @@
 
 #include "utilities/algorithms.h"
 #include "image.h"
+#include "view.h"
 
 namespace Imaging
 {
 	cv::Mat CreateCvMat(DataType ty, const ImageSize &sz, ImageFrame::SizeType d);
 	cv::Mat CreateCvMat(const ImageFrame &imgSrc);
+	cv::Mat CreateCvMat(const ConstImageView &viewSrc);
+
+	/* Creates a cv::Mat object sharing the image data with an ImageFrame, padding bytes
+	included. The cv::Mat keeps the image data alive even after the ImageFrame is destroyed
+	or resized. */
 	cv::Mat CreateCvMatShared(ImageFrame &imgSrc);
+
+	/* Creates an ImageFrame object taking over the data of a cv::Mat, e.g. an image loaded
+	by cv::imread(), so the data is not copied once more. The source is released.
+	The data is copied only if its lines are not laid out with a line alignment (see
+	ImageFrame::Adopt()), e.g. an ROI of a larger cv::Mat. */
+	ImageFrame CreateImageFrame(cv::Mat &&cvSrc);
+
+	/* Creates an ImageFrame object sharing the data with a cv::Mat, which is the reverse of
+	CreateCvMatShared(). The ImageFrame keeps the data alive as a cv::Mat does.
+	Throws std::runtime_error if the lines of the cv::Mat are not laid out with a line
+	alignment (see ImageFrame::Adopt()), e.g. an ROI of a larger cv::Mat; copy it then. */
+	ImageFrame CreateImageFrameShared(const cv::Mat &cvSrc);
+
 	DataType GetDataType(int cvType);
 	int GetOpenCvType(DataType ty, std::size_t d);
 }
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <stdexcept>
+
+#include "parallel.h"
+#include "thread_pool.h"
+
+namespace Imaging
+{
+	namespace Internal
+	{
+		/* Neighboring bands have neighboring indices, so the work stealing pool keeps them
+		on the same core. */
+		template <typename V>
+		void ParallelForRows(const V &img,
+			const std::function<void(const V &, const ImageFrame::ROI &)> &func,
+			ImageFrame::SizeType minLines)
+		{
+			if (img.IsEmpty())
+				return;
+
+			ThreadPool &pool = ThreadPool::GetInstance();
+			const auto height = img.size.height;
+			const std::size_t nBands = std::max<std::size_t>(1, std::min(
+				pool.GetNumThreads() * BandsPerThread,
+				height / std::max<ImageFrame::SizeType>(1, minLines)));
+			pool.ParallelFor(nBands, [&](std::size_t n)
+			{
+				ImageFrame::SizeType first = height * n / nBands;
+				ImageFrame::SizeType last = height * (n + 1) / nBands;
+				ImageFrame::ROI roi(Point2D<ImageFrame::SizeType>(0, first),
+					ImageSize(img.size.width, last - first));
+				func(img.SubView(roi), roi);
+			});
+		}
+
+		// The tiles are numbered row by row.
+		template <typename V>
+		void ParallelForTiles(const V &img, const ImageSize &tileSize,
+			const std::function<void(const V &, const ImageFrame::ROI &)> &func)
+		{
+			if (tileSize.width == 0 || tileSize.height == 0)
+				throw std::invalid_argument("A tile must have at least one pixel.");
+			if (img.IsEmpty())
+				return;
+
+			const ImageSize numTiles((img.size.width + tileSize.width - 1) / tileSize.width,
+				(img.size.height + tileSize.height - 1) / tileSize.height);
+			ThreadPool::GetInstance().ParallelFor(numTiles.width * numTiles.height,
+				[&](std::size_t n)
+			{
+				Point2D<ImageFrame::SizeType> orgn(n % numTiles.width * tileSize.width,
+					n / numTiles.width * tileSize.height);
+				ImageFrame::ROI roi(orgn, ImageSize(
+					std::min(tileSize.width, img.size.width - orgn.x),
+					std::min(tileSize.height, img.size.height - orgn.y)));
+				func(img.SubView(roi), roi);
+			});
+		}
+	}
+
+	void ParallelForRows(const ImageView &img,
+		const std::function<void(const ImageView &, const ImageFrame::ROI &)> &func,
+		ImageFrame::SizeType minLines)
+	{
+		Internal::ParallelForRows(img, func, minLines);
+	}
+
+	void ParallelForRows(const ConstImageView &img,
+		const std::function<void(const ConstImageView &, const ImageFrame::ROI &)> &func,
+		ImageFrame::SizeType minLines)
+	{
+		Internal::ParallelForRows(img, func, minLines);
+	}
+
+	void ParallelForTiles(const ImageView &img, const ImageSize &tileSize,
+		const std::function<void(const ImageView &, const ImageFrame::ROI &)> &func)
+	{
+		Internal::ParallelForTiles(img, tileSize, func);
+	}
+
+	void ParallelForTiles(const ConstImageView &img, const ImageSize &tileSize,
+		const std::function<void(const ConstImageView &, const ImageFrame::ROI &)> &func)
+	{
+		Internal::ParallelForTiles(img, tileSize, func);
+	}
+
+	void ParallelForRows(ImageFrame &img,
+		const std::function<void(const ImageView &, const ImageFrame::ROI &)> &func,
+		ImageFrame::SizeType minLines)
+	{
+		Internal::ParallelForRows(ImageView(img), func, minLines);
+	}
+
+	void ParallelForRows(const ImageFrame &img,
+		const std::function<void(const ConstImageView &, const ImageFrame::ROI &)> &func,
+		ImageFrame::SizeType minLines)
+	{
+		Internal::ParallelForRows(ConstImageView(img), func, minLines);
+	}
+
+	void ParallelForTiles(ImageFrame &img, const ImageSize &tileSize,
+		const std::function<void(const ImageView &, const ImageFrame::ROI &)> &func)
+	{
+		Internal::ParallelForTiles(ImageView(img), tileSize, func);
+	}
+
+	void ParallelForTiles(const ImageFrame &img, const ImageSize &tileSize,
+		const std::function<void(const ConstImageView &, const ImageFrame::ROI &)> &func)
+	{
+		Internal::ParallelForTiles(ConstImageView(img), tileSize, func);
+	}
+}
@@ -0,0 +1,53 @@
+#if !defined(PARALLEL_H)
+#define PARALLEL_H
+
+#include <functional>
+
+#include "image.h"
+#include "view.h"
+
+namespace Imaging
+{
+	/* Runs an image operation on parts of an image across ThreadPool::GetInstance().
+
+	ParallelForRows() splits the image into bands of whole lines, and ParallelForTiles()
+	into tiles of the given size (smaller at the right and bottom borders). 'func' is
+	called once per part with a view of the part and its ROI in the image, e.g. to take the
+	same part of another image of the same size with SubView(). The parts do not overlap,
+	so 'func' may write its part without a lock.
+
+	The bands are at least 'minLines' lines, e.g. enough lines for a band to be worth
+	scheduling, and at most BandsPerThread bands are made per thread so a core that falls
+	behind hands its bands over to the others. A single band runs on the calling thread.
+	As ThreadPool::ParallelFor(), the first exception thrown by 'func' is rethrown after
+	every part is done. */
+
+	// Maximum number of bands per thread of the pool.
+	const std::size_t BandsPerThread = 4;
+
+	void ParallelForRows(const ImageView &img,
+		const std::function<void(const ImageView &, const ImageFrame::ROI &)> &func,
+		ImageFrame::SizeType minLines = 1);
+	void ParallelForRows(const ConstImageView &img,
+		const std::function<void(const ConstImageView &, const ImageFrame::ROI &)> &func,
+		ImageFrame::SizeType minLines = 1);
+
+	void ParallelForTiles(const ImageView &img, const ImageSize &tileSize,
+		const std::function<void(const ImageView &, const ImageFrame::ROI &)> &func);
+	void ParallelForTiles(const ConstImageView &img, const ImageSize &tileSize,
+		const std::function<void(const ConstImageView &, const ImageFrame::ROI &)> &func);
+
+	// An ImageFrame converts to either view; these pick ImageView or ConstImageView.
+	void ParallelForRows(ImageFrame &img,
+		const std::function<void(const ImageView &, const ImageFrame::ROI &)> &func,
+		ImageFrame::SizeType minLines = 1);
+	void ParallelForRows(const ImageFrame &img,
+		const std::function<void(const ConstImageView &, const ImageFrame::ROI &)> &func,
+		ImageFrame::SizeType minLines = 1);
+	void ParallelForTiles(ImageFrame &img, const ImageSize &tileSize,
+		const std::function<void(const ImageView &, const ImageFrame::ROI &)> &func);
+	void ParallelForTiles(const ImageFrame &img, const ImageSize &tileSize,
+		const std::function<void(const ConstImageView &, const ImageFrame::ROI &)> &func);
+}
+
+#endif
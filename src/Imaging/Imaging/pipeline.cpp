@@ -0,0 +1,264 @@
+#include <sstream>
+#include <stdexcept>
+
+#include "pipeline.h"
+
+namespace Imaging
+{
+	namespace Internal
+	{
+		// Output of a stage not connected yet.
+		const std::size_t NoOutput = static_cast<std::size_t>(-1);
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Pipeline
+
+	Pipeline::Pipeline(void) : failed_(false), stop_(false)
+	{}
+
+	// Drains the stages without rethrowing their exception.
+	Pipeline::~Pipeline(void)
+	{
+		this->Stop();
+		for (auto &thread : this->threads_)
+			if (thread.joinable())
+				thread.join();
+	}
+
+	std::size_t Pipeline::AddSource(const SourceFunc &func, std::size_t nThreads)
+	{
+		return this->AddStage(Kind::Source, func, nThreads, 0);
+	}
+
+	std::size_t Pipeline::AddTransform(const TransformFunc &func, std::size_t nThreads,
+		std::size_t capacity)
+	{
+		return this->AddStage(Kind::Transform, func, nThreads, capacity);
+	}
+
+	std::size_t Pipeline::AddSink(const SinkFunc &func, std::size_t nThreads,
+		std::size_t capacity)
+	{
+		return this->AddStage(Kind::Sink, [func](ImageFrame &img)
+		{
+			func(img);
+			return true;
+		}, nThreads, capacity);
+	}
+
+	std::size_t Pipeline::AddStage(Kind kind, const std::function<bool(ImageFrame &)> &func,
+		std::size_t nThreads, std::size_t capacity)
+	{
+		if (!this->threads_.empty())
+			throw std::logic_error("The pipeline is already started.");
+		if (nThreads == 0 || (kind != Kind::Source && capacity == 0))
+			throw std::invalid_argument("A stage must have a thread and room for a frame.");
+
+		std::unique_ptr<Stage> stage(new Stage());
+		stage->kind = kind;
+		stage->func = func;
+		stage->nThreads = nThreads;
+		if (kind != Kind::Source)
+			stage->input.reset(new ImageBuffer(capacity));
+		stage->output = Internal::NoOutput;
+		stage->nProducers = 0;
+		this->stages_.push_back(std::move(stage));
+		return this->stages_.size() - 1;
+	}
+
+	void Pipeline::Connect(std::size_t from, std::size_t to)
+	{
+		this->EvalStage(from);
+		this->EvalStage(to);
+		if (!this->threads_.empty())
+			throw std::logic_error("The pipeline is already started.");
+
+		Stage &src = *this->stages_[from];
+		Stage &dst = *this->stages_[to];
+		std::ostringstream errMsg;
+		if (src.kind == Kind::Sink)
+			errMsg << "Stage " << from << " is a sink, which has no output.";
+		else if (dst.kind == Kind::Source)
+			errMsg << "Stage " << to << " is a source, which has no input.";
+		else if (src.output != Internal::NoOutput)
+			errMsg << "Stage " << from << " is already connected to stage " <<
+				src.output << ".";
+		else if (from == to)
+			errMsg << "Stage " << from << " cannot be connected to itself.";
+		if (!errMsg.str().empty())
+			throw std::invalid_argument(errMsg.str());
+
+		src.output = to;
+	}
+
+	const ImageBuffer &Pipeline::GetInput(std::size_t stage) const
+	{
+		this->EvalStage(stage);
+		if (!this->stages_[stage]->input)
+		{
+			std::ostringstream errMsg;
+			errMsg << "Stage " << stage << " is a source, which has no input.";
+			throw std::invalid_argument(errMsg.str());
+		}
+		return *this->stages_[stage]->input;
+	}
+
+	void Pipeline::SetOverflow(std::size_t stage, Overflow policy,
+		const std::chrono::milliseconds &timeout)
+	{
+		this->GetInput(stage);
+		this->stages_[stage]->input->SetOverflow(policy, timeout);
+	}
+
+	void Pipeline::Run(void)
+	{
+		this->Start();
+		this->Wait();
+	}
+
+	void Pipeline::Start(void)
+	{
+		if (!this->threads_.empty())
+			throw std::logic_error("The pipeline is already started.");
+		this->EvalGraph();
+
+		for (auto &stage : this->stages_)
+			if (stage->output != Internal::NoOutput)
+				this->stages_[stage->output]->nProducers += stage->nThreads;
+
+		for (std::size_t n = 0; n != this->stages_.size(); ++n)
+			for (std::size_t m = 0; m != this->stages_[n]->nThreads; ++m)
+				this->threads_.push_back(std::thread(&Pipeline::Work, this, n));
+	}
+
+	void Pipeline::Wait(void)
+	{
+		for (auto &thread : this->threads_)
+			if (thread.joinable())
+				thread.join();
+		if (this->error_)
+			std::rethrow_exception(this->error_);
+	}
+
+	void Pipeline::Stop(void)
+	{
+		this->stop_ = true;
+	}
+
+	/* Every stage must lead to a sink; following the outputs from a stage in a loop
+	never reaches one. */
+	void Pipeline::EvalGraph(void) const
+	{
+		std::vector<std::size_t> nInputs(this->stages_.size(), 0);
+		for (const auto &stage : this->stages_)
+			if (stage->output != Internal::NoOutput)
+				++nInputs[stage->output];
+
+		for (std::size_t n = 0; n != this->stages_.size(); ++n)
+		{
+			const Stage &stage = *this->stages_[n];
+			std::ostringstream errMsg;
+			if (stage.kind != Kind::Sink && stage.output == Internal::NoOutput)
+				errMsg << "Stage " << n << " has no output.";
+			else if (stage.kind != Kind::Source && nInputs[n] == 0)
+				errMsg << "Stage " << n << " has no input.";
+			else
+			{
+				std::size_t next = n;
+				for (std::size_t m = 0; m != this->stages_.size() &&
+					this->stages_[next]->kind != Kind::Sink; ++m)
+					next = this->stages_[next]->output;
+				if (this->stages_[next]->kind != Kind::Sink)
+					errMsg << "Stage " << n << " does not lead to a sink.";
+			}
+			if (!errMsg.str().empty())
+				throw std::logic_error(errMsg.str());
+		}
+	}
+
+	void Pipeline::EvalStage(std::size_t stage) const
+	{
+		if (stage >= this->stages_.size())
+		{
+			std::ostringstream errMsg;
+			errMsg << "Stage " << stage << " is out of range (" << this->stages_.size() <<
+				" stages).";
+			throw std::out_of_range(errMsg.str());
+		}
+	}
+
+	void Pipeline::Fail(void)
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			if (!this->error_)
+				this->error_ = std::current_exception();
+		}
+		this->failed_ = true;
+		this->stop_ = true;
+	}
+
+	/* Runs one thread of a stage until the end of its input, or until the source is done,
+	and then the last thread feeding the next stage closes its input. */
+	void Pipeline::Work(std::size_t stage)
+	{
+		Stage &self = *this->stages_[stage];
+		Stage *next = nullptr;
+		if (self.output != Internal::NoOutput)
+			next = this->stages_[self.output].get();
+		ImageFrame img;
+		for (;;)
+		{
+			if (self.kind == Kind::Source)
+			{
+				if (this->stop_)
+					break;
+				try
+				{
+					if (!self.func(img))
+						break;
+				}
+				catch (...)
+				{
+					this->Fail();
+					break;
+				}
+			}
+			else
+			{
+				// Waits again on time-out; only an end marker finishes the stage.
+				if (!self.input->try_pop(img))
+					continue;
+				if (img.data.empty())
+					break;
+				if (this->failed_)
+					continue;	// discards the frames in flight.
+				try
+				{
+					if (!self.func(img))
+						continue;
+				}
+				catch (...)
+				{
+					this->Fail();
+					continue;
+				}
+			}
+
+			if (next && !img.data.empty())
+				next->input->push(std::move(img));
+		}
+
+		if (next && --next->nProducers == 0)
+		{
+			// An end marker must not be dropped per the overflow policy.
+			next->input->SetOverflow(Overflow::Block);
+			for (std::size_t n = 0; n != next->nThreads; ++n)
+				next->input->push(ImageFrame());
+		}
+	}
+
+	// Pipeline
+	////////////////////////////////////////////////////////////////////////////////////////
+}
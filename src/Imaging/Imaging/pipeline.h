@@ -0,0 +1,118 @@
+#if !defined(PIPELINE_H)
+#define PIPELINE_H
+
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "buffer.h"
+#include "image.h"
+
+namespace Imaging
+{
+	/* Graph of stages passing frames through bounded ImageBuffers, e.g.
+	camera -> flat field correction (4 threads) -> inspection -> archive.
+
+	Stages.
+	A source fills a frame and returns false at the end of its stream, a transform modifies
+	or replaces a frame and returns false to drop it, and a sink takes a frame. Every stage
+	runs on its own 'nThreads' threads, which call the function at the same time if more
+	than one; the frames may then leave the stage in a different order than they entered.
+	Empty frames are not passed on; they mark the end of a stream internally.
+
+	Connections.
+	Connect(from, to) sends the frames of 'from' to the input buffer of 'to'. A source or a
+	transform has exactly one output, and a transform or a sink takes one or more inputs.
+	Each input buffer holds up to 'capacity' frames, and a stage waits for room in the next
+	one, so a slow stage holds up the stages before it back to the sources (back-pressure).
+	SetOverflow() selects another policy for an input, e.g. Overflow::DropOldest for a live
+	preview that must not hold up the acquisition.
+
+	Shutdown.
+	When every thread feeding a stage is done, the last one closes the input of the stage
+	by queuing one end marker per thread of the stage behind the remaining frames, so
+	every frame is processed before the stage finishes in turn. Stop() ends the sources
+	early with the same draining. If a stage throws, the sources are stopped, the frames in
+	flight are discarded, and Wait() rethrows the first exception.
+
+	The stages run on threads of their own instead of ThreadPool::GetInstance(), because
+	they block on the buffers; a stage may use ParallelFor() or parallel.h inside. */
+	class Pipeline
+	{
+	public:
+		typedef std::function<bool(ImageFrame &)> SourceFunc;
+		typedef std::function<bool(ImageFrame &)> TransformFunc;
+		typedef std::function<void(ImageFrame &)> SinkFunc;
+
+		Pipeline(void);
+		~Pipeline(void);
+		Pipeline(const Pipeline &) = delete;
+		Pipeline &operator=(const Pipeline &) = delete;
+
+		// Each returns the index of the new stage.
+		std::size_t AddSource(const SourceFunc &func, std::size_t nThreads = 1);
+		std::size_t AddTransform(const TransformFunc &func, std::size_t nThreads = 1,
+			std::size_t capacity = 8);
+		std::size_t AddSink(const SinkFunc &func, std::size_t nThreads = 1,
+			std::size_t capacity = 8);
+
+		void Connect(std::size_t from, std::size_t to);
+
+		// Input buffer of a transform or a sink, e.g. for its stats().
+		const ImageBuffer &GetInput(std::size_t stage) const;
+		void SetOverflow(std::size_t stage, Overflow policy,
+			const std::chrono::milliseconds &timeout = std::chrono::milliseconds(0));
+
+		/* Start() checks the graph and starts the threads, Wait() returns when every stage
+		is finished, and Run() does both. */
+		void Run(void);
+		void Start(void);
+		void Wait(void);
+
+		// Ends the sources after the frames they are filling; the rest is drained.
+		void Stop(void);
+
+	protected:
+		enum class Kind
+		{
+			Source,
+			Transform,
+			Sink
+		};
+
+		struct Stage
+		{
+			Kind kind;
+			std::function<bool(ImageFrame &)> func;
+			std::size_t nThreads;
+			std::unique_ptr<ImageBuffer> input;
+			std::size_t output;
+
+			// Threads of the stages feeding this one, which are not done yet.
+			std::atomic_size_t nProducers;
+		};
+
+		std::size_t AddStage(Kind kind, const std::function<bool(ImageFrame &)> &func,
+			std::size_t nThreads, std::size_t capacity);
+		void EvalGraph(void) const;
+		void EvalStage(std::size_t stage) const;
+
+		// Records the exception being handled, and stops the sources.
+		void Fail(void);
+
+		void Work(std::size_t stage);
+
+		std::vector<std::unique_ptr<Stage>> stages_;
+		std::vector<std::thread> threads_;
+		std::atomic_bool failed_;
+		std::atomic_bool stop_;
+		std::exception_ptr error_;
+		std::mutex mutex_;
+	};
+}
+
+#endif
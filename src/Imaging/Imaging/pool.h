@@ -0,0 +1,119 @@
+#if !defined(POOL_H)
+#define POOL_H
+
+#include <mutex>
+#include <vector>
+#include <atomic>
+
+#include "image.h"
+
+namespace Imaging
+{
+	/* Thread safe pool of pre-allocated image frames with an identical dimension.
+
+	Allocating and freeing a multi-megabyte frame for every captured image ends up in
+	mmap()/munmap() and page faults on every frame. A producer takes a frame from the pool
+	instead of creating a new one, and a consumer returns the frame when it is done with
+	it, so the same memory blocks circulate in steady state.
+
+	acquire() allocates a new frame only if the pool is empty, and leaves its image data
+	uninitialized as a recycled frame holds a previous image anyway. release() does not
+	take a frame whose dimension does not match the pool or when the pool is already
+	holding 'capacity' frames; such a frame is left with the caller and freed as usual.
+	Neither does it take a frame whose data block is shared (see ImageData::IsShared()),
+	e.g. with a cv::Mat or an ImageBlock, as the next producer would overwrite it.
+
+	ImageBuffer and SpscImageBuffer can return the frames overwritten by try_pop() to a pool
+	automatically. See buffer.h. */
+	class FramePool
+	{
+	public:
+		FramePool(DataType ty, const ImageSize &sz, ImageSizeType d, std::size_t capacity,
+			ImageSizeType align = 1);
+		ImageFrame acquire(void);
+		void release(ImageFrame &&img);
+
+		// Number of frames currently held by the pool.
+		std::size_t available(void);
+
+		// Number of frames allocated because the pool was empty (excluding the initial ones).
+		std::size_t misses(void) const;
+
+	protected:
+		bool IsMatched(const ImageFrame &img) const;
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Dimension of the frames.
+		ImageSizeType alignment_ = 1;
+		DataType dataType_ = DataType::UNDEFINED;
+		ImageSizeType depth_ = 0;
+		ImageSize size_ = ImageSize(0, 0);
+
+		std::size_t capacity_ = 0;
+		std::vector<ImageFrame> frames_;
+		std::atomic_size_t misses_;
+		std::mutex mutex_;
+	};
+}
+
+namespace Imaging
+{
+	inline FramePool::FramePool(DataType ty, const ImageSize &sz, ImageSizeType d,
+		std::size_t capacity, ImageSizeType align) : alignment_(align), dataType_(ty),
+		depth_(d), capacity_(capacity), misses_(0)
+	{
+		this->size_ = sz;
+
+		// Reserve first, so release() never reallocates the std::vector.
+		this->frames_.reserve(this->capacity_);
+		for (std::size_t n = 0; n != this->capacity_; ++n)
+			this->frames_.push_back(ImageFrame(ty, sz, d, align));
+	}
+
+	inline ImageFrame FramePool::acquire(void)
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			if (!this->frames_.empty())
+			{
+				ImageFrame img = std::move(this->frames_.back());
+				this->frames_.pop_back();
+				return img;
+			}
+		}
+
+		// Allocate outside of the lock if the pool is empty.
+		++this->misses_;
+		return ImageFrame(this->dataType_, this->size_, this->depth_, this->alignment_,
+			Init::None);
+	}
+
+	inline void FramePool::release(ImageFrame &&img)
+	{
+		if (!this->IsMatched(img))
+			return;
+
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		if (this->frames_.size() != this->capacity_)
+			this->frames_.push_back(std::move(img));
+	}
+
+	inline std::size_t FramePool::available(void)
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		return this->frames_.size();
+	}
+
+	inline std::size_t FramePool::misses(void) const
+	{
+		return this->misses_.load();
+	}
+
+	inline bool FramePool::IsMatched(const ImageFrame &img) const
+	{
+		return img.dataType == this->dataType_ && img.size == this->size_ &&
+			img.depth == this->depth_ && img.alignment == this->alignment_ &&
+			!img.data.empty() && !img.data.IsShared();
+	}
+}
+#endif
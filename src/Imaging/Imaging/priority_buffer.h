@@ -0,0 +1,321 @@
+#if !defined(PRIORITY_BUFFER_H)
+#define PRIORITY_BUFFER_H
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "buffer.h"
+#include "image.h"
+#include "pool.h"
+
+namespace Imaging
+{
+	/* Thread safe image queue buffer with several lanes of priority, e.g. live inspection
+	frames in lane 0 ahead of archival or reprocessing frames in the lanes after.
+
+	Each lane is a FIFO with its own capacity, so a backlog of bulk frames never fills the
+	room of the urgent ones; push() waits only if its own lane is full.
+
+	Scheduling.
+	Without weights, try_pop() takes the oldest frame of the lane with the lowest index
+	among the non-empty ones (strict priority), so the latency of an urgent frame does not
+	depend on how many frames are queued in the lanes after it.
+	With weights, the lanes are served in rounds, and lane i gives up its turn after
+	weights[i] frames in a round while a lower priority lane has frames; e.g. weights of
+	{ 8, 1 } keep a steady stream of urgent frames from starving the bulk frames. A new
+	round starts once every non-empty lane has used up its share.
+	The lane is picked from a bit mask of the non-empty lanes (and of the lanes with a share
+	left) by its lowest set bit, so popping takes constant time with any number of lanes,
+	without scanning them; only starting a round visits every lane.
+
+	Frame recycling and the wait time of try_pop() are the same as those of ImageBuffer. */
+	class PriorityImageBuffer
+	{
+	public:
+		// Maximum number of lanes; one bit per lane.
+		static const std::size_t MaxLanes = 32;
+
+		/* One lane per element of 'capacities'. The weights are optional, and must be as
+		many as the lanes if given. */
+		PriorityImageBuffer(const std::vector<std::size_t> &capacities,
+			const std::vector<std::size_t> &weights = std::vector<std::size_t>());
+		PriorityImageBuffer(const std::vector<std::size_t> &capacities,
+			const std::vector<std::size_t> &weights, FramePool &pool);
+		PriorityImageBuffer(const PriorityImageBuffer &) = delete;
+		PriorityImageBuffer &operator=(const PriorityImageBuffer &) = delete;
+
+		void push(std::size_t lane, ImageFrame &&imgSrc);
+		bool try_pop(ImageFrame &imgDst);
+		template <typename Rep, typename Period>
+		bool try_pop(ImageFrame &imgDst,
+			const std::chrono::duration<Rep, Period> &wait_time);
+		bool try_pop(ImageFrame &imgDst,
+			const std::chrono::steady_clock::time_point &deadline);
+		bool try_pop_now(ImageFrame &imgDst);
+
+		// Also return the lane the frame is taken from.
+		bool try_pop(ImageFrame &imgDst, std::size_t &lane);
+		template <typename Rep, typename Period>
+		bool try_pop(ImageFrame &imgDst, std::size_t &lane,
+			const std::chrono::duration<Rep, Period> &wait_time);
+		bool try_pop(ImageFrame &imgDst, std::size_t &lane,
+			const std::chrono::steady_clock::time_point &deadline);
+		bool try_pop_now(ImageFrame &imgDst, std::size_t &lane);
+
+		std::size_t lanes(void) const;
+
+	protected:
+		struct Lane
+		{
+			std::vector<ImageFrame> data;
+			std::size_t back = 0;
+			std::size_t count = 0;
+			std::size_t front = 0;
+
+			// Frames per round, and frames left in the current round.
+			std::size_t weight = 0;
+			std::size_t credit = 0;
+
+			std::condition_variable not_full;
+		};
+
+		// Index of the lowest set bit of a non-zero mask (de Bruijn sequence).
+		static std::size_t FindLowestBit(std::uint32_t mask);
+
+		// Lane to pop from next; at least one lane must have frames.
+		std::size_t SelectLane(void);
+
+		// Moves the next frame to imgDst, and the previous one to imgOld for the pool.
+		void PopFront(ImageFrame &imgDst, std::size_t &lane, ImageFrame &imgOld);
+
+		std::vector<std::unique_ptr<Lane>> lanes_;
+		FramePool *pool_ = nullptr;
+		bool weighted_ = false;
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Real-time state; guarded by mutex_.
+		std::size_t count_ = 0;
+		std::uint32_t nonEmpty_ = 0;	// bit i is set if lane i has frames.
+		std::uint32_t credited_ = 0;	// bit i is set if lane i has a share left.
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Thread safe locks.
+		std::mutex mutex_;
+		std::condition_variable not_empty_;
+	};
+}
+
+namespace Imaging
+{
+	inline PriorityImageBuffer::PriorityImageBuffer(
+		const std::vector<std::size_t> &capacities, const std::vector<std::size_t> &weights) :
+		weighted_(!weights.empty())
+	{
+		if (capacities.empty() || capacities.size() > PriorityImageBuffer::MaxLanes)
+		{
+			std::ostringstream errMsg;
+			errMsg << "The number of lanes (" << capacities.size() <<
+				") must be from 1 up to " << PriorityImageBuffer::MaxLanes << ".";
+			throw std::invalid_argument(errMsg.str());
+		}
+		if (this->weighted_ && weights.size() != capacities.size())
+		{
+			std::ostringstream errMsg;
+			errMsg << "The number of weights (" << weights.size() <<
+				") is not matched with the number of lanes (" << capacities.size() << ").";
+			throw std::invalid_argument(errMsg.str());
+		}
+
+		for (std::size_t n = 0; n != capacities.size(); ++n)
+		{
+			if (capacities[n] == 0 || (this->weighted_ && weights[n] == 0))
+			{
+				std::ostringstream errMsg;
+				errMsg << "Lane " << n <<
+					" must have a capacity and a weight of at least 1.";
+				throw std::invalid_argument(errMsg.str());
+			}
+
+			std::unique_ptr<Lane> lane(new Lane());
+			lane->data.resize(capacities[n]);
+			if (this->weighted_)
+				lane->weight = lane->credit = weights[n];
+			this->lanes_.push_back(std::move(lane));
+		}
+		this->credited_ = static_cast<std::uint32_t>(
+			(std::uint64_t(1) << capacities.size()) - 1);
+	}
+
+	inline PriorityImageBuffer::PriorityImageBuffer(
+		const std::vector<std::size_t> &capacities, const std::vector<std::size_t> &weights,
+		FramePool &pool) :
+		PriorityImageBuffer(capacities, weights)
+	{
+		this->pool_ = &pool;
+	}
+
+	inline void PriorityImageBuffer::push(std::size_t lane, ImageFrame &&imgSrc)
+	{
+		if (lane >= this->lanes_.size())
+		{
+			std::ostringstream errMsg;
+			errMsg << "Lane " << lane << " is out of range (" << this->lanes_.size() <<
+				" lanes).";
+			throw std::out_of_range(errMsg.str());
+		}
+
+		// Wait indefinitely if the lane is full.
+		Lane &dst = *this->lanes_[lane];
+		std::unique_lock<std::mutex> lock(this->mutex_);
+		dst.not_full.wait(lock, [&dst](){ return dst.count != dst.data.size(); });
+
+		// Move data instead of copying.
+		dst.data[dst.back] = std::move(imgSrc);
+
+		// Update counter.
+		dst.back = (dst.back + 1) % dst.data.size();
+		++dst.count;
+		++this->count_;
+		this->nonEmpty_ |= std::uint32_t(1) << lane;
+
+		// Notify that buffer is not empty.
+		this->not_empty_.notify_one();
+	}
+
+	inline bool PriorityImageBuffer::try_pop(ImageFrame &imgDst)
+	{
+		std::size_t lane;
+		return this->try_pop(imgDst, lane, DefaultWaitTime);
+	}
+
+	template <typename Rep, typename Period>
+	bool PriorityImageBuffer::try_pop(ImageFrame &imgDst,
+		const std::chrono::duration<Rep, Period> &wait_time)
+	{
+		std::size_t lane;
+		return this->try_pop(imgDst, lane, Internal::GetDeadline(wait_time));
+	}
+
+	inline bool PriorityImageBuffer::try_pop(ImageFrame &imgDst,
+		const std::chrono::steady_clock::time_point &deadline)
+	{
+		std::size_t lane;
+		return this->try_pop(imgDst, lane, deadline);
+	}
+
+	inline bool PriorityImageBuffer::try_pop_now(ImageFrame &imgDst)
+	{
+		std::size_t lane;
+		return this->try_pop_now(imgDst, lane);
+	}
+
+	inline bool PriorityImageBuffer::try_pop(ImageFrame &imgDst, std::size_t &lane)
+	{
+		return this->try_pop(imgDst, lane, DefaultWaitTime);
+	}
+
+	template <typename Rep, typename Period>
+	bool PriorityImageBuffer::try_pop(ImageFrame &imgDst, std::size_t &lane,
+		const std::chrono::duration<Rep, Period> &wait_time)
+	{
+		return this->try_pop(imgDst, lane, Internal::GetDeadline(wait_time));
+	}
+
+	inline bool PriorityImageBuffer::try_pop(ImageFrame &imgDst, std::size_t &lane,
+		const std::chrono::steady_clock::time_point &deadline)
+	{
+		// Keeps the previous frame of imgDst to return it to the pool after unlocking.
+		ImageFrame imgOld;
+		{
+			// Wait until the deadline if every lane is empty.
+			std::unique_lock<std::mutex> lock(this->mutex_);
+			if (!this->not_empty_.wait_until(lock, deadline,
+				[this](){ return this->count_ != 0; }))
+				return false;	// timed out.
+			this->PopFront(imgDst, lane, imgOld);
+		}
+
+		if (this->pool_)
+			this->pool_->release(std::move(imgOld));
+		return true;
+	}
+
+	inline bool PriorityImageBuffer::try_pop_now(ImageFrame &imgDst, std::size_t &lane)
+	{
+		ImageFrame imgOld;
+		{
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			if (this->count_ == 0)
+				return false;
+			this->PopFront(imgDst, lane, imgOld);
+		}
+
+		if (this->pool_)
+			this->pool_->release(std::move(imgOld));
+		return true;
+	}
+
+	inline std::size_t PriorityImageBuffer::lanes(void) const
+	{
+		return this->lanes_.size();
+	}
+
+	// static
+	inline std::size_t PriorityImageBuffer::FindLowestBit(std::uint32_t mask)
+	{
+		static const std::size_t table[32] = {
+			0, 1, 28, 2, 29, 14, 24, 3, 30, 22, 20, 15, 25, 17, 4, 8,
+			31, 27, 13, 23, 21, 19, 16, 7, 26, 12, 18, 6, 11, 5, 10, 9 };
+		return table[static_cast<std::uint32_t>((mask & (0U - mask)) * 0x077CB531U) >> 27];
+	}
+
+	inline std::size_t PriorityImageBuffer::SelectLane(void)
+	{
+		if (!this->weighted_)
+			return PriorityImageBuffer::FindLowestBit(this->nonEmpty_);
+
+		// Every non-empty lane has used up its share; start a new round.
+		auto ready = this->nonEmpty_ & this->credited_;
+		if (ready == 0)
+		{
+			for (auto &lane : this->lanes_)
+				lane->credit = lane->weight;
+			this->credited_ = static_cast<std::uint32_t>(
+				(std::uint64_t(1) << this->lanes_.size()) - 1);
+			ready = this->nonEmpty_;
+		}
+
+		auto n = PriorityImageBuffer::FindLowestBit(ready);
+		if (--this->lanes_[n]->credit == 0)
+			this->credited_ &= ~(std::uint32_t(1) << n);
+		return n;
+	}
+
+	inline void PriorityImageBuffer::PopFront(ImageFrame &imgDst, std::size_t &lane,
+		ImageFrame &imgOld)
+	{
+		lane = this->SelectLane();
+		Lane &src = *this->lanes_[lane];
+
+		// Move data instead of copying to a temporary variable.
+		if (this->pool_ && !imgDst.data.empty())
+			imgOld = std::move(imgDst);
+		imgDst = std::move(src.data[src.front]);
+
+		// Update counter.
+		src.front = (src.front + 1) % src.data.size();
+		--this->count_;
+		if (--src.count == 0)
+			this->nonEmpty_ &= ~(std::uint32_t(1) << lane);
+
+		// Notify that the lane is not full.
+		src.not_full.notify_one();
+	}
+}
+#endif
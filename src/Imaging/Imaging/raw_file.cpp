@@ -0,0 +1,156 @@
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include "utilities/safe_operations.h"
+#include "raw_file.h"
+
+namespace Imaging
+{
+	namespace Internal
+	{
+		// Last value of DataType; update it when a data type is added.
+		const std::uint32_t MaxDataType = static_cast<std::uint32_t>(DataType::DOUBLE);
+
+		void ThrowInvalidRawFile(const std::string &path, const std::string &what)
+		{
+			std::ostringstream errMsg;
+			errMsg << path << " is not a valid raw image file; " << what << ".";
+			throw std::runtime_error(errMsg.str());
+		}
+
+		// The values of a header are untrusted, so a crafted one must not wrap around.
+		std::uint64_t MultiplyHeader(const std::string &path, std::uint64_t t,
+			std::uint64_t u)
+		{
+			std::uint64_t result = 0;
+			try
+			{
+				Utilities::Multiply(t, u, result);
+			}
+			catch (const std::overflow_error &)
+			{
+				ThrowInvalidRawFile(path, "the size of the image overflows");
+			}
+			return result;
+		}
+
+		std::uint64_t AddHeader(const std::string &path, std::uint64_t t, std::uint64_t u)
+		{
+			std::uint64_t result = 0;
+			try
+			{
+				Utilities::Add(t, u, result);
+			}
+			catch (const std::overflow_error &)
+			{
+				ThrowInvalidRawFile(path, "the size of the image overflows");
+			}
+			return result;
+		}
+	}
+
+	ImageFrame OpenRawFile(const std::string &path, MappedFileStorage::Access access)
+	{
+		RawFileHeader header = ReadRawFileHeader(path);
+
+		ImageFrame imgDst;
+		auto bytes_total = header.bytesPerLine * header.height;
+		if (bytes_total == 0)
+			return imgDst;
+
+		// Every byte of the data is mapped at once; the pages are faulted in on access.
+		MappedFileStorage storage(path, static_cast<std::size_t>(header.dataOffset), access);
+		std::shared_ptr<void> owner = storage.Allocate(static_cast<std::size_t>(bytes_total));
+		ImageSize sz(static_cast<ImageSizeType>(header.width),
+			static_cast<ImageSizeType>(header.height));
+		imgDst.Adopt(static_cast<ImageFrame::ByteType *>(owner.get()),
+			static_cast<DataType>(header.dataType), sz,
+			static_cast<ImageSizeType>(header.depth),
+			static_cast<ImageSizeType>(header.bytesPerLine), owner);
+		return imgDst;
+	}
+
+	RawFileHeader ReadRawFileHeader(const std::string &path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file)
+		{
+			std::ostringstream errMsg;
+			errMsg << "Cannot open " << path << ".";
+			throw std::runtime_error(errMsg.str());
+		}
+
+		RawFileHeader header;
+		if (!file.read(reinterpret_cast<char *>(&header), sizeof(header)))
+			Internal::ThrowInvalidRawFile(path, "the header is truncated");
+		if (std::memcmp(header.magic, RawFileMagic, sizeof(RawFileMagic)) != 0)
+			Internal::ThrowInvalidRawFile(path, "the magic number is not matched");
+		if (header.version != RawFileVersion)
+			Internal::ThrowInvalidRawFile(path, "the version is not supported");
+
+		// An empty image has no data type.
+		auto bytes_total = Internal::MultiplyHeader(path, header.bytesPerLine,
+			header.height);
+		if (bytes_total == 0)
+			return header;
+		if (bytes_total > std::numeric_limits<std::size_t>::max())
+			Internal::ThrowInvalidRawFile(path, "the image data is too large to map");
+
+		if (header.dataType == static_cast<std::uint32_t>(DataType::UNDEFINED) ||
+			header.dataType > Internal::MaxDataType)
+			Internal::ThrowInvalidRawFile(path, "the data type is unknown");
+
+		// Checked first, so the effective bytes do not wrap in GetBytesPerLine().
+		auto bytes_eff = Internal::MultiplyHeader(path,
+			Internal::MultiplyHeader(path, header.width, header.depth),
+			GetNumBytes(static_cast<DataType>(header.dataType)));
+		if (header.alignment == 0 || (header.alignment & (header.alignment - 1)) != 0 ||
+			header.alignment > ImageFrame::BufferAlignment ||
+			bytes_eff > header.bytesPerLine ||
+			ImageFrame::GetBytesPerLine(static_cast<DataType>(header.dataType),
+			static_cast<ImageSizeType>(header.width), static_cast<ImageSizeType>(header.depth),
+			static_cast<ImageSizeType>(header.alignment)) != header.bytesPerLine)
+			Internal::ThrowInvalidRawFile(path, "the dimension is not matched");
+		if (header.dataOffset < sizeof(header) || header.dataOffset % Storage::Alignment != 0)
+			Internal::ThrowInvalidRawFile(path, "the data offset is not aligned");
+
+		// Accessing a page beyond the end of a mapped file crashes instead of failing.
+		file.seekg(0, std::ios::end);
+		if (static_cast<std::uint64_t>(file.tellg()) <
+			Internal::AddHeader(path, header.dataOffset, bytes_total))
+			Internal::ThrowInvalidRawFile(path, "the image data is truncated");
+
+		return header;
+	}
+
+	void WriteRawFile(const std::string &path, const ImageFrame &imgSrc)
+	{
+		RawFileHeader header = {};
+		std::copy_n(RawFileMagic, sizeof(RawFileMagic), header.magic);
+		header.version = RawFileVersion;
+		header.dataType = static_cast<std::uint32_t>(imgSrc.dataType);
+		header.width = imgSrc.size.width;
+		header.height = imgSrc.size.height;
+		header.depth = imgSrc.depth;
+		header.alignment = imgSrc.alignment;
+		header.bytesPerLine = imgSrc.bytesPerLine;
+		header.dataOffset = RawFileDataOffset;
+
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		file.write(reinterpret_cast<const char *>(&header), sizeof(header));
+		std::vector<char> zeros(RawFileDataOffset - sizeof(header), 0);
+		file.write(zeros.data(), zeros.size());
+		if (!imgSrc.data.empty())
+			file.write(imgSrc.data.data(), static_cast<std::streamsize>(imgSrc.data.size()));
+		if (!file)
+		{
+			std::ostringstream errMsg;
+			errMsg << "Cannot write " << path << ".";
+			throw std::runtime_error(errMsg.str());
+		}
+	}
+}
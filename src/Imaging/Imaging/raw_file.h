@@ -0,0 +1,57 @@
+#if !defined(RAW_FILE_H)
+#define RAW_FILE_H
+
+#include <cstdint>
+#include <string>
+
+#include "image.h"
+#include "storage.h"
+
+namespace Imaging
+{
+	/* Raw image file, which is opened by mapping it into memory instead of decoding it.
+
+	Layout:
+	[0, RawFileHeaderBytes): RawFileHeader
+	[dataOffset, dataOffset + bytesPerLine * height): image data as in ImageFrame, padding
+	bytes included
+
+	The data starts at a page boundary (RawFileDataOffset), so OpenRawFile() maps it into an
+	ImageFrame as it is. Opening takes the same time regardless of the image size, and the
+	pages are read from the file when they are accessed first.
+	The header is stored in the byte order of the machine, which is little endian on every
+	platform this library supports. */
+	struct RawFileHeader
+	{
+		char magic[8];				// RawFileMagic
+		std::uint32_t version;		// RawFileVersion
+		std::uint32_t dataType;		// value of DataType
+		std::uint64_t width;
+		std::uint64_t height;
+		std::uint64_t depth;
+		std::uint64_t alignment;
+		std::uint64_t bytesPerLine;
+		std::uint64_t dataOffset;
+	};
+
+	static_assert(sizeof(RawFileHeader) == 64, "RawFileHeader must not have padding.");
+
+	const char RawFileMagic[8] = { 'I', 'M', 'G', 'R', 'A', 'W', '\r', '\n' };
+	const std::uint32_t RawFileVersion = 1;
+	const std::size_t RawFileDataOffset = 4096;
+
+	/* Opens a raw image file into an ImageFrame sharing the mapped data.
+	CopyOnWrite (default) leaves the file as is even if the image data is modified, and
+	ReadWrite writes the modification into the file. Throws std::runtime_error if the file
+	is not a valid raw image file. */
+	ImageFrame OpenRawFile(const std::string &path,
+		MappedFileStorage::Access access = MappedFileStorage::Access::CopyOnWrite);
+
+	// Reads the header of a raw image file.
+	RawFileHeader ReadRawFileHeader(const std::string &path);
+
+	// Writes an ImageFrame into a raw image file, which is overwritten if it exists.
+	void WriteRawFile(const std::string &path, const ImageFrame &imgSrc);
+}
+
+#endif
@@ -0,0 +1,363 @@
+#include <algorithm>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#if defined(_WIN32)
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "utilities/allocators.h"
+#include "storage.h"
+
+namespace Imaging
+{
+	namespace Internal
+	{
+		// Singleton of HeapStorage; see Internal::poolFlag in thread_pool.cpp.
+		std::once_flag heapStorageFlag;
+		std::shared_ptr<Storage> heapStorage;
+
+		std::size_t RoundUp(std::size_t n, std::size_t unit)
+		{
+			return (n + unit - 1) / unit * unit;
+		}
+
+		std::size_t GetPageBytes(void)
+		{
+#if defined(_WIN32)
+			SYSTEM_INFO info;
+			::GetSystemInfo(&info);
+			return info.dwPageSize;
+#else
+			return static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+#endif
+		}
+
+		// Granularity of the offset of a file mapping.
+		std::size_t GetMappingGranularity(void)
+		{
+#if defined(_WIN32)
+			SYSTEM_INFO info;
+			::GetSystemInfo(&info);
+			return info.dwAllocationGranularity;
+#else
+			return GetPageBytes();
+#endif
+		}
+
+		void ThrowSystemError(const std::string &what)
+		{
+			std::ostringstream errMsg;
+#if defined(_WIN32)
+			errMsg << what << " (error " << ::GetLastError() << ").";
+#else
+			errMsg << what << " (" << std::strerror(errno) << ").";
+#endif
+			throw std::runtime_error(errMsg.str());
+		}
+
+		void ThrowFileTooSmall(const std::string &path, std::size_t bytes)
+		{
+			std::ostringstream errMsg;
+			errMsg << path << " is smaller than the " << bytes << " bytes to map.";
+			throw std::runtime_error(errMsg.str());
+		}
+
+		// Anonymous pages, which are zero; nullptr if failed.
+		void *MapPages(std::size_t bytes, bool huge)
+		{
+#if defined(_WIN32)
+			DWORD type = MEM_RESERVE | MEM_COMMIT | (huge ? MEM_LARGE_PAGES : 0);
+			return ::VirtualAlloc(nullptr, bytes, type, PAGE_READWRITE);
+#else
+			int flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#if defined(MAP_HUGETLB)
+			if (huge)
+				flags |= MAP_HUGETLB;
+#else
+			if (huge)
+				return nullptr;
+#endif
+			void *ptr = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, flags, -1, 0);
+			return ptr == MAP_FAILED ? nullptr : ptr;
+#endif
+		}
+
+		void UnmapPages(void *ptr, std::size_t bytes)
+		{
+#if defined(_WIN32)
+			(void)bytes;
+			::VirtualFree(ptr, 0, MEM_RELEASE);
+#else
+			::munmap(ptr, bytes);
+#endif
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// HeapStorage
+
+	std::shared_ptr<void> HeapStorage::Allocate(std::size_t n)
+	{
+		if (n == 0)
+			return std::shared_ptr<void>();
+
+		void *ptr = Utilities::AlignedMalloc(n, Storage::Alignment);
+		if (ptr == nullptr)
+			throw std::bad_alloc();
+
+		// The deleter frees the block even if the std::shared_ptr itself fails to allocate.
+		return std::shared_ptr<void>(ptr, Utilities::AlignedFree);
+	}
+
+	const std::shared_ptr<Storage> &HeapStorage::GetInstance(void)
+	{
+		std::call_once(Internal::heapStorageFlag, [](void)
+		{
+			Internal::heapStorage = std::make_shared<HeapStorage>();
+		});
+		return Internal::heapStorage;
+	}
+
+	// HeapStorage
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// SlabStorage
+
+	/* Shared by the storage and the deleters of its blocks, so the slabs stay until the last
+	block is returned. */
+	struct SlabStorage::Slabs
+	{
+		~Slabs(void)
+		{
+			for (auto slab : this->slabs)
+				Utilities::AlignedFree(slab);
+		}
+
+		std::size_t slabBytes;
+		std::mutex mutex;
+		std::vector<void *> slabs;
+
+		// Free blocks of a size, and the number of blocks carved for it.
+		struct FreeList
+		{
+			std::vector<void *> blocks;
+			std::size_t nBlocks = 0;
+		};
+		std::unordered_map<std::size_t, FreeList> lists;
+	};
+
+	SlabStorage::SlabStorage(std::size_t slabBytes) : slabs_(std::make_shared<Slabs>())
+	{
+		this->slabs_->slabBytes = slabBytes;
+	}
+
+	std::shared_ptr<void> SlabStorage::Allocate(std::size_t n)
+	{
+		if (n == 0)
+			return std::shared_ptr<void>();
+
+		const std::size_t bytes = Internal::RoundUp(n, Storage::Alignment);
+		void *block = nullptr;
+		{
+			std::lock_guard<std::mutex> lock(this->slabs_->mutex);
+			auto &list = this->slabs_->lists[bytes];
+			if (list.blocks.empty())
+			{	// Carve a new slab into blocks.
+				std::size_t nBlocks = std::max<std::size_t>(1,
+					this->slabs_->slabBytes / bytes);
+				list.blocks.reserve(list.nBlocks + nBlocks);
+				this->slabs_->slabs.reserve(this->slabs_->slabs.size() + 1);
+				char *slab = static_cast<char *>(
+					Utilities::AlignedMalloc(nBlocks * bytes, Storage::Alignment));
+				if (slab == nullptr)
+					throw std::bad_alloc();
+				this->slabs_->slabs.push_back(slab);
+				list.nBlocks += nBlocks;
+				for (std::size_t i = nBlocks; i != 0; --i)
+					list.blocks.push_back(slab + (i - 1) * bytes);
+			}
+			block = list.blocks.back();
+			list.blocks.pop_back();
+		}
+
+		/* The deleter returns the block to its free list, which has room for every block of
+		the size, so it does not throw. */
+		std::shared_ptr<Slabs> slabs = this->slabs_;
+		return std::shared_ptr<void>(block, [slabs, bytes](void *ptr)
+		{
+			std::lock_guard<std::mutex> lock(slabs->mutex);
+			slabs->lists.find(bytes)->second.blocks.push_back(ptr);
+		});
+	}
+
+	// SlabStorage
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// HugePageStorage
+
+	std::shared_ptr<void> HugePageStorage::Allocate(std::size_t n)
+	{
+		if (n == 0)
+			return std::shared_ptr<void>();
+
+		std::size_t bytes = Internal::RoundUp(n, Internal::GetPageBytes());
+		void *ptr = nullptr;
+		if (n >= HugePageStorage::HugePageBytes)
+		{
+			std::size_t bytesHuge = Internal::RoundUp(n, HugePageStorage::HugePageBytes);
+			ptr = Internal::MapPages(bytesHuge, true);
+			if (ptr != nullptr)
+				bytes = bytesHuge;
+		}
+		if (ptr == nullptr)
+		{
+			ptr = Internal::MapPages(bytes, false);
+			if (ptr == nullptr)
+				throw std::bad_alloc();
+#if defined(MADV_HUGEPAGE)
+			if (n >= HugePageStorage::HugePageBytes)
+				::madvise(ptr, bytes, MADV_HUGEPAGE);
+#endif
+		}
+
+		return std::shared_ptr<void>(ptr, [bytes](void *p)
+		{
+			Internal::UnmapPages(p, bytes);
+		});
+	}
+
+	// HugePageStorage
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// MappedFileStorage
+
+	MappedFileStorage::MappedFileStorage(const std::string &path, std::size_t offset,
+		Access access) : access_(access), path_(path), offset_(offset)
+	{
+		if (offset % Storage::Alignment != 0)
+		{
+			std::ostringstream errMsg;
+			errMsg << "The offset (" << offset << ") must be a multiple of " <<
+				Storage::Alignment << ".";
+			throw std::invalid_argument(errMsg.str());
+		}
+	}
+
+	/* The view starts at the mapping granularity below 'offset', and the returned pointer
+	shares its ownership. The file handles are closed right away; the view keeps the
+	mapping. */
+	std::shared_ptr<void> MappedFileStorage::Allocate(std::size_t n)
+	{
+		if (n == 0)
+			return std::shared_ptr<void>();
+
+		const std::size_t first = this->offset / Internal::GetMappingGranularity() *
+			Internal::GetMappingGranularity();
+		const std::size_t bytesFile = this->offset + n, bytesView = bytesFile - first;
+		const bool readWrite = this->access == Access::ReadWrite;
+		void *view = nullptr;
+
+#if defined(_WIN32)
+		HANDLE file = ::CreateFileA(this->path.c_str(),
+			readWrite ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+			FILE_SHARE_READ | FILE_SHARE_WRITE, nullptr,
+			readWrite ? OPEN_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+			Internal::ThrowSystemError("Cannot open " + this->path);
+
+		// Grows the file if it is smaller than the mapping, or fails if read only.
+		LARGE_INTEGER size;
+		if (!::GetFileSizeEx(file, &size))
+		{
+			::CloseHandle(file);
+			Internal::ThrowSystemError("Cannot open " + this->path);
+		}
+		if (!readWrite && static_cast<std::size_t>(size.QuadPart) < bytesFile)
+		{
+			::CloseHandle(file);
+			Internal::ThrowFileTooSmall(this->path, bytesFile);
+		}
+		size.QuadPart = static_cast<LONGLONG>(bytesFile);
+		HANDLE mapping = ::CreateFileMappingA(file, nullptr,
+			readWrite ? PAGE_READWRITE : PAGE_WRITECOPY, size.HighPart, size.LowPart, nullptr);
+		::CloseHandle(file);
+		if (mapping == nullptr)
+			Internal::ThrowSystemError("Cannot map " + this->path);
+
+		LARGE_INTEGER pos;
+		pos.QuadPart = static_cast<LONGLONG>(first);
+		view = ::MapViewOfFile(mapping,
+			readWrite ? FILE_MAP_READ | FILE_MAP_WRITE : FILE_MAP_COPY, pos.HighPart,
+			pos.LowPart, bytesView);
+		::CloseHandle(mapping);
+		if (view == nullptr)
+			Internal::ThrowSystemError("Cannot map " + this->path);
+
+		std::shared_ptr<void> block(view, [](void *p)
+		{
+			::UnmapViewOfFile(p);
+		});
+#else
+		int fd = readWrite ? ::open(this->path.c_str(), O_RDWR | O_CREAT, 0644) :
+			::open(this->path.c_str(), O_RDONLY);
+		if (fd < 0)
+			Internal::ThrowSystemError("Cannot open " + this->path);
+
+		// Grows the file if it is smaller than the mapping, or fails if read only.
+		struct stat st;
+		if (::fstat(fd, &st) != 0)
+		{
+			::close(fd);
+			Internal::ThrowSystemError("Cannot open " + this->path);
+		}
+		if (static_cast<std::size_t>(st.st_size) < bytesFile)
+		{
+			if (!readWrite)
+			{
+				::close(fd);
+				Internal::ThrowFileTooSmall(this->path, bytesFile);
+			}
+			if (::ftruncate(fd, static_cast<off_t>(bytesFile)) != 0)
+			{
+				::close(fd);
+				Internal::ThrowSystemError("Cannot resize " + this->path);
+			}
+		}
+
+		view = ::mmap(nullptr, bytesView, PROT_READ | PROT_WRITE,
+			readWrite ? MAP_SHARED : MAP_PRIVATE, fd, static_cast<off_t>(first));
+		::close(fd);
+		if (view == MAP_FAILED)
+			Internal::ThrowSystemError("Cannot map " + this->path);
+
+		std::shared_ptr<void> block(view, [bytesView](void *p)
+		{
+			::munmap(p, bytesView);
+		});
+#endif
+
+		// Points to 'offset' while owning the whole view.
+		return std::shared_ptr<void>(block, static_cast<char *>(view) + (this->offset - first));
+	}
+
+	// MappedFileStorage
+	////////////////////////////////////////////////////////////////////////////////////////
+}
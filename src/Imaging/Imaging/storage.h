@@ -0,0 +1,111 @@
+#if !defined(STORAGE_H)
+#define STORAGE_H
+
+#include <cstddef>
+#include <memory>
+#include <string>
+
+namespace Imaging
+{
+	/* Allocation scheme of image data.
+
+	Allocate(n) returns a block of 'n' bytes aligned to Alignment bytes (or an empty pointer
+	if 'n' is 0), and the deleter of the returned std::shared_ptr frees the block. So a block
+	can outlive the storage which allocated it, and it can be shared with others, e.g. a
+	cv::Mat (see ImageData).
+	The bytes of a new block are undefined unless IsInitialized() is true, which means they
+	are already zero (fresh pages) or hold the contents of a file.
+
+	Backends:
+	HeapStorage: aligned heap; the default of ImageData.
+	SlabStorage: blocks carved from large slabs and recycled per size.
+	HugePageStorage: anonymous mapping backed by huge pages if possible.
+	MappedFileStorage: shared mapping of a file.
+	A buffer owned by others, e.g. a DMA buffer of a camera driver, is not allocated by a
+	storage but adopted with its deleter. See ImageFrame::Adopt(). */
+	class Storage
+	{
+	public:
+		static const std::size_t Alignment = 64;
+
+		Storage(void) = default;
+		virtual ~Storage(void) {}
+		Storage(const Storage &) = delete;
+		Storage &operator=(const Storage &) = delete;
+
+		virtual std::shared_ptr<void> Allocate(std::size_t n) = 0;
+		virtual bool IsInitialized(void) const { return false; }
+	};
+
+	class HeapStorage : public Storage
+	{
+	public:
+		std::shared_ptr<void> Allocate(std::size_t n) override;
+
+		static const std::shared_ptr<Storage> &GetInstance(void);
+	};
+
+	/* Allocating and freeing a multi-megabyte block costs mmap()/munmap() and page faults
+	each time. This storage keeps freed blocks in a free list per size (rounded up to
+	Alignment) and hands them out again, and allocates new blocks in slabs of about
+	'slabBytes' (at least one block) to cut the number of system allocations.
+	The slabs are freed after the storage and all of its blocks are gone. Thread safe. */
+	class SlabStorage : public Storage
+	{
+	public:
+		explicit SlabStorage(std::size_t slabBytes = 64 << 20);
+		std::shared_ptr<void> Allocate(std::size_t n) override;
+
+	protected:
+		struct Slabs;
+		std::shared_ptr<Slabs> slabs_;
+	};
+
+	/* Blocks of HugePageBytes or larger are rounded up to a multiple of huge pages and backed
+	by them (MAP_HUGETLB, or MEM_LARGE_PAGES on Windows), which saves TLB misses when large
+	frames are scanned. If no huge page is available, the block falls back to regular
+	pages advised for transparent huge pages (MADV_HUGEPAGE). Smaller blocks always take
+	regular pages. */
+	class HugePageStorage : public Storage
+	{
+	public:
+		static const std::size_t HugePageBytes = 2 << 20;
+
+		std::shared_ptr<void> Allocate(std::size_t n) override;
+		bool IsInitialized(void) const override { return true; }
+	};
+
+	/* Maps the bytes of a file from 'offset' to offset + n, and every block allocated from
+	the same storage maps the same bytes of the file.
+	Access::ReadWrite: writing into a block writes into the file, which is created or grown
+	as necessary.
+	Access::CopyOnWrite: the file is opened read only and must hold offset + n bytes
+	already; writing into a block copies the page privately and leaves the file as is.
+	'offset' must be a multiple of Alignment. Throws std::runtime_error if the file cannot
+	be opened or mapped. */
+	class MappedFileStorage : public Storage
+	{
+	public:
+		enum struct Access
+		{
+			ReadWrite,
+			CopyOnWrite
+		};
+
+		explicit MappedFileStorage(const std::string &path, std::size_t offset = 0,
+			Access access = Access::ReadWrite);
+		std::shared_ptr<void> Allocate(std::size_t n) override;
+		bool IsInitialized(void) const override { return true; }
+
+		const Access &access = this->access_;
+		const std::string &path = this->path_;
+		const std::size_t &offset = this->offset_;
+
+	protected:
+		Access access_ = Access::ReadWrite;
+		std::string path_;
+		std::size_t offset_ = 0;
+	};
+}
+
+#endif
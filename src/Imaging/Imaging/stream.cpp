@@ -0,0 +1,323 @@
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "raw_file.h"
+#include "stream.h"
+
+namespace Imaging
+{
+	namespace Internal
+	{
+		void ThrowStreamError(const std::string &what, const std::string &path)
+		{
+			std::ostringstream errMsg;
+			errMsg << "Cannot " << what << " " << path << ".";
+			throw std::runtime_error(errMsg.str());
+		}
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// RawFileLineSource
+
+	RawFileLineSource::RawFileLineSource(const std::string &path)
+	{
+		RawFileHeader header = ReadRawFileHeader(path);
+		this->file_.open(path, std::ios::binary);
+		this->file_.seekg(static_cast<std::streamoff>(header.dataOffset));
+		if (!this->file_)
+			Internal::ThrowStreamError("open", path);
+
+		// An empty image has no line to read.
+		if (header.bytesPerLine * header.height == 0)
+			return;
+		this->alignment_ = static_cast<ImageSizeType>(header.alignment);
+		this->dataType_ = static_cast<DataType>(header.dataType);
+		this->depth_ = static_cast<ImageSizeType>(header.depth);
+		this->size_ = ImageSize(static_cast<ImageSizeType>(header.width),
+			static_cast<ImageSizeType>(header.height));
+	}
+
+	/* The lines are read as they are stored, padding bytes included, so the band keeps the
+	line alignment of the file and every byte of it is overwritten. */
+	bool RawFileLineSource::Read(ImageFrame &band, ImageSizeType nLines)
+	{
+		ImageSizeType n = std::min(nLines, this->size_.height - this->line_);
+		if (n == 0)
+			return false;
+
+		band.Reset(this->dataType_, { this->size_.width, n }, this->depth_,
+			this->alignment_, Init::None);
+		auto bytes_total = static_cast<std::streamsize>(band.data.size());
+		if (!this->file_.read(&(*band.Begin()), bytes_total))
+			throw std::runtime_error("The raw image file is truncated while reading.");
+		this->line_ += n;
+		return true;
+	}
+
+	// RawFileLineSource
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// RawFileLineSink
+
+	RawFileLineSink::RawFileLineSink(const std::string &path, ImageSizeType align) :
+		path_(path), alignment_(align)
+	{
+		ImageFrame::EvalAlignment(align);
+
+		// The header is rewritten with the dimension at Close().
+		this->file_.open(path, std::ios::binary | std::ios::trunc);
+		this->WriteHeader();
+		std::vector<char> zeros(RawFileDataOffset - sizeof(RawFileHeader), 0);
+		this->file_.write(zeros.data(), zeros.size());
+		if (!this->file_)
+			Internal::ThrowStreamError("write", path);
+	}
+
+	RawFileLineSink::~RawFileLineSink(void)
+	{
+		try
+		{
+			this->Close();
+		}
+		catch (...)
+		{
+		}
+	}
+
+	void RawFileLineSink::Write(const ConstImageView &band)
+	{
+		if (this->closed_)
+			throw std::logic_error("Cannot write into a closed raw image file.");
+		if (band.IsEmpty())
+			return;
+
+		// The first band defines the dimension except for the height.
+		if (this->size_.height == 0)
+		{
+			this->dataType_ = band.dataType;
+			this->depth_ = band.depth;
+			this->size_.width = band.size.width;
+		}
+		else if (band.dataType != this->dataType_ || band.depth != this->depth_ ||
+			band.size.width != this->size_.width)
+			throw std::invalid_argument("The dimension of the band is not matched.");
+
+		/* Write the lines at once if they are contiguous and need no padding; re-pad them
+		otherwise. A view of a part of each line, e.g. an ROI at an x offset, is never
+		contiguous, and reading its padding bytes would read its neighbors. */
+		auto bytes_line = ImageFrame::GetBytesPerLine(this->dataType_, this->size_.width,
+			this->depth_, this->alignment_);
+		const char *src = &(*band.Cbegin());
+		if (band.HaveZeroPaddingBytes() && band.bytesPerLine == bytes_line)
+			this->file_.write(src,
+				static_cast<std::streamsize>(bytes_line * band.size.height));
+		else
+		{
+			auto bytes_eff = ImageFrame::GetBytesPerLine(this->dataType_, this->size_.width,
+				this->depth_);
+			std::vector<char> zeros(bytes_line - bytes_eff, 0);
+			for (ImageSizeType y = 0; y != band.size.height; ++y)
+			{
+				this->file_.write(src + y * band.bytesPerLine,
+					static_cast<std::streamsize>(bytes_eff));
+				this->file_.write(zeros.data(), zeros.size());
+			}
+		}
+		if (!this->file_)
+			Internal::ThrowStreamError("write", this->path_);
+		this->size_.height += band.size.height;
+	}
+
+	void RawFileLineSink::Close(void)
+	{
+		if (this->closed_)
+			return;
+		this->closed_ = true;
+
+		this->file_.seekp(0);
+		this->WriteHeader();
+		this->file_.close();
+		if (!this->file_)
+			Internal::ThrowStreamError("write", this->path_);
+	}
+
+	void RawFileLineSink::WriteHeader(void)
+	{
+		RawFileHeader header = {};
+		std::copy_n(RawFileMagic, sizeof(RawFileMagic), header.magic);
+		header.version = RawFileVersion;
+		header.dataOffset = RawFileDataOffset;
+		if (this->size_.height != 0)
+		{
+			header.dataType = static_cast<std::uint32_t>(this->dataType_);
+			header.width = this->size_.width;
+			header.height = this->size_.height;
+			header.depth = this->depth_;
+			header.alignment = this->alignment_;
+			header.bytesPerLine = ImageFrame::GetBytesPerLine(this->dataType_,
+				this->size_.width, this->depth_, this->alignment_);
+		}
+		this->file_.write(reinterpret_cast<const char *>(&header), sizeof(header));
+	}
+
+	// RawFileLineSink
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// BandReader
+
+	/* The end of the image is pushed as an empty band after the last one. A slab of a
+	single band recycles the blocks of the bands released by the caller, so reading a long
+	image does not allocate memory in steady state. */
+	BandReader::BandReader(LineSource &source, ImageSizeType nLines, std::size_t nAhead) :
+		source_(source), nLines_(nLines), bands_(std::max<std::size_t>(nAhead, 1)),
+		storage_(std::make_shared<SlabStorage>(0))
+	{
+		if (nLines == 0)
+			throw std::invalid_argument("A band must have at least one line.");
+		this->stop_ = false;
+		this->thread_ = std::thread(&BandReader::Run, this);
+	}
+
+	BandReader::~BandReader(void)
+	{
+		// Unblock the reading thread, which may be waiting for a free slot, until it ends.
+		this->stop_ = true;
+		ImageFrame band;
+		while (!this->end_)
+			this->end_ = this->bands_.try_pop(band) && band.data.empty();
+		this->thread_.join();
+	}
+
+	bool BandReader::Read(ImageFrame &band)
+	{
+		if (this->end_)
+			return false;
+
+		ImageFrame bandNext;
+		while (!this->bands_.try_pop(bandNext));
+		if (bandNext.data.empty())
+		{	// error_ is written before the end of the image is pushed.
+			this->end_ = true;
+			if (this->error_)
+				std::rethrow_exception(this->error_);
+			return false;
+		}
+
+		band = std::move(bandNext);
+		this->line_ = this->lineNext_;
+		this->lineNext_ += band.size.height;
+		return true;
+	}
+
+	ImageSizeType BandReader::GetLine(void) const
+	{
+		return this->line_;
+	}
+
+	void BandReader::Run(void)
+	{
+		try
+		{
+			while (!this->stop_)
+			{
+				ImageFrame band;
+				band.SetStorage(this->storage_);
+				if (!this->source_.Read(band, this->nLines_))
+					break;
+				this->bands_.push(std::move(band));
+			}
+		}
+		catch (...)
+		{
+			this->error_ = std::current_exception();
+		}
+		this->bands_.push(ImageFrame());
+	}
+
+	// BandReader
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// BandWriter
+
+	BandWriter::BandWriter(LineSink &sink, std::size_t nBehind) :
+		sink_(sink), bands_(std::max<std::size_t>(nBehind, 1))
+	{
+		this->failed_ = false;
+		this->thread_ = std::thread(&BandWriter::Run, this);
+	}
+
+	BandWriter::~BandWriter(void)
+	{
+		try
+		{
+			this->Close();
+		}
+		catch (...)
+		{
+		}
+	}
+
+	void BandWriter::Write(ImageFrame &&band)
+	{
+		if (this->closed_)
+			throw std::logic_error("Cannot write into a closed BandWriter.");
+		if (this->failed_)
+			this->RethrowError();
+
+		// An empty band would end the image early.
+		if (!band.data.empty())
+			this->bands_.push(std::move(band));
+	}
+
+	void BandWriter::Close(void)
+	{
+		if (this->closed_)
+			return;
+		this->closed_ = true;
+
+		this->bands_.push(ImageFrame());
+		this->thread_.join();
+		if (this->failed_)
+			this->RethrowError();
+		this->sink_.Close();
+	}
+
+	void BandWriter::Run(void)
+	{
+		ImageFrame band;
+		for (;;)
+		{
+			if (!this->bands_.try_pop(band))
+				continue;
+			if (band.data.empty())
+				break;
+
+			// Keep popping after an error so that Write() does not block.
+			if (this->failed_)
+				continue;
+			try
+			{
+				this->sink_.Write(ConstImageView(band));
+			}
+			catch (...)
+			{
+				this->error_ = std::current_exception();
+				this->failed_ = true;
+			}
+		}
+	}
+
+	// failed_ is set after error_, so error_ is visible once failed_ is.
+	void BandWriter::RethrowError(void)
+	{
+		std::rethrow_exception(this->error_);
+	}
+
+	// BandWriter
+	////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,341 @@
+#if !defined(STREAM_H)
+#define STREAM_H
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#include "image.h"
+#include "view.h"
+#include "buffer.h"
+#include "copy.h"
+#include "storage.h"
+
+namespace Imaging
+{
+	/* Streaming of images larger than memory, e.g. from a line-scan camera, in bands of
+	lines.
+
+	A LineSource produces the lines of an image from the top, and a LineSink consumes them
+	in the same order, so only a few bands are in memory regardless of the image height.
+	BandReader reads bands ahead on a background thread, and BandWriter writes them behind
+	on a background thread, so the I/O overlaps the processing of the current band.
+
+	Sources and sinks:
+	RawFileLineSource / RawFileLineSink: a raw image file (see raw_file.h).
+	BufferLineSource / BufferLineSink: chunks of lines passing through an ImageBuffer or a
+	SpscImageBuffer. An empty ImageFrame marks the end of the image. */
+
+	class LineSource
+	{
+	public:
+		virtual ~LineSource(void) {}
+
+		/* Reads up to 'nLines' next lines into 'band', which is resized per the lines read.
+		Returns false if no line is left. */
+		virtual bool Read(ImageFrame &band, ImageSizeType nLines) = 0;
+	};
+
+	class LineSink
+	{
+	public:
+		virtual ~LineSink(void) {}
+
+		// Appends the lines of 'band'; every band has the same data type, width, and depth.
+		virtual void Write(const ConstImageView &band) = 0;
+
+		// Completes the image after the last band.
+		virtual void Close(void) {}
+	};
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Raw image file
+
+	// Reads the lines of a raw image file with plain file I/O instead of mapping it.
+	class RawFileLineSource : public LineSource
+	{
+	public:
+		explicit RawFileLineSource(const std::string &path);
+		bool Read(ImageFrame &band, ImageSizeType nLines) override;
+
+	protected:
+		std::ifstream file_;
+		ImageSizeType alignment_ = 1;
+		DataType dataType_ = DataType::UNDEFINED;
+		ImageSizeType depth_ = 0;
+		ImageSize size_ = ImageSize(0, 0);
+		ImageSizeType line_ = 0;
+	};
+
+	/* Writes the lines into a raw image file with lines aligned to 'align' bytes.
+	The height in the header is written by Close(), which the destructor calls if not
+	called yet. */
+	class RawFileLineSink : public LineSink
+	{
+	public:
+		explicit RawFileLineSink(const std::string &path, ImageSizeType align = 1);
+		~RawFileLineSink(void);
+		void Write(const ConstImageView &band) override;
+		void Close(void) override;
+
+	protected:
+		void WriteHeader(void);
+
+		std::ofstream file_;
+		std::string path_;
+		ImageSizeType alignment_ = 1;
+		DataType dataType_ = DataType::UNDEFINED;
+		ImageSizeType depth_ = 0;
+		ImageSize size_ = ImageSize(0, 0);
+		bool closed_ = false;
+	};
+
+	// Raw image file
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Image buffer
+
+	/* Cuts the chunks popped from an ImageBuffer or a SpscImageBuffer into bands.
+	The chunks may have any number of lines, but the same data type, width, and depth. The
+	bands keep the line alignment of the chunks. The buffer must outlive this object. */
+	template <typename BufferType>
+	class BufferLineSource : public LineSource
+	{
+	public:
+		explicit BufferLineSource(BufferType &buffer);
+		bool Read(ImageFrame &band, ImageSizeType nLines) override;
+
+	protected:
+		BufferType &buffer_;
+		ImageFrame chunk_;
+		ImageSizeType line_ = 0;	// next line of chunk_
+		bool end_ = false;
+	};
+
+	/* Pushes every band into an ImageBuffer or a SpscImageBuffer as a separate chunk, and
+	an empty ImageFrame at Close(). The buffer must outlive this object.
+	A dropped or overwritten band would corrupt the image, so an ImageBuffer must wait for
+	room (Overflow::Block); the constructor throws std::invalid_argument otherwise, and
+	Write() throws std::runtime_error if the policy is changed later and a band is lost. */
+	template <typename BufferType>
+	class BufferLineSink : public LineSink
+	{
+	public:
+		explicit BufferLineSink(BufferType &buffer);
+		void Write(const ConstImageView &band) override;
+		void Close(void) override;
+
+	protected:
+		BufferType &buffer_;
+	};
+
+	// Image buffer
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Read-ahead and write-behind
+
+	/* Reads bands of 'nLines' lines (the last one may be shorter) from a source on a
+	background thread, up to 'nAhead' bands ahead of the caller. So at most nAhead + 2
+	bands are in memory: the queued ones, the one being read, and the one held by the
+	caller. The blocks of the bands are recycled through a SlabStorage.
+	An exception thrown by the source is rethrown from Read() after the bands read before.
+	The source must outlive this object. */
+	class BandReader
+	{
+	public:
+		BandReader(LineSource &source, ImageSizeType nLines, std::size_t nAhead = 1);
+		~BandReader(void);
+		BandReader(const BandReader &) = delete;
+		BandReader &operator=(const BandReader &) = delete;
+
+		// Moves the next band into 'band'; returns false at the end of the image.
+		bool Read(ImageFrame &band);
+
+		// Index of the first line of the band returned by the last Read().
+		ImageSizeType GetLine(void) const;
+
+	protected:
+		void Run(void);
+
+		LineSource &source_;
+		const ImageSizeType nLines_;
+		SpscImageBuffer bands_;
+		std::shared_ptr<Storage> storage_;
+		std::exception_ptr error_;
+		std::atomic_bool stop_;
+		bool end_ = false;
+		ImageSizeType line_ = 0;
+		ImageSizeType lineNext_ = 0;
+		std::thread thread_;
+	};
+
+	/* Writes bands into a sink on a background thread, up to 'nBehind' bands behind the
+	caller; Write() blocks while that many bands are waiting.
+	An exception thrown by the sink is rethrown from the next Write() or Close(), and the
+	bands after it are discarded. The destructor calls Close() if not called yet, but
+	swallows its exception. The sink must outlive this object. */
+	class BandWriter
+	{
+	public:
+		explicit BandWriter(LineSink &sink, std::size_t nBehind = 1);
+		~BandWriter(void);
+		BandWriter(const BandWriter &) = delete;
+		BandWriter &operator=(const BandWriter &) = delete;
+
+		void Write(ImageFrame &&band);
+
+		// Waits for every band to be written, and closes the sink.
+		void Close(void);
+
+	protected:
+		void Run(void);
+		void RethrowError(void);
+
+		LineSink &sink_;
+		SpscImageBuffer bands_;
+		std::exception_ptr error_;
+		std::atomic_bool failed_;
+		bool closed_ = false;
+		std::thread thread_;
+	};
+
+	// Read-ahead and write-behind
+	////////////////////////////////////////////////////////////////////////////////////////
+}
+
+namespace Imaging
+{
+	////////////////////////////////////////////////////////////////////////////////////////
+	// BufferLineSource
+
+	template <typename BufferType>
+	BufferLineSource<BufferType>::BufferLineSource(BufferType &buffer) : buffer_(buffer)
+	{
+	}
+
+	template <typename BufferType>
+	bool BufferLineSource<BufferType>::Read(ImageFrame &band, ImageSizeType nLines)
+	{
+		ImageSizeType nRead = 0;
+		while (nRead != nLines && !this->end_)
+		{
+			// Pop the next chunk; an empty one is the end of the image.
+			if (this->line_ == this->chunk_.size.height)
+			{
+				while (!this->buffer_.try_pop(this->chunk_));
+				this->line_ = 0;
+				if (this->chunk_.data.empty())
+				{
+					this->end_ = true;
+					break;
+				}
+			}
+
+			// Only the effective bytes of each line are copied; zero-fill the padding.
+			auto bytes_eff = ImageFrame::GetBytesPerLine(this->chunk_.dataType,
+				this->chunk_.size.width, this->chunk_.depth);
+			if (nRead == 0)
+				band.Reset(this->chunk_.dataType, { this->chunk_.size.width, nLines },
+					this->chunk_.depth, this->chunk_.alignment,
+					bytes_eff == this->chunk_.bytesPerLine ? Init::None : Init::Zero);
+			else if (this->chunk_.dataType != band.dataType ||
+				this->chunk_.size.width != band.size.width ||
+				this->chunk_.depth != band.depth)
+			{
+				std::ostringstream errMsg;
+				errMsg << "The dimension of the chunk (" << this->chunk_.size.width <<
+					" x " << this->chunk_.depth << ") is not matched with the band (" <<
+					band.size.width << " x " << band.depth << ").";
+				throw std::invalid_argument(errMsg.str());
+			}
+
+			// Copy as many lines as the chunk has; the chunks may differ in alignment.
+			ImageSizeType n = std::min(nLines - nRead,
+				this->chunk_.size.height - this->line_);
+			CopyLines(&(*this->chunk_.Cbegin({ 0, this->line_ })),
+				this->chunk_.bytesPerLine, &(*band.Begin({ 0, nRead })), band.bytesPerLine,
+				bytes_eff, n);
+			nRead += n;
+			this->line_ += n;
+		}
+
+		// The last band of the image may be shorter.
+		if (nRead != 0 && nRead != nLines)
+			band.Reset(band.dataType, { band.size.width, nRead }, band.depth,
+				band.alignment);
+		return nRead != 0;
+	}
+
+	// BufferLineSource
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// BufferLineSink
+
+	namespace Internal
+	{
+		// Throws unless every chunk pushed into the buffer reaches the consumer.
+		inline void EvalLossless(const ImageBuffer &buffer)
+		{
+			if (buffer.GetOverflow() != Overflow::Block)
+			{
+				std::ostringstream errMsg;
+				errMsg << "The lines of an image must pass through an ImageBuffer " <<
+					"which waits for room (Overflow::Block).";
+				throw std::invalid_argument(errMsg.str());
+			}
+		}
+
+		// SpscImageBuffer always waits for room.
+		inline void EvalLossless(const SpscImageBuffer &)
+		{}
+
+		// Pushes a chunk, and throws if it is dropped or overwrites a previous one.
+		inline void PushChunk(ImageBuffer &buffer, ImageFrame &&chunk)
+		{
+			const auto overwritten = buffer.overwritten();
+			if (!buffer.push(std::move(chunk)) || buffer.overwritten() != overwritten)
+			{
+				std::ostringstream errMsg;
+				errMsg << "A chunk of lines is lost by the overflow policy of the buffer.";
+				throw std::runtime_error(errMsg.str());
+			}
+		}
+
+		inline void PushChunk(SpscImageBuffer &buffer, ImageFrame &&chunk)
+		{
+			buffer.push(std::move(chunk));
+		}
+	}
+
+	template <typename BufferType>
+	BufferLineSink<BufferType>::BufferLineSink(BufferType &buffer) : buffer_(buffer)
+	{
+		Internal::EvalLossless(buffer);
+	}
+
+	template <typename BufferType>
+	void BufferLineSink<BufferType>::Write(const ConstImageView &band)
+	{
+		Internal::PushChunk(this->buffer_, ImageFrame(band));
+	}
+
+	template <typename BufferType>
+	void BufferLineSink<BufferType>::Close(void)
+	{
+		Internal::PushChunk(this->buffer_, ImageFrame());
+	}
+
+	// BufferLineSink
+	////////////////////////////////////////////////////////////////////////////////////////
+}
+
+#endif
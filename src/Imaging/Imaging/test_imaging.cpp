@@ -1,10 +1,23 @@
+#include <algorithm>
 #include <iostream>
+#include <cstdint>
+#include <cstdio>
 
 #include "utilities/containers.h"
 #include "image.h"
+#include "image_block.h"
+#include "view.h"
+#include "typed_view.h"
+#include "arithmetic.h"
 #include "opencv_interface.h"
+#include "parallel.h"
+#include "pipeline.h"
+#include "raw_file.h"
+#include "stream.h"
+#include "tiled_image.h"
 
 #include "buffer.h"
+#include "priority_buffer.h"
 
 std::chrono::seconds WAIT_TIME(3);
 
@@ -116,6 +129,277 @@ void TestImage(void)
 	img1.Reset(DataType::INT, { 4, 8 }, 3);
 	img1.Reset(DataType::INT, { 12, 8 }, 1);
 	img1.Reset(DataType::INT, { 12, 8 });
+
+	// Lines aligned to 32 bytes; 12 x 3 bytes -> 64 bytes/line including padding bytes.
+	ImageFrame img2(DataType::UCHAR, { 12, 8 }, 3, 32);
+	if (img2.bytesPerLine == 64 && !img2.HaveZeroPaddingBytes())
+		std::cout << "good" << std::endl;
+	if (reinterpret_cast<std::uintptr_t>(&(*img2.Cbegin({ 0, 5 }))) % 32 == 0)
+		std::cout << "good" << std::endl;
+
+	// The ROI keeps the line alignment of the source.
+	*img2.Begin({ 2, 3 }) = 7;
+	ImageFrame img3 = img2.CopyTo({ { 2, 3 }, { 4, 4 } });
+	if (img3.alignment == 32 && img3.bytesPerLine == 32 && *img3.Cbegin() == 7)
+		std::cout << "good" << std::endl;
+
+	// Image data left uninitialized for a caller overwriting it.
+	ImageFrame img4(DataType::USHORT, { 4000, 4000 }, 1, 1, Init::None);
+	img4.Reset<unsigned short>({ 4000, 4000 }, 1, 1, Init::None);
+	std::fill(img4.Begin(), img4.Begin() + img4.data.size(), 1);
+	if (img4.data.size() == 4000 * 4000 * 2 && *img4.Cbegin({ 3999, 3999 }) == 1)
+		std::cout << "good" << std::endl;
+}
+
+// A burst of frames in a single allocation, handed to a consumer without copying.
+void TestImageBlock(void)
+{
+	using namespace Imaging;
+
+	ImageBlock block(DataType::USHORT, { 640, 480 }, 1, 8);
+	ImageFrame img1(DataType::USHORT, { 640, 480 });
+	*img1.Begin({ 639, 479 }) = 9;
+	block.CopyFrom(7, ConstImageView(img1));
+
+	// A slice and its frames share the image data with the block.
+	ImageBlock slice = block.Slice(4, 4);
+	ImageFrame img2 = slice.GetFrame(3);
+	if (img2.data == img1.data && &(*img2.Cbegin()) == &(*block.Cbegin(7)))
+		std::cout << "good" << std::endl;
+
+	ImageBuffer buffer(8);
+	block.PushTo(buffer);
+	ImageFrame img3;
+	for (auto n = 0; n != 8; ++n)
+		buffer.try_pop(img3);
+	if (*img3.Cbegin({ 639, 479 }) == 9)
+		std::cout << "good" << std::endl;
+}
+
+void TestImageView(void)
+{
+	using namespace Imaging;
+
+	ImageFrame img1(DataType::USHORT, { 64, 32 }, 3, 16);
+	*img1.Begin({ 12, 10 }) = 5;
+
+	// An ROI of an ROI without copying image data.
+	ImageView view1(img1);
+	ImageView view2 = view1.SubView({ { 10, 10 }, { 20, 10 } });
+	ConstImageView view3 = view2.SubView({ { 2, 0 }, { 4, 4 } });
+	if (view3.Cbegin() == &(*img1.Cbegin({ 12, 10 })) &&
+		view3.bytesPerLine == img1.bytesPerLine && *view3.Cbegin() == 5)
+		std::cout << "good" << std::endl;
+
+	// Deep copy only when necessary.
+	ImageFrame img2(view3);
+	if (img2.size == view3.size && *img2.Cbegin() == 5)
+		std::cout << "good" << std::endl;
+
+	// Crop a frame to its own ROI.
+	img1.CopyFrom(view3);
+	if (img1.size == img2.size && *img1.Cbegin() == 5)
+		std::cout << "good" << std::endl;
+}
+
+// Sums up all channel values regardless of the data type and the number of channels.
+struct SumKernel
+{
+	template <typename T, std::size_t C>
+	double operator()(Imaging::TypedView<const T, C> view) const
+	{
+		double sum = 0;
+		for (Imaging::ImageSizeType y = 0; y != view.size.height; ++y)
+		{
+			const T *line = view.Row(y);
+			for (Imaging::ImageSizeType x = 0; x != view.size.width * view.depth; ++x)
+				sum += line[x];
+		}
+		return sum;
+	}
+};
+
+void TestTypedView(void)
+{
+	using namespace Imaging;
+
+	ImageFrame img1(DataType::FLOAT, { 16, 8 }, 3, 32);
+	TypedView<float, 3> view1(img1);
+	for (ImageSizeType y = 0; y != view1.size.height; ++y)
+		for (ImageSizeType x = 0; x != view1.size.width; ++x)
+			view1.At(x, y, 2) = 0.5f;
+
+	// Runtime DataType and depth -> TypedView<const float, 3>
+	double sum = Dispatch(ConstImageView(img1), SumKernel());
+	if (sum == 16 * 8 * 0.5)
+		std::cout << "good" << std::endl;
+}
+
+void TestArithmetic(void)
+{
+	using namespace Imaging;
+
+	// Padded lines whose width is not a multiple of the vector size.
+	ImageFrame img1(DataType::UCHAR, { 17, 5 }, 3, 32), img2(DataType::UCHAR, { 17, 5 }, 3, 32);
+	std::fill(img1.Begin(), img1.Begin() + img1.data.size(), 200);
+	std::fill(img2.Begin(), img2.Begin() + img2.data.size(), 100);
+
+	ImageFrame img3;
+	Add(img1, img2, img3);
+	Add(img1, img2, ImageView(img1), OverflowMode::WRAP);	// in-place
+	if (*img3.Cbegin({ 16, 4 }) == static_cast<char>(255) &&
+		*img1.Cbegin({ 16, 4 }) == static_cast<char>(44))
+		std::cout << "good" << std::endl;
+
+	AbsDiff(img1, img2, img3);
+	if (*img3.Cbegin({ 16, 4 }) == static_cast<char>(56))
+		std::cout << "good" << std::endl;
+
+	// Only an ROI.
+	ImageFrame img4(DataType::FLOAT, { 16, 8 }, 1), img5(DataType::FLOAT, { 4, 4 }, 1);
+	ConstImageView view4 = ConstImageView(img4).SubView({ { 2, 2 }, { 4, 4 } });
+	Subtract(view4, view4, img5);
+	if (*reinterpret_cast<const float *>(&(*img5.Cbegin({ 3, 3 }))) == 0.0f)
+		std::cout << "good" << std::endl;
+}
+
+void TestParallelCopy(void)
+{
+	using namespace Imaging;
+
+	// 12 MPix x 2 bytes; large enough to be copied in bands with non-temporal stores.
+	ImageFrame img1(DataType::USHORT, { 4001, 3000 }, 1, 64);
+	TypedView<unsigned short, 1> view1(img1);
+	for (ImageSizeType y = 0; y != view1.size.height; ++y)
+		for (ImageSizeType x = 0; x != view1.size.width; ++x)
+			view1.At(x, y) = static_cast<unsigned short>(x + y);
+
+	ImageFrame::ROI roi({ 1, 2 }, { 4000, 2998 });
+	ImageFrame img2 = img1.CopyTo(roi);
+	TypedView<const unsigned short, 1> view2(img2);
+	if (view2.At(0, 0) == 3 && view2.At(3999, 2997) == 6999)
+		std::cout << "good" << std::endl;
+
+	// Source without padding bytes into lines aligned to 64 bytes.
+	ImageFrame img3;
+	img3.CopyFrom(&(*img2.Cbegin()), img2.dataType, img2.size, img2.depth, img2.bytesPerLine,
+		64);
+	if (img3.data == img2.data)
+		std::cout << "good" << std::endl;
+}
+
+// Fills every pixel with its line index in bands, and checks it back in tiles.
+void TestParallelForRows(void)
+{
+	using namespace Imaging;
+
+	ImageFrame img(DataType::USHORT, { 4001, 3000 }, 1, 64);
+	ParallelForRows(img, [](const ImageView &band, const ImageFrame::ROI &roi)
+	{
+		TypedView<unsigned short, 1> view(band);
+		for (ImageSizeType y = 0; y != view.size.height; ++y)
+			for (ImageSizeType x = 0; x != view.size.width; ++x)
+				view.At(x, y) = static_cast<unsigned short>(roi.origin.y + y);
+	});
+
+	std::atomic_size_t nErrors(0);
+	const ImageFrame &imgSrc = img;
+	ParallelForTiles(imgSrc, { 256, 256 },
+		[&nErrors](const ConstImageView &tile, const ImageFrame::ROI &roi)
+	{
+		TypedView<const unsigned short, 1> view(tile);
+		for (ImageSizeType y = 0; y != view.size.height; ++y)
+			for (ImageSizeType x = 0; x != view.size.width; ++x)
+				if (view.At(x, y) != roi.origin.y + y)
+					++nErrors;
+	});
+	if (nErrors == 0)
+		std::cout << "good" << std::endl;
+}
+
+void TestStorage(void)
+{
+	using namespace Imaging;
+
+	// Blocks are recycled by the slab storage.
+	ImageFrame img1;
+	img1.SetStorage(std::make_shared<SlabStorage>());
+	img1.Reset(DataType::UCHAR, { 640, 480 });
+	const ImageFrame::ByteType *ptr = &(*img1.Cbegin());
+	img1.Clear();
+	img1.Reset(DataType::UCHAR, { 640, 480 });
+	if (&(*img1.Cbegin()) == ptr && *img1.Cbegin() == 0)
+		std::cout << "good" << std::endl;
+
+	ImageFrame img2;
+	img2.SetStorage(std::make_shared<HugePageStorage>());
+	img2.Reset(DataType::FLOAT, { 1920, 1080 }, 3, 64);
+	if (img2.data.size() == 1920 * 1080 * 3 * 4)
+		std::cout << "good" << std::endl;
+
+	// The image data of a mapped file is kept after the frame is gone.
+	{
+		ImageFrame img3;
+		img3.SetStorage(std::make_shared<MappedFileStorage>("storage.raw"));
+		img3.Reset(DataType::USHORT, { 100, 100 });
+		*img3.Begin({ 1, 1 }) = 5;
+	}
+	{
+		ImageFrame img4;
+		img4.SetStorage(std::make_shared<MappedFileStorage>("storage.raw"));
+		img4.Reset(DataType::USHORT, { 100, 100 });
+		if (*img4.Cbegin({ 1, 1 }) == 5)
+			std::cout << "good" << std::endl;
+	}
+	std::remove("storage.raw");	// unmapped with the frames.
+
+	// External buffer released by its deleter.
+	bool released = false;
+	{
+		ImageFrame img5;
+		std::vector<ImageFrame::ByteType> buffer(64 * 10);
+		img5.Adopt(buffer.data(), DataType::UCHAR, { 64, 10 }, 1, 64,
+			[&released](ImageFrame::ByteType *) { released = true; });
+		ImageFrame img6 = img5;
+	}
+	if (released)
+		std::cout << "good" << std::endl;
+}
+
+void TestRawFile(void)
+{
+	using namespace Imaging;
+
+	ImageFrame img1(DataType::USHORT, { 1001, 500 }, 3, 16);
+	*img1.Begin({ 1000, 499 }) = 9;
+	WriteRawFile("test.raw", img1);
+
+	// Modifying a copy-on-write frame leaves the file as is.
+	ImageFrame img2 = OpenRawFile("test.raw");
+	if (img2.data == img1.data && img2.bytesPerLine == img1.bytesPerLine)
+		std::cout << "good" << std::endl;
+	*img2.Begin({ 1000, 499 }) = 3;
+
+	ImageFrame img3 = OpenRawFile("test.raw", MappedFileStorage::Access::ReadWrite);
+	if (*img3.Cbegin({ 1000, 499 }) == 9)
+		std::cout << "good" << std::endl;
+}
+
+// Extracts an ROI across tile borders without loading the whole image.
+void TestTiledImage(void)
+{
+	using namespace Imaging;
+
+	ImageFrame img1(DataType::USHORT, { 1001, 500 }, 3, 16);
+	*img1.Begin({ 300, 200 }) = 9;
+	WriteRawFile("test.raw", img1);
+
+	// At most 4 tiles of 256 x 256 pixels are resident.
+	TiledImage img2(std::make_shared<RawFileTileStore>("test.raw"), { 256, 256 }, 4);
+	ImageFrame::ROI roi({ 200, 100 }, { 400, 300 });
+	if (img2.CopyTo(roi).data == img1.CopyTo(roi).data)
+		std::cout << "good" << std::endl;
+	std::cout << "Tiles read: " << img2.misses() << std::endl;
 }
 
 void TestImageProcessing(void)
@@ -128,15 +412,11 @@ void TestImageProcessing(void)
 	cv::imshow(std::string("Source 1"), cvSrc1);
 	cv::waitKey(0);
 
-	// Copy image data from cv::Mat object to ImageFrame.
-	ImageFrame img1;
-	ImageSize szSrc1;
-	Utilities::Cast(cvSrc1.cols, szSrc1.width);
-	Utilities::Cast(cvSrc1.rows, szSrc1.height);
-	img1.CopyFrom(reinterpret_cast<const ImageFrame::ByteType *>(cvSrc1.ptr()),
-		GetDataType(cvSrc1.depth()), szSrc1, cvSrc1.channels(),
-		cvSrc1.cols * cvSrc1.channels() * cvSrc1.elemSize1());
-	
+	// Move image data from cv::Mat object to ImageFrame without copying it.
+	ImageFrame img1 = CreateImageFrame(std::move(cvSrc1));
+	if (cvSrc1.empty())
+		std::cout << "good" << std::endl;
+
 	// Copy image data from ImageFrame to cv::Mat.
 	cv::Mat cvDst1 = CreateCvMat(img1);
 	cv::namedWindow(std::string("Copied 1"), CV_WINDOW_AUTOSIZE);
@@ -155,7 +435,48 @@ void TestImageProcessing(void)
 	cv::waitKey(0);
 }
 
-void Pop(int id, Imaging::ImageBuffer &buffer, std::size_t count)
+void TestCvMatShared(void)
+{
+	using namespace Imaging;
+
+	// Lines padded from 300 to 320 bytes.
+	ImageFrame img1(DataType::UCHAR, { 100, 20 }, 3, 64);
+	cv::Mat cvDst1 = CreateCvMatShared(img1);
+	cvDst1.at<cv::Vec3b>(5, 10)[0] = 7;
+	if (cvDst1.step[0] == img1.bytesPerLine && *img1.Cbegin({ 10, 5 }) == 7)
+		std::cout << "good" << std::endl;
+
+	// The cv::Mat keeps the image data after the ImageFrame is gone.
+	img1.Clear();
+	if (cvDst1.at<cv::Vec3b>(5, 10)[0] == 7)
+		std::cout << "good" << std::endl;
+
+	// Share it back, and then the data of a cv::Mat from OpenCV.
+	ImageFrame img2 = CreateImageFrameShared(cvDst1);
+	if (img2.Begin() == reinterpret_cast<ImageFrame::ByteType *>(cvDst1.data) &&
+		img2.alignment == 64 && *img2.Cbegin({ 10, 5 }) == 7)
+		std::cout << "good" << std::endl;
+
+	cv::Mat cvSrc2(480, 640, CV_16UC1, cv::Scalar(3));
+	ImageFrame img3 = CreateImageFrameShared(cvSrc2);
+	cvSrc2.release();
+	if (img3.dataType == DataType::USHORT && *img3.Cbegin() == 3)
+		std::cout << "good" << std::endl;
+
+	// An ROI of a larger cv::Mat is not laid out with a line alignment.
+	cv::Mat cvSrc3(cvDst1, cv::Rect(1, 1, 50, 10));
+	try
+	{
+		ImageFrame img4 = CreateImageFrameShared(cvSrc3);
+	}
+	catch (const std::runtime_error &)
+	{
+		std::cout << "good" << std::endl;
+	}
+}
+
+template <typename BufferType>
+void Pop(int id, BufferType &buffer, std::size_t count)
 {	
 	for (auto n = 0; n != count; ++n)
 	{
@@ -170,8 +491,8 @@ void Pop(int id, Imaging::ImageBuffer &buffer, std::size_t count)
 	}
 }
 
-void Push(int id, const Imaging::ImageFrame &imgSrc, Imaging::ImageBuffer &buffer,
-	std::size_t count)
+template <typename BufferType>
+void Push(int id, const Imaging::ImageFrame &imgSrc, BufferType &buffer, std::size_t count)
 {
 	for (auto n = 0; n != count; ++n)
 	{
@@ -194,11 +515,11 @@ void TestBuffer(void)
 	ImageFrame imgSrc;
 	imgSrc.Reset(DataType::UCHAR, { 512, 512 });
 
-	std::thread c1(Pop, 1, std::ref(buffer), 20);
-	std::thread c2(Pop, 2, std::ref(buffer), 20);
-	std::thread c3(Pop, 3, std::ref(buffer), 21);
-	std::thread p1(Push, 1, std::ref(imgSrc), std::ref(buffer), 30);
-	std::thread p2(Push, 2, std::ref(imgSrc), std::ref(buffer), 30);
+	std::thread c1(Pop<ImageBuffer>, 1, std::ref(buffer), 20);
+	std::thread c2(Pop<ImageBuffer>, 2, std::ref(buffer), 20);
+	std::thread c3(Pop<ImageBuffer>, 3, std::ref(buffer), 21);
+	std::thread p1(Push<ImageBuffer>, 1, std::ref(imgSrc), std::ref(buffer), 30);
+	std::thread p2(Push<ImageBuffer>, 2, std::ref(imgSrc), std::ref(buffer), 30);
 
 	c1.join();
 	c2.join();
@@ -207,11 +528,307 @@ void TestBuffer(void)
 	p2.join();
 }
 
+// Only one producer and one consumer are allowed.
+void TestSpscBuffer(void)
+{
+	using namespace Imaging;
+
+	SpscImageBuffer buffer(4);
+	ImageFrame imgSrc;
+	imgSrc.Reset(DataType::UCHAR, { 512, 512 });
+
+	std::thread c1(Pop<SpscImageBuffer>, 1, std::ref(buffer), 60);
+	std::thread p1(Push<SpscImageBuffer>, 1, std::ref(imgSrc), std::ref(buffer), 60);
+
+	c1.join();
+	p1.join();
+}
+
+// Recycles frames between a producer and a consumer through a FramePool.
+void TestFramePool(void)
+{
+	using namespace Imaging;
+
+	FramePool pool(DataType::UCHAR, { 512, 512 }, 1, 8);
+	ImageBuffer buffer(4, pool);
+
+	std::thread p1([&pool, &buffer](){
+		for (auto n = 0; n != 100; ++n)
+		{
+			ImageFrame img = pool.acquire();	// No allocation if the pool is not empty.
+			*img.Begin() = static_cast<ImageFrame::ByteType>(n);
+			buffer.push(std::move(img));
+		}
+	});
+	std::thread c1([&buffer](){
+		ImageFrame img;
+		for (auto n = 0; n != 100; ++n)
+			buffer.try_pop(img);	// The previous frame goes back to the pool.
+	});
+
+	p1.join();
+	c1.join();
+	std::cout << "Frames allocated while streaming: " << pool.misses() << std::endl;
+
+	// A frame whose data is still shared stays with its sharers instead of the pool.
+	const std::size_t available = pool.available();
+	ImageFrame img = pool.acquire();
+	std::shared_ptr<void> sharer = img.data.owner();
+	pool.release(std::move(img));
+	std::cout << "Shared frame taken by the pool: " << (pool.available() != available - 1) <<
+		std::endl;
+}
+
+// Transfers frames in batches of 8, taking the lock once per batch.
+void TestBatchBuffer(void)
+{
+	using namespace Imaging;
+
+	ImageBuffer buffer(16);
+	ImageFrame imgSrc;
+	imgSrc.Reset(DataType::UCHAR, { 512, 512 });
+
+	std::thread p1([&imgSrc, &buffer](){
+		std::vector<ImageFrame> imgs;
+		for (auto n = 0; n != 10; ++n)
+		{
+			for (auto m = 0; m != 8; ++m)
+				imgs.push_back(imgSrc);
+			buffer.push_n(imgs.begin(), imgs.size());
+			imgs.clear();
+		}
+	});
+	std::thread c1([&buffer](){
+		std::vector<ImageFrame> imgs(8);
+		std::size_t count = 0;
+		while (count != 80)
+		{
+			auto n = buffer.try_pop_n(imgs.begin(), imgs.size());
+			if (n == 0)
+				break;
+			count += n;
+		}
+		std::cout << "Frames popped in batches: " << count << std::endl;
+	});
+
+	p1.join();
+	c1.join();
+}
+
+// A live preview keeps only the latest frames, and never holds up the producer.
+void TestOverflow(void)
+{
+	using namespace Imaging;
+
+	FramePool pool(DataType::UCHAR, { 512, 512 }, 1, 8);
+	ImageBuffer buffer(2, pool);
+	buffer.SetOverflow(Overflow::DropOldest);
+
+	std::thread p1([&pool, &buffer](){
+		for (auto n = 0; n != 100; ++n)
+			buffer.push(pool.acquire());	// The overwritten frame goes back to the pool.
+	});
+	std::thread c1([&buffer](){
+		ImageFrame img;
+		while (buffer.try_pop(img, std::chrono::seconds(1)))
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));	// slow preview
+	});
+
+	p1.join();
+	c1.join();
+	std::cout << "Frames overwritten: " << buffer.overwritten() << ", dropped: " <<
+		buffer.dropped() << ", allocated while streaming: " << pool.misses() << std::endl;
+}
+
+// A slow consumer holds up the producer; the statistics show which side waits.
+void TestBufferStats(void)
+{
+	using namespace Imaging;
+
+	ImageBuffer buffer(4);
+	std::thread p1([&buffer](){
+		for (auto n = 0; n != 100; ++n)
+			buffer.push(ImageFrame(DataType::UCHAR, { 512, 512 }, 1));
+	});
+	std::thread c1([&buffer](){
+		ImageFrame img;
+		while (buffer.try_pop(img, std::chrono::seconds(1)))
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	});
+	p1.join();
+	c1.join();
+
+	auto stats = buffer.stats();
+	auto toMs = [](const ImageBufferStats::Duration &d)
+	{
+		return std::chrono::duration_cast<std::chrono::milliseconds>(d).count();
+	};
+	std::cout << "Frames popped: " << stats.popped << ", high-water mark: " <<
+		stats.highWater << "/" << stats.capacity << ", producer blocked: " <<
+		toMs(stats.producerBlocked) << " ms, consumer idle: " <<
+		toMs(stats.consumerIdle) << " ms" << std::endl;
+	std::cout << "Latency p50: " << toMs(stats.latency.percentile(0.5)) << " ms, p99: " <<
+		toMs(stats.latency.percentile(0.99)) << " ms, max: " <<
+		toMs(stats.latency.maximum()) << " ms" << std::endl;
+}
+
+// A low-latency consumer waits 200 us per frame, and polls between frames.
+void TestTimedWait(void)
+{
+	using namespace Imaging;
+
+	SpscImageBuffer buffer(4);
+	std::thread p1([&buffer](){
+		for (auto n = 0; n != 100; ++n)
+		{
+			buffer.push(ImageFrame(DataType::UCHAR, { 512, 512 }, 1));
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+		}
+	});
+
+	// Gives up after a second on the steady clock.
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+	std::size_t nFrames = 0, nTimeouts = 0;
+	ImageFrame img;
+	while (nFrames != 100 && std::chrono::steady_clock::now() < deadline)
+	{
+		if (buffer.try_pop_now(img) || buffer.try_pop(img, std::chrono::microseconds(200)))
+			++nFrames;
+		else
+			++nTimeouts;
+	}
+	p1.join();
+	std::cout << "Frames popped: " << nFrames << ", waits timed out: " << nTimeouts <<
+		std::endl;
+}
+
+// Live inspection frames in lane 0 overtake a backlog of archival frames in lane 1.
+void TestPriorityBuffer(void)
+{
+	using namespace Imaging;
+
+	PriorityImageBuffer buffer({ 4, 16 });
+	ImageFrame imgSrc;
+	imgSrc.Reset(DataType::UCHAR, { 512, 512 });
+
+	for (auto n = 0; n != 16; ++n)
+		buffer.push(1, ImageFrame(imgSrc));
+	buffer.push(0, ImageFrame(imgSrc));
+
+	ImageFrame img;
+	std::size_t lane;
+	buffer.try_pop(img, lane);
+	std::cout << "The first frame is popped from lane " << lane << std::endl;
+
+	// With weights of { 2, 1 }, lane 1 gets every third frame while lane 0 is busy.
+	PriorityImageBuffer weighted({ 16, 16 }, { 2, 1 });
+	for (auto n = 0; n != 6; ++n)
+	{
+		weighted.push(0, ImageFrame(imgSrc));
+		weighted.push(1, ImageFrame(imgSrc));
+	}
+	while (weighted.try_pop_now(img, lane))
+		std::cout << lane;
+	std::cout << std::endl;
+}
+
+// TestBuffer() without threads of its own: a camera, 4 threads of processing, and a sink.
+void TestPipeline(void)
+{
+	using namespace Imaging;
+
+	Pipeline pipeline;
+	auto n = 0;
+	auto camera = pipeline.AddSource([&n](ImageFrame &img)
+	{
+		if (n++ == 100)
+			return false;	// end of the stream
+		img.Reset(DataType::UCHAR, { 512, 512 }, 1, 1, Init::None);
+		return true;
+	});
+	auto process = pipeline.AddTransform([](ImageFrame &img)
+	{
+		*img.Begin() = 0;
+		return true;
+	}, 4);
+	std::atomic_size_t nFrames(0);
+	auto sink = pipeline.AddSink([&nFrames](ImageFrame &) { ++nFrames; });
+	pipeline.Connect(camera, process);
+	pipeline.Connect(process, sink);
+
+	// Returns after every frame is drained through the stages.
+	pipeline.Run();
+	std::cout << "Frames through the pipeline: " << nFrames << std::endl;
+}
+
+// Streams an image in bands between a raw image file and a buffer.
+void TestStream(void)
+{
+	using namespace Imaging;
+
+	ImageFrame img1(DataType::USHORT, { 1001, 500 }, 3, 16);
+	*img1.Begin({ 1000, 499 }) = 9;
+	WriteRawFile("test.raw", img1);
+
+	// File -> buffer in bands of 64 lines, read one band ahead.
+	SpscImageBuffer buffer(4);
+	std::thread p1([&buffer](){
+		RawFileLineSource source("test.raw");
+		BandReader reader(source, 64);
+		BufferLineSink<SpscImageBuffer> sink(buffer);
+		ImageFrame band;
+		while (reader.Read(band))
+			sink.Write(ConstImageView(band));
+		sink.Close();
+	});
+
+	// Buffer -> file in bands of 100 lines, written one band behind.
+	BufferLineSource<SpscImageBuffer> source(buffer);
+	RawFileLineSink sink("test2.raw", 16);
+	BandWriter writer(sink);
+	ImageFrame band;
+	while (source.Read(band, 100))
+		writer.Write(std::move(band));
+	writer.Close();
+	p1.join();
+
+	if (OpenRawFile("test2.raw").data == img1.data)
+		std::cout << "good" << std::endl;
+
+	// An ROI at an x offset is written line by line with zero padding bytes.
+	{
+		RawFileLineSink sinkRoi("test2.raw", 16);
+		sinkRoi.Write(ConstImageView(img1).SubView({ { 1, 0 }, { 1000, 500 } }));
+	}
+	ImageFrame img2 = OpenRawFile("test2.raw");
+	if (img2.size.width == 1000 && *img2.Cbegin({ 999, 499 }) == 9)
+		std::cout << "good" << std::endl;
+}
+
 int main(void)
 {
 	//TestPoint2D();
 	//TestROI();
 	//TestImage();
+	//TestImageBlock();
+	//TestImageView();
+	//TestTypedView();
+	//TestArithmetic();
+	//TestParallelCopy();
+	//TestParallelForRows();
+	//TestStorage();
+	//TestRawFile();
+	//TestTiledImage();
 	//TestImageProcessing();
+	//TestCvMatShared();
 	TestBuffer();
+	//TestSpscBuffer();
+	//TestFramePool();
+	//TestBatchBuffer();
+	//TestOverflow();
+	//TestBufferStats();
+	//TestTimedWait();
+	//TestPriorityBuffer();
+	//TestPipeline();
+	//TestStream();
 }
\ No newline at end of file
@@ -0,0 +1,315 @@
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+
+#if defined(_WIN32)
+#if !defined(NOMINMAX)
+#define NOMINMAX
+#endif
+#include <windows.h>
+#elif defined(__linux__)
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include "thread_pool.h"
+
+namespace Imaging
+{
+	namespace Internal
+	{
+		/* Lazily constructed singletons of the library.
+
+		Visual Studio 2013 initializes function-local statics without synchronization,
+		and its std::once_flag has no constexpr constructor, so a function-local
+		std::once_flag is no guard either. The std::once_flag of each singleton and the
+		pointer to it are at namespace scope instead, where they are initialized before
+		main() while a single thread runs, and std::call_once() then constructs the
+		singleton on first use from any thread. Therefore, a singleton must not be used
+		during the initialization of static objects. */
+		std::once_flag poolFlag;
+		std::unique_ptr<ThreadPool> pool;
+
+		// Logical processors of each NUMA node; empty if unknown.
+		std::vector<std::vector<unsigned int>> GetNumaNodes(void)
+		{
+			std::vector<std::vector<unsigned int>> nodes;
+#if defined(_WIN32)
+			ULONG highest = 0;
+			if (!::GetNumaHighestNodeNumber(&highest))
+				return nodes;
+			for (ULONG node = 0; node <= highest; ++node)
+			{
+				ULONGLONG mask = 0;
+				if (!::GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &mask))
+					continue;
+				std::vector<unsigned int> cpus;
+				for (unsigned int cpu = 0; cpu != 64; ++cpu)
+					if ((mask & (ULONGLONG(1) << cpu)) != 0)
+						cpus.push_back(cpu);
+				if (!cpus.empty())
+					nodes.push_back(cpus);
+			}
+#elif defined(__linux__)
+			for (unsigned int node = 0;; ++node)
+			{
+				std::ostringstream path;
+				path << "/sys/devices/system/node/node" << node << "/cpulist";
+				std::ifstream file(path.str());
+				if (!file)
+					break;
+
+				// Ranges of processors, e.g. "0-15,32-47".
+				std::vector<unsigned int> cpus;
+				unsigned int first, last;
+				char separator;
+				while (file >> first)
+				{
+					last = first;
+					if (file.peek() == '-')
+						file >> separator >> last;
+					for (auto cpu = first; cpu <= last; ++cpu)
+						cpus.push_back(cpu);
+					if (file.peek() != ',')
+						break;
+					file >> separator;
+				}
+				if (!cpus.empty())
+					nodes.push_back(cpus);
+			}
+#endif
+			return nodes;
+		}
+
+		// Restricts the thread to the given logical processors if the platform supports it.
+		void SetAffinity(std::thread &thread, const std::vector<unsigned int> &cpus)
+		{
+#if defined(_WIN32)
+			DWORD_PTR mask = 0;
+			for (auto cpu : cpus)
+				if (cpu < sizeof(DWORD_PTR) * 8)
+					mask |= DWORD_PTR(1) << cpu;
+			if (mask != 0)
+				::SetThreadAffinityMask(thread.native_handle(), mask);
+#elif defined(__linux__)
+			cpu_set_t set;
+			CPU_ZERO(&set);
+			for (auto cpu : cpus)
+				if (cpu < CPU_SETSIZE)
+					CPU_SET(cpu, &set);
+			::pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set);
+#else
+			(void)thread;
+			(void)cpus;
+#endif
+		}
+	}
+
+	ThreadPool::Job::Job(std::size_t n, const std::function<void(std::size_t)> &f) :
+		func(f), nTasks(n), done(0)
+	{}
+
+	/* Every queue exists before the first worker starts, so a worker may steal from any of
+	them right away. */
+	ThreadPool::ThreadPool(std::size_t nThreads, Affinity affinity) : nQueued_(0)
+	{
+		for (std::size_t n = 0; n != nThreads + 1; ++n)
+			this->queues_.push_back(std::unique_ptr<Queue>(new Queue()));
+
+		std::vector<std::vector<unsigned int>> nodes;
+		if (affinity == Affinity::NumaNodes)
+			nodes = Internal::GetNumaNodes();
+		const unsigned int nCpus = std::max(1U, std::thread::hardware_concurrency());
+
+		this->workers_.reserve(nThreads);
+		for (std::size_t n = 0; n != nThreads; ++n)
+		{
+			this->workers_.push_back(std::thread(&ThreadPool::Work, this, n));
+			if (affinity == Affinity::Cores)
+				Internal::SetAffinity(this->workers_.back(),
+				{ static_cast<unsigned int>((n + 1) % nCpus) });
+			else if (affinity == Affinity::NumaNodes && !nodes.empty())
+				Internal::SetAffinity(this->workers_.back(), nodes[n % nodes.size()]);
+		}
+	}
+
+	ThreadPool::~ThreadPool(void)
+	{
+		{
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			this->stop_ = true;
+		}
+		this->cvJob_.notify_all();
+		for (auto &worker : this->workers_)
+			worker.join();
+	}
+
+	std::size_t ThreadPool::GetNumThreads(void) const
+	{
+		return this->workers_.size() + 1;
+	}
+
+	void ThreadPool::ParallelFor(std::size_t nTasks,
+		const std::function<void(std::size_t)> &func)
+	{
+		if (nTasks == 0)
+			return;
+		else if (nTasks == 1 || this->workers_.empty())
+		{
+			for (std::size_t n = 0; n != nTasks; ++n)
+				func(n);
+			return;
+		}
+
+		// One range per queue, starting with the own queue of the caller.
+		auto job = std::make_shared<Job>(nTasks, func);
+		const std::size_t self = this->FindQueue();
+		const std::size_t nQueues = this->queues_.size();
+		const std::size_t nRanges = std::min(nTasks, nQueues);
+		{
+			// Counted first, so a thief never takes a task that is not counted yet.
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			this->nQueued_ += nTasks;
+			for (std::size_t n = 0; n != nRanges; ++n)
+			{
+				Range range = { job, nTasks * n / nRanges, nTasks * (n + 1) / nRanges };
+				Queue &queue = *this->queues_[(self + n) % nQueues];
+				std::lock_guard<std::mutex> lockQueue(queue.mutex);
+				if (n == 0)
+					queue.ranges.push_front(range);
+				else
+					queue.ranges.push_back(range);
+			}
+		}
+		this->cvJob_.notify_all();
+
+		// Take part until every task is taken, and then wait for the tasks of the others.
+		std::shared_ptr<Job> task;
+		std::size_t index;
+		while (job->done != job->nTasks && this->TakeTask(self, task, index))
+			this->RunTask(*task, index);
+		{
+			std::unique_lock<std::mutex> lock(this->mutex_);
+			this->cvDone_.wait(lock, [&job](void) { return job->done == job->nTasks; });
+		}
+		if (job->error)
+			std::rethrow_exception(job->error);
+	}
+
+	std::size_t ThreadPool::FindQueue(void) const
+	{
+		auto id = std::this_thread::get_id();
+		for (std::size_t n = 0; n != this->workers_.size(); ++n)
+			if (this->workers_[n].get_id() == id)
+				return n;
+		return this->workers_.size();
+	}
+
+	bool ThreadPool::TakeTask(std::size_t self, std::shared_ptr<Job> &job,
+		std::size_t &index)
+	{
+		// The front of the own queue.
+		Queue &queue = *this->queues_[self];
+		{
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (!queue.ranges.empty())
+			{
+				Range &range = queue.ranges.front();
+				job = range.job;
+				index = range.first++;
+				if (range.first == range.last)
+					queue.ranges.pop_front();
+				--this->nQueued_;
+				return true;
+			}
+		}
+
+		// The back half of the last range of another queue; the rest of the half goes to
+		// the own queue, so it can be stolen in turn.
+		const std::size_t nQueues = this->queues_.size();
+		for (std::size_t n = 1; n != nQueues; ++n)
+		{
+			Queue &victim = *this->queues_[(self + n) % nQueues];
+			Range stolen;
+			{
+				std::lock_guard<std::mutex> lock(victim.mutex);
+				if (victim.ranges.empty())
+					continue;
+				Range &range = victim.ranges.back();
+				stolen = range;
+				stolen.first = range.last - (range.last - range.first + 1) / 2;
+				range.last = stolen.first;
+				if (range.first == range.last)
+					victim.ranges.pop_back();
+			}
+
+			job = stolen.job;
+			index = stolen.first++;
+			if (stolen.first != stolen.last)
+			{
+				std::lock_guard<std::mutex> lock(queue.mutex);
+				queue.ranges.push_back(stolen);
+			}
+			--this->nQueued_;
+			return true;
+		}
+		return false;
+	}
+
+	void ThreadPool::RunTask(Job &job, std::size_t index)
+	{
+		try
+		{
+			job.func(index);
+		}
+		catch (...)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			if (!job.error)
+				job.error = std::current_exception();
+		}
+
+		// The last one wakes up the caller. Notifying under the lock, so the caller cannot
+		// miss it between checking the counter and waiting.
+		if (++job.done == job.nTasks)
+		{
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			this->cvDone_.notify_all();
+		}
+	}
+
+	/* nQueued_ may be non-zero for a moment while a thief moves a stolen range to its own
+	queue; the worker then looks again instead of sleeping. */
+	void ThreadPool::Work(std::size_t self)
+	{
+		for (;;)
+		{
+			std::shared_ptr<Job> job;
+			std::size_t index;
+			if (this->TakeTask(self, job, index))
+			{
+				this->RunTask(*job, index);
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(this->mutex_);
+			this->cvJob_.wait(lock, [this](void)
+			{
+				return this->stop_ || this->nQueued_ != 0;
+			});
+			if (this->stop_ && this->nQueued_ == 0)
+				return;
+		}
+	}
+
+	// See Internal::poolFlag.
+	ThreadPool &ThreadPool::GetInstance(void)
+	{
+		std::call_once(Internal::poolFlag, [](void)
+		{
+			unsigned int n = std::thread::hardware_concurrency();
+			Internal::pool.reset(new ThreadPool(n > 1 ? n - 1 : 0));
+		});
+		return *Internal::pool;
+	}
+}
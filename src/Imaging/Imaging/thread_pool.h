@@ -0,0 +1,114 @@
+#if !defined(THREAD_POOL_H)
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Imaging
+{
+	/* Fixed number of worker threads running data parallel jobs.
+
+	ParallelFor(n, func) calls func(0), func(1), ... func(n - 1) across the worker threads and
+	the calling thread, and returns after all of them are done. A job should be split into a
+	few tasks per thread (e.g. bands of lines, see parallel.h) rather than one task per
+	element.
+	If a task throws, the remaining tasks still run, and the first exception is rethrown
+	from ParallelFor().
+
+	Work stealing.
+	Every worker has its own queue of index ranges, and the threads calling ParallelFor()
+	from outside share one more. A job is split into one contiguous range per queue,
+	starting with the queue of the caller, and each thread runs the indices of its own
+	queue in order, so neighboring tasks (e.g. neighboring bands) stay on one core. A thread
+	out of work steals the back half of a range from another queue, so a slow core or a
+	core busy with another job does not hold up the rest.
+
+	Multiple threads may call ParallelFor() at the same time. A task may call ParallelFor()
+	as well; the nested job goes to the front of the queue of the worker, and the caller
+	always takes part in its own job instead of waiting idle.
+
+	Affinity.
+	Affinity::Cores pins worker n to logical processor n + 1, leaving the first one to the
+	main thread, and Affinity::NumaNodes spreads the workers over the NUMA nodes in turn,
+	each free to run on any processor of its node. Pinning is skipped where the platform
+	does not support it; on Windows, only the first processor group is used.
+
+	GetInstance() returns a process wide pool with one thread less than the number of
+	hardware threads, so the caller makes up the last one. */
+	class ThreadPool
+	{
+	public:
+		enum class Affinity
+		{
+			None,
+			Cores,
+			NumaNodes
+		};
+
+		explicit ThreadPool(std::size_t nThreads, Affinity affinity = Affinity::None);
+		~ThreadPool(void);
+		ThreadPool(const ThreadPool &) = delete;
+		ThreadPool &operator=(const ThreadPool &) = delete;
+
+		// Number of threads running a job, including the caller.
+		std::size_t GetNumThreads(void) const;
+
+		void ParallelFor(std::size_t nTasks, const std::function<void(std::size_t)> &func);
+
+		static ThreadPool &GetInstance(void);
+
+	protected:
+		struct Job
+		{
+			Job(std::size_t n, const std::function<void(std::size_t)> &f);
+
+			const std::function<void(std::size_t)> &func;
+			const std::size_t nTasks;
+			std::atomic_size_t done;
+			std::exception_ptr error;
+		};
+
+		// Tasks [first, last) of a job.
+		struct Range
+		{
+			std::shared_ptr<Job> job;
+			std::size_t first;
+			std::size_t last;
+		};
+
+		struct Queue
+		{
+			std::mutex mutex;
+			std::deque<Range> ranges;
+		};
+
+		// Queue of the calling thread; the shared one unless called by a worker.
+		std::size_t FindQueue(void) const;
+
+		// Takes a task from the given queue, or steals one from another queue.
+		bool TakeTask(std::size_t self, std::shared_ptr<Job> &job, std::size_t &index);
+
+		void RunTask(Job &job, std::size_t index);
+		void Work(std::size_t self);
+
+		// One queue per worker, and the last one shared by the other threads.
+		std::vector<std::unique_ptr<Queue>> queues_;
+		std::vector<std::thread> workers_;
+
+		// Number of tasks left in the queues.
+		std::atomic_size_t nQueued_;
+
+		std::condition_variable cvJob_, cvDone_;
+		std::mutex mutex_;
+		bool stop_ = false;
+	};
+}
+
+#endif
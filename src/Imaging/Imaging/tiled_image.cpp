@@ -0,0 +1,221 @@
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+
+#include "copy.h"
+#include "raw_file.h"
+#include "tiled_image.h"
+
+namespace Imaging
+{
+	////////////////////////////////////////////////////////////////////////////////////////
+	// RawFileTileStore
+
+	RawFileTileStore::RawFileTileStore(const std::string &path) : path_(path)
+	{
+		RawFileHeader header = ReadRawFileHeader(path);
+		if (header.bytesPerLine * header.height == 0)
+			return;
+
+		this->alignment_ = static_cast<ImageSizeType>(header.alignment);
+		this->dataType_ = static_cast<DataType>(header.dataType);
+		this->depth_ = static_cast<ImageSizeType>(header.depth);
+		this->size_ = ImageSize(static_cast<ImageSizeType>(header.width),
+			static_cast<ImageSizeType>(header.height));
+		this->bytesPerLine_ = static_cast<ImageSizeType>(header.bytesPerLine);
+		this->dataOffset_ = static_cast<std::size_t>(header.dataOffset);
+	}
+
+	/* Maps from the first pixel of the tile (rounded down to Storage::Alignment) to the
+	last one, and copies the tile out of the lines. Only the pages touched by the tile are
+	read from the file. */
+	void RawFileTileStore::Read(const ImageFrame::ROI &roi, ImageFrame &tile)
+	{
+		auto bytes_pixel = GetNumBytes(this->dataType) * this->depth;
+		auto bytes_line = bytes_pixel * roi.size.width;
+		auto bytes_tile = ImageFrame::GetBytesPerLine(this->dataType, roi.size.width,
+			this->depth, this->alignment);
+		tile.Reset(this->dataType, roi.size, this->depth, this->alignment,
+			bytes_tile == bytes_line ? Init::None : Init::Zero);
+		if (tile.data.empty())
+			return;
+
+		const std::size_t first = this->dataOffset_ + roi.origin.y * this->bytesPerLine_ +
+			roi.origin.x * bytes_pixel;
+		const std::size_t offset = first / Storage::Alignment * Storage::Alignment;
+		MappedFileStorage storage(this->path_, offset,
+			MappedFileStorage::Access::CopyOnWrite);
+		std::shared_ptr<void> block = storage.Allocate(
+			(roi.size.height - 1) * this->bytesPerLine_ + bytes_line + (first - offset));
+		CopyLines(static_cast<const char *>(block.get()) + (first - offset),
+			this->bytesPerLine_, &(*tile.Begin()), tile.bytesPerLine, bytes_line,
+			roi.size.height);
+	}
+
+	// RawFileTileStore
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// TiledImage
+
+	/* The capacity is split evenly among the shards, and no shard is left without room for
+	a tile. */
+	TiledImage::TiledImage(const std::shared_ptr<TileStore> &store,
+		const ImageSize &tileSize, std::size_t capacity, std::size_t nShards) :
+		store_(store), storage_(std::make_shared<SlabStorage>(0)),
+		dataType_(store->dataType), depth_(store->depth)
+	{
+		this->size_ = store->size;
+		this->tileSize_ = tileSize;
+		if (tileSize.width == 0 || tileSize.height == 0)
+			throw std::invalid_argument("A tile must have at least one pixel.");
+		if (capacity == 0)
+			throw std::invalid_argument("The cache must hold at least one tile.");
+
+		this->numTiles_ = ImageSize(
+			(this->size.width + tileSize.width - 1) / tileSize.width,
+			(this->size.height + tileSize.height - 1) / tileSize.height);
+		nShards = std::max<std::size_t>(1, std::min(nShards, capacity));
+		this->capacityShard_ = (capacity + nShards - 1) / nShards;
+		for (std::size_t n = 0; n != nShards; ++n)
+			this->shards_.push_back(std::unique_ptr<Shard>(new Shard()));
+	}
+
+	ImageFrame TiledImage::CopyTo(const ImageFrame::ROI &roiSrc) const
+	{
+		// Check source ROI.
+		Point2D<ImageSizeType> ptEnd(roiSrc.origin.x + roiSrc.size.width,
+			roiSrc.origin.y + roiSrc.size.height);	// excluding point
+		if (ptEnd.x > this->size.width || ptEnd.y > this->size.height)
+		{
+			std::ostringstream errMsg;
+			errMsg << "[" << roiSrc.origin.x << ", " << roiSrc.origin.y << "] ~ (" <<
+				ptEnd.x << ", " << ptEnd.y << ") is out of range.";
+			throw std::out_of_range(errMsg.str());
+		}
+
+		ImageFrame imgDst;
+		auto bytes_pixel = GetNumBytes(this->dataType) * this->depth;
+		auto bytes_line = bytes_pixel * roiSrc.size.width;
+		imgDst.Reset(this->dataType, roiSrc.size, this->depth, this->store_->alignment,
+			ImageFrame::GetBytesPerLine(this->dataType, roiSrc.size.width, this->depth,
+			this->store_->alignment) == bytes_line ? Init::None : Init::Zero);
+		if (imgDst.data.empty())
+			return imgDst;
+
+		// Copy the part of every tile overlapping the ROI.
+		for (auto Y = roiSrc.origin.y / this->tileSize.height;
+			Y <= (ptEnd.y - 1) / this->tileSize.height; ++Y)
+			for (auto X = roiSrc.origin.x / this->tileSize.width;
+				X <= (ptEnd.x - 1) / this->tileSize.width; ++X)
+			{
+				std::shared_ptr<const ImageFrame> tile = this->GetTile({ X, Y });
+				ImageFrame::ROI roiTile;
+				this->GetTileRoi({ X, Y }, roiTile);
+				auto x0 = std::max(roiSrc.origin.x, roiTile.origin.x);
+				auto y0 = std::max(roiSrc.origin.y, roiTile.origin.y);
+				auto x1 = std::min(ptEnd.x, roiTile.origin.x + roiTile.size.width);
+				auto y1 = std::min(ptEnd.y, roiTile.origin.y + roiTile.size.height);
+				auto itSrc = tile->Cbegin({ x0 - roiTile.origin.x, y0 - roiTile.origin.y });
+				CopyLines(&(*itSrc), tile->bytesPerLine,
+					&(*imgDst.Begin({ x0 - roiSrc.origin.x, y0 - roiSrc.origin.y })),
+					imgDst.bytesPerLine, (x1 - x0) * bytes_pixel, y1 - y0);
+			}
+
+		return imgDst;
+	}
+
+	std::shared_ptr<const ImageFrame> TiledImage::GetTile(
+		const Point2D<ImageSizeType> &index) const
+	{
+		if (index.x >= this->numTiles.width || index.y >= this->numTiles.height)
+		{
+			std::ostringstream errMsg;
+			errMsg << "Tile [" << index.x << ", " << index.y << "] is out of range.";
+			throw std::out_of_range(errMsg.str());
+		}
+
+		// Neighboring tiles fall into different shards.
+		const std::size_t key = index.y * this->numTiles.width + index.x;
+		Shard &shard = *this->shards_[key % this->shards_.size()];
+		{
+			std::lock_guard<std::mutex> lock(shard.mutex);
+			auto it = shard.tiles.find(key);
+			if (it != shard.tiles.end())
+			{
+				shard.lru.splice(shard.lru.begin(), shard.lru, it->second.pos);
+				++shard.hits;
+				return it->second.tile;
+			}
+			++shard.misses;
+		}
+
+		// Read the tile without the lock, so the other tiles of the shard are served.
+		std::shared_ptr<ImageFrame> tile = std::make_shared<ImageFrame>();
+		tile->SetStorage(this->storage_);
+		ImageFrame::ROI roiTile;
+		this->GetTileRoi(index, roiTile);
+		this->store_->Read(roiTile, *tile);
+
+		std::lock_guard<std::mutex> lock(shard.mutex);
+		auto it = shard.tiles.find(key);
+		if (it != shard.tiles.end())
+		{	// Read by another thread meanwhile.
+			shard.lru.splice(shard.lru.begin(), shard.lru, it->second.pos);
+			return it->second.tile;
+		}
+		shard.lru.push_front(key);
+		try
+		{
+			Shard::Entry entry = { tile, shard.lru.begin() };
+			shard.tiles.emplace(key, entry);
+		}
+		catch (...)
+		{
+			shard.lru.pop_front();
+			throw;
+		}
+
+		// Evict the least recently used tiles.
+		while (shard.tiles.size() > this->capacityShard_)
+		{
+			shard.tiles.erase(shard.lru.back());
+			shard.lru.pop_back();
+		}
+		return tile;
+	}
+
+	void TiledImage::GetTileRoi(const Point2D<ImageSizeType> &index,
+		ImageFrame::ROI &roi) const
+	{
+		roi.origin.x = index.x * this->tileSize.width;
+		roi.origin.y = index.y * this->tileSize.height;
+		roi.size.width = std::min(this->tileSize.width, this->size.width - roi.origin.x);
+		roi.size.height = std::min(this->tileSize.height, this->size.height - roi.origin.y);
+	}
+
+	std::size_t TiledImage::hits(void) const
+	{
+		std::size_t n = 0;
+		for (auto &shard : this->shards_)
+		{
+			std::lock_guard<std::mutex> lock(shard->mutex);
+			n += shard->hits;
+		}
+		return n;
+	}
+
+	std::size_t TiledImage::misses(void) const
+	{
+		std::size_t n = 0;
+		for (auto &shard : this->shards_)
+		{
+			std::lock_guard<std::mutex> lock(shard->mutex);
+			n += shard->misses;
+		}
+		return n;
+	}
+
+	// TiledImage
+	////////////////////////////////////////////////////////////////////////////////////////
+}
@@ -0,0 +1,129 @@
+#if !defined(TILED_IMAGE_H)
+#define TILED_IMAGE_H
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "image.h"
+#include "storage.h"
+
+namespace Imaging
+{
+	/* Source of the pixels of a tiled image, e.g. a file holding an image too large to
+	load.
+	Read() may be called from several threads at once. */
+	class TileStore
+	{
+	public:
+		TileStore(void) = default;
+		virtual ~TileStore(void) {}
+		TileStore(const TileStore &) = delete;
+		TileStore &operator=(const TileStore &) = delete;
+
+		/* Reads the pixels within 'roi' into 'tile', which is resized per the ROI with the
+		line alignment of the store. */
+		virtual void Read(const ImageFrame::ROI &roi, ImageFrame &tile) = 0;
+
+		const ImageSizeType &alignment = this->alignment_;
+		const DataType &dataType = this->dataType_;
+		const ImageSizeType &depth = this->depth_;
+		const ImageSize &size = this->size_;
+
+	protected:
+		ImageSizeType alignment_ = 1;
+		DataType dataType_ = DataType::UNDEFINED;
+		ImageSizeType depth_ = 0;
+		ImageSize size_ = ImageSize(0, 0);
+	};
+
+	/* Reads tiles from a raw image file (see raw_file.h) by mapping only the lines of each
+	tile, so the file may be larger than the address space. The file is opened per tile,
+	and is never modified. */
+	class RawFileTileStore : public TileStore
+	{
+	public:
+		explicit RawFileTileStore(const std::string &path);
+		void Read(const ImageFrame::ROI &roi, ImageFrame &tile) override;
+
+	protected:
+		std::string path_;
+		ImageSizeType bytesPerLine_ = 0;
+		std::size_t dataOffset_ = 0;
+	};
+
+	/* Random access into an image too large to hold in memory, e.g. an inspection map of
+	gigapixels, in tiles of a fixed size (smaller at the right and bottom borders).
+
+	The tiles are read from a TileStore on demand, and at most about 'capacity' tiles are
+	resident. The cache is split into 'nShards' shards by the tile index, each with its own
+	lock and least-recently-used list, so threads reading different tiles rarely contend.
+	A tile is read outside the lock; two threads missing the same tile at once may both
+	read it, and the first one is kept. The blocks of evicted tiles are recycled through a
+	SlabStorage.
+	GetTile() returns a shared tile, which stays valid after it is evicted. Thread safe. */
+	class TiledImage
+	{
+	public:
+		TiledImage(const std::shared_ptr<TileStore> &store, const ImageSize &tileSize,
+			std::size_t capacity, std::size_t nShards = 8);
+		TiledImage(const TiledImage &) = delete;
+		TiledImage &operator=(const TiledImage &) = delete;
+
+		/* Creates a separate ImageFrame object with the image data within the ROI, which
+		may span any number of tiles. Throws std::out_of_range if the ROI is out of the
+		image. */
+		ImageFrame CopyTo(const ImageFrame::ROI &roiSrc) const;
+
+		// Tile at the given column and row of tiles.
+		std::shared_ptr<const ImageFrame> GetTile(
+			const Point2D<ImageSizeType> &index) const;
+
+		// Area of the image covered by the tile at the given column and row of tiles.
+		void GetTileRoi(const Point2D<ImageSizeType> &index, ImageFrame::ROI &roi) const;
+
+		// Number of tiles found resident and read from the store, respectively.
+		std::size_t hits(void) const;
+		std::size_t misses(void) const;
+
+		const DataType &dataType = this->dataType_;
+		const ImageSizeType &depth = this->depth_;
+		const ImageSize &size = this->size_;
+		const ImageSize &tileSize = this->tileSize_;
+
+		// Number of columns and rows of tiles.
+		const ImageSize &numTiles = this->numTiles_;
+
+	protected:
+		struct Shard
+		{
+			std::mutex mutex;
+			std::list<std::size_t> lru;		// tile indices, most recently used first
+
+			struct Entry
+			{
+				std::shared_ptr<const ImageFrame> tile;
+				std::list<std::size_t>::iterator pos;
+			};
+			std::unordered_map<std::size_t, Entry> tiles;
+
+			std::size_t hits = 0;
+			std::size_t misses = 0;
+		};
+
+		std::shared_ptr<TileStore> store_;
+		std::shared_ptr<Storage> storage_;
+		DataType dataType_ = DataType::UNDEFINED;
+		ImageSizeType depth_ = 0;
+		ImageSize size_ = ImageSize(0, 0);
+		ImageSize tileSize_ = ImageSize(0, 0);
+		ImageSize numTiles_ = ImageSize(0, 0);
+		std::size_t capacityShard_ = 0;
+		std::vector<std::unique_ptr<Shard>> shards_;
+	};
+}
+
+#endif
@@ -0,0 +1,328 @@
+#if !defined(TYPED_VIEW_H)
+#define TYPED_VIEW_H
+
+#include <sstream>
+#include <type_traits>
+#include <typeinfo>
+
+#include "image.h"
+#include "view.h"
+
+namespace Imaging
+{
+	/* Compile-time typed pixel access.
+
+	ImageFrame and views only know the data type and the number of channels at runtime, so
+	their image data can only be accessed as bytes. TypedView<T, C> is a view whose data
+	type T and number of channels C are template parameters, so an algorithm written for a
+	TypedView is compiled once per {T, C} with a constant pixel size, and its inner loop over
+	a line is a plain loop over T * that compilers can inline and vectorize.
+
+	C = 0 means the number of channels is only known at runtime (depth).
+	T can be const qualified, e.g. TypedView<const float, 1>, for read-only access.
+
+	Dispatch() maps the runtime {DataType, depth} to the matching {T, C} and calls a
+	function object with it, so each algorithm does not need its own switch statement. */
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// PixelTag<T, C>
+
+	// Empty tag type carrying {T, C} of a pixel for Dispatch().
+	template <typename T, std::size_t C>
+	struct PixelTag
+	{
+		typedef T ValueType;
+		static const std::size_t Channels = C;
+	};
+
+	// PixelTag<T, C>
+	////////////////////////////////////////////////////////////////////////////////////////
+
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// TypedView<T, C>
+
+	template <typename T, std::size_t C>
+	class TypedView
+	{
+		static_assert(std::is_arithmetic<T>::value,
+			"Only arithmetic data types are supported for this class template.");
+
+	public:
+		////////////////////////////////////////////////////////////////////////////////////
+		// Types and constants.
+		typedef T ValueType;
+		typedef typename std::conditional<std::is_const<T>::value,
+			const ImageFrame::ByteType, ImageFrame::ByteType>::type ByteType;
+		typedef ImageFrame::SizeType SizeType;
+		static const std::size_t Channels = C;
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Default constructors.
+		TypedView(void) = default;
+		TypedView(const TypedView<T, C> &src);
+		TypedView<T, C> &operator=(const TypedView<T, C> &src);
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Custom constructors.
+		TypedView(const ImageView &viewSrc);
+		TypedView(const ConstImageView &viewSrc);
+		TypedView(ImageFrame &imgSrc);
+		TypedView(const ImageFrame &imgSrc);
+		TypedView(ImageFrame &&imgSrc) = delete;
+		TypedView(const ImageFrame &&imgSrc) = delete;
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Accessors.
+		// No range checking for the sake of speed.
+		T *Row(SizeType y) const;
+		T &At(SizeType x, SizeType y, SizeType c = 0) const;
+
+		const SizeType &bytesPerLine = this->bytesPerLine_;
+		const SizeType &depth = this->depth_;
+		const Size2D<SizeType> &size = this->size_;
+
+	protected:
+		void Set(ByteType *src, DataType ty, const Size2D<SizeType> &sz, SizeType d,
+			SizeType stepBytes);
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Data.
+		ByteType *begin_ = nullptr;
+		SizeType bytesPerLine_ = 0;
+		SizeType depth_ = C;
+		Size2D<SizeType> size_ = Size2D<SizeType>(0, 0);
+	};
+
+	// TypedView<T, C>
+	////////////////////////////////////////////////////////////////////////////////////////
+
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Dispatch
+
+	/* Calls f(PixelTag<T, C>()) where T is the C++ type of ty and C is d if d is one of
+	{1, 2, 3, 4}, or 0 otherwise. f must be callable with every PixelTag<T, C>.
+	e.g.
+	struct Kernel
+	{
+		template <typename T, std::size_t C>
+		void operator()(PixelTag<T, C>) { ... }
+	}; */
+	template <typename F>
+	auto Dispatch(DataType ty, ImageFrame::SizeType d, F &&f) ->
+		decltype(f(PixelTag<unsigned char, 1>()));
+
+	/* Calls f(TypedView<T, C>(view)) for the {T, C} matching the view.
+	T is const qualified for a ConstImageView. */
+	template <typename F>
+	auto Dispatch(const ImageView &view, F &&f) ->
+		decltype(f(TypedView<unsigned char, 1>()));
+	template <typename F>
+	auto Dispatch(const ConstImageView &view, F &&f) ->
+		decltype(f(TypedView<const unsigned char, 1>()));
+
+	// Dispatch
+	////////////////////////////////////////////////////////////////////////////////////////
+}
+
+namespace Imaging
+{
+	////////////////////////////////////////////////////////////////////////////////////////
+	// TypedView<T, C>
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Constructors.
+
+	template <typename T, std::size_t C>
+	TypedView<T, C>::TypedView(const TypedView<T, C> &src) : TypedView<T, C>()
+	{
+		*this = src;
+	}
+
+	template <typename T, std::size_t C>
+	TypedView<T, C> &TypedView<T, C>::operator=(const TypedView<T, C> &src)
+	{
+		this->begin_ = src.begin_;
+		this->bytesPerLine_ = src.bytesPerLine;
+		this->depth_ = src.depth;
+		this->size_ = src.size;
+		return *this;
+	}
+
+	template <typename T, std::size_t C>
+	TypedView<T, C>::TypedView(const ImageView &viewSrc) : TypedView<T, C>()
+	{
+		this->Set(viewSrc.Begin(), viewSrc.dataType, viewSrc.size, viewSrc.depth,
+			viewSrc.bytesPerLine);
+	}
+
+	template <typename T, std::size_t C>
+	TypedView<T, C>::TypedView(const ConstImageView &viewSrc) : TypedView<T, C>()
+	{
+		static_assert(std::is_const<T>::value,
+			"A ConstImageView can be accessed only by a TypedView of a const type.");
+		this->Set(viewSrc.Begin(), viewSrc.dataType, viewSrc.size, viewSrc.depth,
+			viewSrc.bytesPerLine);
+	}
+
+	template <typename T, std::size_t C>
+	TypedView<T, C>::TypedView(ImageFrame &imgSrc) : TypedView<T, C>(ImageView(imgSrc)) {}
+
+	template <typename T, std::size_t C>
+	TypedView<T, C>::TypedView(const ImageFrame &imgSrc) :
+		TypedView<T, C>(ConstImageView(imgSrc)) {}
+
+	// Constructors.
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Accessors.
+
+	template <typename T, std::size_t C>
+	inline T *TypedView<T, C>::Row(SizeType y) const
+	{
+		return reinterpret_cast<T *>(this->begin_ + y * this->bytesPerLine_);
+	}
+
+	template <typename T, std::size_t C>
+	inline T &TypedView<T, C>::At(SizeType x, SizeType y, SizeType c) const
+	{
+		// Channels is a constant unless C = 0.
+		return this->Row(y)[x * (C == 0 ? this->depth_ : C) + c];
+	}
+
+	// Accessors.
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Methods.
+
+	template <typename T, std::size_t C>
+	void TypedView<T, C>::Set(ByteType *src, DataType ty, const Size2D<SizeType> &sz,
+		SizeType d, SizeType stepBytes)
+	{
+		if (ty != GetDataType<typename std::remove_const<T>::type>() || (C != 0 && d != C))
+		{
+			std::ostringstream errMsg;
+			errMsg << "The image data (" << static_cast<std::underlying_type<DataType>::type>(
+				ty) << " x " << d << ") cannot be accessed as " << typeid(T).name() <<
+				" x " << C << ".";
+			throw std::invalid_argument(errMsg.str());
+		}
+
+		this->begin_ = src;
+		this->bytesPerLine_ = stepBytes;
+		this->depth_ = d;
+		this->size_ = sz;
+	}
+
+	// Methods.
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	// TypedView<T, C>
+	////////////////////////////////////////////////////////////////////////////////////////
+
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Dispatch
+
+	namespace Internal
+	{
+		// Second level; resolves C for a given T.
+		template <typename T, typename F>
+		auto DispatchDepth(ImageFrame::SizeType d, F &f) -> decltype(f(PixelTag<T, 1>()))
+		{
+			switch (d)
+			{
+			case 1:
+				return f(PixelTag<T, 1>());
+			case 2:
+				return f(PixelTag<T, 2>());
+			case 3:
+				return f(PixelTag<T, 3>());
+			case 4:
+				return f(PixelTag<T, 4>());
+			default:
+				return f(PixelTag<T, 0>());
+			}
+		}
+
+		// Converts a PixelTag<T, C> into a TypedView<T, C> of the given view.
+		template <typename B, typename F>
+		class ViewInvoker
+		{
+		public:
+			ViewInvoker(const BasicImageView<B> &view, F &f) : view_(view), f_(f) {}
+
+			template <typename T, std::size_t C>
+			auto operator()(PixelTag<T, C>) -> decltype(std::declval<F &>()(
+				TypedView<typename std::conditional<std::is_const<B>::value, const T, T>::type,
+				C>()))
+			{
+				typedef typename std::conditional<std::is_const<B>::value, const T, T>::type
+					ValueType;
+				return this->f_(TypedView<ValueType, C>(this->view_));
+			}
+
+		protected:
+			const BasicImageView<B> &view_;
+			F &f_;
+		};
+	}
+
+	template <typename F>
+	auto Dispatch(DataType ty, ImageFrame::SizeType d, F &&f) ->
+		decltype(f(PixelTag<unsigned char, 1>()))
+	{
+		switch (ty)
+		{
+		case DataType::CHAR:
+			return Internal::DispatchDepth<char>(d, f);
+		case DataType::SCHAR:
+			return Internal::DispatchDepth<signed char>(d, f);
+		case DataType::UCHAR:
+			return Internal::DispatchDepth<unsigned char>(d, f);
+		case DataType::SHORT:
+			return Internal::DispatchDepth<short>(d, f);
+		case DataType::USHORT:
+			return Internal::DispatchDepth<unsigned short>(d, f);
+		case DataType::INT:
+			return Internal::DispatchDepth<int>(d, f);
+		case DataType::UINT:
+			return Internal::DispatchDepth<unsigned int>(d, f);
+		case DataType::LONGLONG:
+			return Internal::DispatchDepth<long long>(d, f);
+		case DataType::ULONGLONG:
+			return Internal::DispatchDepth<unsigned long long>(d, f);
+		case DataType::FLOAT:
+			return Internal::DispatchDepth<float>(d, f);
+		case DataType::DOUBLE:
+			return Internal::DispatchDepth<double>(d, f);
+		case DataType::UNDEFINED:
+			throw std::runtime_error("Data type is undefined.");
+		default:
+			throw std::logic_error("Unknown data type.");
+		}
+	}
+
+	template <typename F>
+	auto Dispatch(const ImageView &view, F &&f) ->
+		decltype(f(TypedView<unsigned char, 1>()))
+	{
+		Internal::ViewInvoker<ImageView::ByteType, F> invoker(view, f);
+		return Dispatch(view.dataType, view.depth, invoker);
+	}
+
+	template <typename F>
+	auto Dispatch(const ConstImageView &view, F &&f) ->
+		decltype(f(TypedView<const unsigned char, 1>()))
+	{
+		Internal::ViewInvoker<ConstImageView::ByteType, F> invoker(view, f);
+		return Dispatch(view.dataType, view.depth, invoker);
+	}
+
+	// Dispatch
+	////////////////////////////////////////////////////////////////////////////////////////
+}
+#endif
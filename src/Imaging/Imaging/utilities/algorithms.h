@@ -9,6 +9,9 @@ Features are designed as non-member function templates in a namespace.
 #include <numeric>
 
 #include "safe_operations.h"
+#include "checked_ranges.h"
+#include "saturate_operations.h"
+#include "saturate_ranges.h"
 
 namespace Utilities
 {
@@ -23,13 +26,147 @@ namespace Utilities
 	Must NOT do so because the iterators of lhs will be increased twice per loop.
 	Instead, make separate implementations for such scenario. */
 
+	/* Contiguous arrays of the same data type.
+	If all iterators are pointers to the same arithmetic type, {+, -, *} employ the
+	vectorized functions in checked_ranges.h.
+	Other iterators stop at the first overflowed element, but these compute all of the
+	result values before throwing an std::overflow_error. Overflowed values are wrapped. */
+
+	namespace Internal
+	{
+		template <typename IteratorA, typename IteratorB, typename IteratorC>
+		struct IsSameTypePointers : std::integral_constant<bool,
+			std::is_pointer<IteratorA>::value && std::is_pointer<IteratorB>::value &&
+			std::is_pointer<IteratorC>::value &&
+			std::is_arithmetic<typename std::remove_pointer<IteratorC>::type>::value &&
+			std::is_same<typename std::remove_const<typename std::remove_pointer<
+			IteratorA>::type>::type, typename std::remove_pointer<IteratorC>::type>::value &&
+			std::is_same<typename std::remove_const<typename std::remove_pointer<
+			IteratorB>::type>::type, typename std::remove_pointer<IteratorC>::type>::value>
+		{};
+
+		template <typename T>
+		void ThrowIfOverflowed(std::size_t first, std::size_t n)
+		{
+			if (first != n)
+			{
+				std::ostringstream errMsg;
+				errMsg << "The result value at " << first << " exceeds the limit of " <<
+					typeid(T).name();
+				throw std::overflow_error(errMsg.str());
+			}
+		}
+
+		// C = A + B
+		template <typename InputIteratorA, typename InputIteratorB, typename OutputIterator>
+		void AddRange_imp(InputIteratorA itA, InputIteratorA itA_last, InputIteratorB itB,
+			OutputIterator itC, std::false_type)
+		{
+			for (; itA != itA_last; ++itA, ++itB, ++itC)
+				Add(*itA, *itB, *itC);
+		}
+
+		template <typename T>
+		void AddRange_imp(const T *itA, const T *itA_last, const T *itB, T *itC,
+			std::true_type)
+		{
+			ThrowIfOverflowed<T>(TryAddRange(itA, itA_last, itB, itC),
+				static_cast<std::size_t>(itA_last - itA));
+		}
+
+		// A += B
+		template <typename InputIterator, typename InOutputIterator>
+		void AddRange_imp(InputIterator itSrc, InputIterator itSrcLast,
+			InOutputIterator itSrcDst, std::false_type)
+		{
+			for (; itSrc != itSrcLast; ++itSrc, ++itSrcDst)
+				Add(*itSrcDst, *itSrc, *itSrcDst);
+		}
+
+		template <typename T>
+		void AddRange_imp(const T *itSrc, const T *itSrcLast, T *itSrcDst, std::true_type)
+		{
+			auto n = itSrcLast - itSrc;
+			ThrowIfOverflowed<T>(TryAddRange(itSrcDst, itSrcDst + n, itSrc, itSrcDst),
+				static_cast<std::size_t>(n));
+		}
+
+		// C = A - B
+		template <typename InputIteratorA, typename InputIteratorB, typename OutputIterator>
+		void SubtractRange_imp(InputIteratorA itA, InputIteratorA itA_last,
+			InputIteratorB itB, OutputIterator itC, std::false_type)
+		{
+			for (; itA != itA_last; ++itA, ++itB, ++itC)
+				Subtract(*itA, *itB, *itC);
+		}
+
+		template <typename T>
+		void SubtractRange_imp(const T *itA, const T *itA_last, const T *itB, T *itC,
+			std::true_type)
+		{
+			ThrowIfOverflowed<T>(TrySubtractRange(itA, itA_last, itB, itC),
+				static_cast<std::size_t>(itA_last - itA));
+		}
+
+		// A -= B
+		template <typename InputIterator, typename InOutputIterator>
+		void SubtractRange_imp(InputIterator itSrc, InputIterator itSrcLast,
+			InOutputIterator itSrcDst, std::false_type)
+		{
+			for (; itSrc != itSrcLast; ++itSrc, ++itSrcDst)
+				Subtract(*itSrcDst, *itSrc, *itSrcDst);
+		}
+
+		template <typename T>
+		void SubtractRange_imp(const T *itSrc, const T *itSrcLast, T *itSrcDst, std::true_type)
+		{
+			auto n = itSrcLast - itSrc;
+			ThrowIfOverflowed<T>(TrySubtractRange(itSrcDst, itSrcDst + n, itSrc, itSrcDst),
+				static_cast<std::size_t>(n));
+		}
+
+		// C = A * B
+		template <typename InputIteratorA, typename InputIteratorB, typename OutputIterator>
+		void MultiplyRange_imp(InputIteratorA itA, InputIteratorA itA_last,
+			InputIteratorB itB, OutputIterator itC, std::false_type)
+		{
+			for (; itA != itA_last; ++itA, ++itB, ++itC)
+				Multiply(*itA, *itB, *itC);
+		}
+
+		template <typename T>
+		void MultiplyRange_imp(const T *itA, const T *itA_last, const T *itB, T *itC,
+			std::true_type)
+		{
+			ThrowIfOverflowed<T>(TryMultiplyRange(itA, itA_last, itB, itC),
+				static_cast<std::size_t>(itA_last - itA));
+		}
+
+		// A *= B
+		template <typename InputIterator, typename InOutputIterator>
+		void MultiplyRange_imp(InputIterator itSrc, InputIterator itSrcLast,
+			InOutputIterator itSrcDst, std::false_type)
+		{
+			for (; itSrc != itSrcLast; ++itSrc, ++itSrcDst)
+				Multiply(*itSrcDst, *itSrc, *itSrcDst);
+		}
+
+		template <typename T>
+		void MultiplyRange_imp(const T *itSrc, const T *itSrcLast, T *itSrcDst, std::true_type)
+		{
+			auto n = itSrcLast - itSrc;
+			ThrowIfOverflowed<T>(TryMultiplyRange(itSrcDst, itSrcDst + n, itSrc, itSrcDst),
+				static_cast<std::size_t>(n));
+		}
+	}
+
 	// C = A + B
 	template <typename InputIteratorA, typename InputIteratorB, typename OutputIterator>
 	void AddRange(InputIteratorA itA, InputIteratorA itA_last, InputIteratorB itB,
 		OutputIterator itC)
 	{
-		for (; itA != itA_last; ++itA, ++itB, ++itC)
-			Add(*itA, *itB, *itC);
+		Internal::AddRange_imp(itA, itA_last, itB, itC, Internal::IsSameTypePointers<
+			InputIteratorA, InputIteratorB, OutputIterator>());
 	}
 
 	// C = A - B
@@ -37,8 +174,8 @@ namespace Utilities
 	void SubtractRange(InputIteratorA itA, InputIteratorA itA_last, InputIteratorB itB,
 		OutputIterator itC)
 	{
-		for (; itA != itA_last; ++itA, ++itB, ++itC)
-			Subtract(*itA, *itB, *itC);
+		Internal::SubtractRange_imp(itA, itA_last, itB, itC, Internal::IsSameTypePointers<
+			InputIteratorA, InputIteratorB, OutputIterator>());
 	}
 
 	// C = A * B
@@ -46,16 +183,16 @@ namespace Utilities
 	void MultiplyRange(InputIteratorA itA, InputIteratorA itA_last, InputIteratorB itB,
 		OutputIterator itC)
 	{
-		for (; itA != itA_last; ++itA, ++itB, ++itC)
-			Multiply(*itA, *itB, *itC);
+		Internal::MultiplyRange_imp(itA, itA_last, itB, itC, Internal::IsSameTypePointers<
+			InputIteratorA, InputIteratorB, OutputIterator>());
 	}
 
 	// A += B
 	template <typename InputIterator, typename InOutputIterator>
 	void AddRange(InputIterator itSrc, InputIterator itSrcLast, InOutputIterator itSrcDst)
 	{
-		for (; itSrc != itSrcLast; ++itSrc, ++itSrcDst)
-			Add(*itSrcDst, *itSrc, *itSrcDst);
+		Internal::AddRange_imp(itSrc, itSrcLast, itSrcDst, Internal::IsSameTypePointers<
+			InputIterator, InputIterator, InOutputIterator>());
 	}
 
 	// A -= B
@@ -63,8 +200,8 @@ namespace Utilities
 	void SubtractRange(InputIterator itSrc, InputIterator itSrcLast,
 		InOutputIterator itSrcDst)
 	{
-		for (; itSrc != itSrcLast; ++itSrc, ++itSrcDst)
-			Subtract(*itSrcDst, *itSrc, *itSrcDst);
+		Internal::SubtractRange_imp(itSrc, itSrcLast, itSrcDst, Internal::IsSameTypePointers<
+			InputIterator, InputIterator, InOutputIterator>());
 	}
 
 	// A *= B
@@ -72,8 +209,191 @@ namespace Utilities
 	void MultiplyRange(InputIterator itSrc, InputIterator itSrcLast,
 		InOutputIterator itSrcDst)
 	{
-		for (; itSrc != itSrcLast; ++itSrc, ++itSrcDst)
-			Multiply(*itSrcDst, *itSrc, *itSrcDst);
+		Internal::MultiplyRange_imp(itSrc, itSrcLast, itSrcDst, Internal::IsSameTypePointers<
+			InputIterator, InputIterator, InOutputIterator>());
+	}
+
+	/* Saturation.
+	The overloads taking Saturate clamp overflowed values instead of throwing.
+	If all iterators are pointers to the same arithmetic type, they employ the vectorized
+	functions in saturate_ranges.h. */
+
+	namespace Internal
+	{
+		// C = A + B
+		template <typename InputIteratorA, typename InputIteratorB, typename OutputIterator>
+		void AddRange_imp(InputIteratorA itA, InputIteratorA itA_last, InputIteratorB itB,
+			OutputIterator itC, Saturate, std::false_type)
+		{
+			for (; itA != itA_last; ++itA, ++itB, ++itC)
+				Add(*itA, *itB, *itC, Saturate());
+		}
+
+		template <typename T>
+		void AddRange_imp(const T *itA, const T *itA_last, const T *itB, T *itC, Saturate,
+			std::true_type)
+		{
+			SaturateAddRange(itA, itA_last, itB, itC);
+		}
+
+		// A += B
+		template <typename InputIterator, typename InOutputIterator>
+		void AddRange_imp(InputIterator itSrc, InputIterator itSrcLast,
+			InOutputIterator itSrcDst, Saturate, std::false_type)
+		{
+			for (; itSrc != itSrcLast; ++itSrc, ++itSrcDst)
+				Add(*itSrcDst, *itSrc, *itSrcDst, Saturate());
+		}
+
+		template <typename T>
+		void AddRange_imp(const T *itSrc, const T *itSrcLast, T *itSrcDst, Saturate,
+			std::true_type)
+		{
+			SaturateAddRange(itSrcDst, itSrcDst + (itSrcLast - itSrc), itSrc, itSrcDst);
+		}
+
+		// C = A - B
+		template <typename InputIteratorA, typename InputIteratorB, typename OutputIterator>
+		void SubtractRange_imp(InputIteratorA itA, InputIteratorA itA_last,
+			InputIteratorB itB, OutputIterator itC, Saturate, std::false_type)
+		{
+			for (; itA != itA_last; ++itA, ++itB, ++itC)
+				Subtract(*itA, *itB, *itC, Saturate());
+		}
+
+		template <typename T>
+		void SubtractRange_imp(const T *itA, const T *itA_last, const T *itB, T *itC,
+			Saturate, std::true_type)
+		{
+			SaturateSubtractRange(itA, itA_last, itB, itC);
+		}
+
+		// A -= B
+		template <typename InputIterator, typename InOutputIterator>
+		void SubtractRange_imp(InputIterator itSrc, InputIterator itSrcLast,
+			InOutputIterator itSrcDst, Saturate, std::false_type)
+		{
+			for (; itSrc != itSrcLast; ++itSrc, ++itSrcDst)
+				Subtract(*itSrcDst, *itSrc, *itSrcDst, Saturate());
+		}
+
+		template <typename T>
+		void SubtractRange_imp(const T *itSrc, const T *itSrcLast, T *itSrcDst, Saturate,
+			std::true_type)
+		{
+			SaturateSubtractRange(itSrcDst, itSrcDst + (itSrcLast - itSrc), itSrc, itSrcDst);
+		}
+
+		// C = A * B
+		template <typename InputIteratorA, typename InputIteratorB, typename OutputIterator>
+		void MultiplyRange_imp(InputIteratorA itA, InputIteratorA itA_last,
+			InputIteratorB itB, OutputIterator itC, Saturate, std::false_type)
+		{
+			for (; itA != itA_last; ++itA, ++itB, ++itC)
+				Multiply(*itA, *itB, *itC, Saturate());
+		}
+
+		template <typename T>
+		void MultiplyRange_imp(const T *itA, const T *itA_last, const T *itB, T *itC,
+			Saturate, std::true_type)
+		{
+			SaturateMultiplyRange(itA, itA_last, itB, itC);
+		}
+
+		// A *= B
+		template <typename InputIterator, typename InOutputIterator>
+		void MultiplyRange_imp(InputIterator itSrc, InputIterator itSrcLast,
+			InOutputIterator itSrcDst, Saturate, std::false_type)
+		{
+			for (; itSrc != itSrcLast; ++itSrc, ++itSrcDst)
+				Multiply(*itSrcDst, *itSrc, *itSrcDst, Saturate());
+		}
+
+		template <typename T>
+		void MultiplyRange_imp(const T *itSrc, const T *itSrcLast, T *itSrcDst, Saturate,
+			std::true_type)
+		{
+			SaturateMultiplyRange(itSrcDst, itSrcDst + (itSrcLast - itSrc), itSrc, itSrcDst);
+		}
+
+		// Src -> Dst
+		template <typename InputIterator, typename OutputIterator>
+		void CastRange_imp(InputIterator itSrc, InputIterator itSrcLast, OutputIterator itDst,
+			Saturate, std::false_type)
+		{
+			for (; itSrc != itSrcLast; ++itSrc, ++itDst)
+				Cast(*itSrc, *itDst, Saturate());
+		}
+
+		template <typename T, typename U>
+		void CastRange_imp(const T *itSrc, const T *itSrcLast, U *itDst, Saturate,
+			std::true_type)
+		{
+			SaturateCastRange(itSrc, itSrcLast, itDst);
+		}
+
+		// Pointers to arithmetic types, not necessarily the same.
+		template <typename IteratorA, typename IteratorB>
+		struct IsArithmeticPointers : std::integral_constant<bool,
+			std::is_pointer<IteratorA>::value && std::is_pointer<IteratorB>::value &&
+			std::is_arithmetic<typename std::remove_pointer<IteratorA>::type>::value &&
+			std::is_arithmetic<typename std::remove_pointer<IteratorB>::type>::value &&
+			!std::is_const<typename std::remove_pointer<IteratorB>::type>::value>
+		{};
+	}
+
+	// C = A + B
+	template <typename InputIteratorA, typename InputIteratorB, typename OutputIterator>
+	void AddRange(InputIteratorA itA, InputIteratorA itA_last, InputIteratorB itB,
+		OutputIterator itC, Saturate)
+	{
+		Internal::AddRange_imp(itA, itA_last, itB, itC, Saturate(),
+			Internal::IsSameTypePointers<InputIteratorA, InputIteratorB, OutputIterator>());
+	}
+
+	// C = A - B
+	template <typename InputIteratorA, typename InputIteratorB, typename OutputIterator>
+	void SubtractRange(InputIteratorA itA, InputIteratorA itA_last, InputIteratorB itB,
+		OutputIterator itC, Saturate)
+	{
+		Internal::SubtractRange_imp(itA, itA_last, itB, itC, Saturate(),
+			Internal::IsSameTypePointers<InputIteratorA, InputIteratorB, OutputIterator>());
+	}
+
+	// C = A * B
+	template <typename InputIteratorA, typename InputIteratorB, typename OutputIterator>
+	void MultiplyRange(InputIteratorA itA, InputIteratorA itA_last, InputIteratorB itB,
+		OutputIterator itC, Saturate)
+	{
+		Internal::MultiplyRange_imp(itA, itA_last, itB, itC, Saturate(),
+			Internal::IsSameTypePointers<InputIteratorA, InputIteratorB, OutputIterator>());
+	}
+
+	// A += B
+	template <typename InputIterator, typename InOutputIterator>
+	void AddRange(InputIterator itSrc, InputIterator itSrcLast,
+		InOutputIterator itSrcDst, Saturate)
+	{
+		Internal::AddRange_imp(itSrc, itSrcLast, itSrcDst, Saturate(),
+			Internal::IsSameTypePointers<InputIterator, InputIterator, InOutputIterator>());
+	}
+
+	// A -= B
+	template <typename InputIterator, typename InOutputIterator>
+	void SubtractRange(InputIterator itSrc, InputIterator itSrcLast,
+		InOutputIterator itSrcDst, Saturate)
+	{
+		Internal::SubtractRange_imp(itSrc, itSrcLast, itSrcDst, Saturate(),
+			Internal::IsSameTypePointers<InputIterator, InputIterator, InOutputIterator>());
+	}
+
+	// A *= B
+	template <typename InputIterator, typename InOutputIterator>
+	void MultiplyRange(InputIterator itSrc, InputIterator itSrcLast,
+		InOutputIterator itSrcDst, Saturate)
+	{
+		Internal::MultiplyRange_imp(itSrc, itSrcLast, itSrcDst, Saturate(),
+			Internal::IsSameTypePointers<InputIterator, InputIterator, InOutputIterator>());
 	}
 
 	// ++A
@@ -113,6 +433,14 @@ namespace Utilities
 			Cast(*itSrc, *itDst);
 	}
 
+	template <typename InputIterator, typename OutputIterator>
+	void CastRange(InputIterator itSrc, InputIterator itSrcLast, OutputIterator itDst,
+		Saturate)
+	{
+		Internal::CastRange_imp(itSrc, itSrcLast, itDst, Saturate(),
+			Internal::IsArithmeticPointers<InputIterator, OutputIterator>());
+	}
+
 	template <typename InputIterator, typename OutputIterator>
 	std::enable_if_t<std::is_floating_point<typename InputIterator::value_type>::value,
 		void> RoundRange(InputIterator itSrc, InputIterator itSrcLast, OutputIterator itDst)
@@ -0,0 +1,122 @@
+#if !defined(ALLOCATORS_H)
+#define ALLOCATORS_H
+
+/*
+Declares and defines allocators for standard container classes.
+Features are designed as non-member functions and class templates in a namespace.
+*/
+
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+#include <limits>
+
+#if defined(_MSC_VER)
+#include <malloc.h>
+#endif
+
+namespace Utilities
+{
+	/* Aligned memory allocation.
+	std::malloc() and operator new only guarantee the alignment of fundamental types, which
+	is usually 8 or 16 bytes. SIMD (16/32/64 bytes) and cache line (64 bytes) alignment need
+	a platform specific allocation function.
+
+	Visual C++ provides _aligned_malloc()/_aligned_free().
+	POSIX provides posix_memalign()/free().
+	The alignment must be a power of two and a multiple of sizeof(void *). */
+
+	// Returns nullptr if failed.
+	inline void *AlignedMalloc(std::size_t bytes, std::size_t alignment)
+	{
+#if defined(_MSC_VER)
+		return ::_aligned_malloc(bytes, alignment);
+#else
+		void *ptr = nullptr;
+		if (::posix_memalign(&ptr, alignment, bytes) != 0)
+			return nullptr;
+		return ptr;
+#endif
+	}
+
+	inline void AlignedFree(void *ptr)
+	{
+#if defined(_MSC_VER)
+		::_aligned_free(ptr);
+#else
+		std::free(ptr);
+#endif
+	}
+
+	/* Allocator with a fixed alignment for the first element.
+	Can be used with any standard container, e.g. std::vector<T, AlignedAllocator<T, 64>>.
+	Only the starting address of the allocated block is aligned. Aligning each line of an
+	image is the job of the container owner (i.e. adding padding bytes per line). */
+	template <typename T, std::size_t Alignment>
+	class AlignedAllocator
+	{
+		static_assert(Alignment != 0 && (Alignment & (Alignment - 1)) == 0,
+			"Alignment must be a power of two.");
+		static_assert(Alignment >= sizeof(void *),
+			"Alignment must be a multiple of sizeof(void *).");
+
+	public:
+		////////////////////////////////////////////////////////////////////////////////////
+		// Types and constants.
+		typedef T value_type;
+		typedef T *pointer;
+		typedef const T *const_pointer;
+		typedef T &reference;
+		typedef const T &const_reference;
+		typedef std::size_t size_type;
+		typedef std::ptrdiff_t difference_type;
+
+		template <typename U>
+		struct rebind
+		{
+			typedef AlignedAllocator<U, Alignment> other;
+		};
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Default constructors.
+		AlignedAllocator(void) {}
+		AlignedAllocator(const AlignedAllocator &) {}
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Custom constructors.
+		template <typename U>
+		AlignedAllocator(const AlignedAllocator<U, Alignment> &) {}
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Methods.
+		T *allocate(std::size_t n, const void * = nullptr)
+		{
+			if (n == 0)
+				return nullptr;
+			if (n > this->max_size())
+				throw std::bad_alloc();
+			void *ptr = AlignedMalloc(n * sizeof(T), Alignment);
+			if (ptr == nullptr)
+				throw std::bad_alloc();
+			return static_cast<T *>(ptr);
+		}
+
+		void deallocate(T *ptr, std::size_t)
+		{
+			AlignedFree(ptr);
+		}
+
+		std::size_t max_size(void) const
+		{
+			return std::numeric_limits<std::size_t>::max() / sizeof(T);
+		}
+
+		template <typename U>
+		bool operator==(const AlignedAllocator<U, Alignment> &) const { return true; }
+
+		template <typename U>
+		bool operator!=(const AlignedAllocator<U, Alignment> &) const { return false; }
+	};
+}
+
+#endif
@@ -0,0 +1,536 @@
+#if !defined(SATURATE_RANGES_H)
+#define SATURATE_RANGES_H
+
+/*
+Declares and defines arithmetic operations with saturation for contiguous arrays.
+Features are designed as non-member function templates in a namespace.
+
+The result values are identical to the element-wise functions in saturate_operations.h, but
+multiple elements are computed at once with SIMD instructions if SSE2 is enabled at compile
+time; see checked_ranges.h.
+Vectorized data types:
+{+, -}: 8-bit, 16-bit, and 32-bit integers
+{*}: 8-bit and 16-bit integers
+Cast: short -> {signed char, unsigned char}, unsigned short -> unsigned char,
+int -> {unsigned char, short}, float -> {unsigned char, short}
+Other data types and the remaining elements of a range are computed one by one.
+*/
+
+#include <cstddef>
+#include <type_traits>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define UTILITIES_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "saturate_operations.h"
+
+namespace Utilities
+{
+	namespace Internal
+	{
+		////////////////////////////////////////////////////////////////////////////////////
+		// Scalar operations.
+
+		struct SaturateAdd
+		{
+			template <typename T>
+			static void Apply(T a, T b, T &c)
+			{
+				Add(a, b, c, Saturate());
+			}
+		};
+
+		struct SaturateSubtract
+		{
+			template <typename T>
+			static void Apply(T a, T b, T &c)
+			{
+				Subtract(a, b, c, Saturate());
+			}
+		};
+
+		struct SaturateMultiply
+		{
+			template <typename T>
+			static void Apply(T a, T b, T &c)
+			{
+				Multiply(a, b, c, Saturate());
+			}
+		};
+
+		// Scalar operations.
+		////////////////////////////////////////////////////////////////////////////////////
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// SSE2 operations.
+
+		/* SimdSaturate{Op}<N, S> is the vector version of Saturate{Op} for integral types of
+		N bytes with signedness S.
+		'enabled' is false if there is no vector version. */
+
+		template <std::size_t N, bool S>
+		struct SimdSaturateAdd
+		{
+			static const bool enabled = false;
+		};
+
+		template <std::size_t N, bool S>
+		struct SimdSaturateSubtract
+		{
+			static const bool enabled = false;
+		};
+
+		template <std::size_t N, bool S>
+		struct SimdSaturateMultiply
+		{
+			static const bool enabled = false;
+		};
+
+		/* SimdSaturateCast<T, U> converts 'step' elements of T into U at once.
+		'enabled' is false if there is no vector version. */
+		template <typename T, typename U>
+		struct SimdSaturateCast
+		{
+			static const bool enabled = false;
+		};
+
+#if defined(UTILITIES_HAVE_SSE2)
+		inline __m128i SimdLoad(const void *src)
+		{
+			return _mm_loadu_si128(static_cast<const __m128i *>(src));
+		}
+
+		inline void SimdStore(void *dst, __m128i v)
+		{
+			_mm_storeu_si128(static_cast<__m128i *>(dst), v);
+		}
+
+		// mask ? a : b
+		inline __m128i SimdSelect(__m128i mask, __m128i a, __m128i b)
+		{
+			return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+		}
+
+		// min(v, c) of unsigned 16-bit values; v - max(v - c, 0).
+		inline __m128i SimdMinEpu16(__m128i v, __m128i c)
+		{
+			return _mm_sub_epi16(v, _mm_subs_epu16(v, c));
+		}
+
+		// INT_MIN if v is negative, INT_MAX otherwise.
+		inline __m128i SimdLimitEpi32(__m128i v)
+		{
+			return _mm_xor_si128(_mm_srai_epi32(v, 31), _mm_set1_epi32(0x7FFFFFFF));
+		}
+
+		// Unsigned comparison a > b of 32-bit values.
+		inline __m128i SimdCmpgtEpu32Sat(__m128i a, __m128i b)
+		{
+			const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000));
+			return _mm_cmpgt_epi32(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+		}
+
+		// Zeroes NaN, and then clamps into [lo, hi].
+		inline __m128 SimdClampPs(__m128 v, __m128 lo, __m128 hi)
+		{
+			v = _mm_and_ps(v, _mm_cmpeq_ps(v, v));
+			return _mm_min_ps(_mm_max_ps(v, lo), hi);
+		}
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Add
+
+		template <>
+		struct SimdSaturateAdd<1, false>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b) { return _mm_adds_epu8(a, b); }
+		};
+
+		template <>
+		struct SimdSaturateAdd<1, true>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b) { return _mm_adds_epi8(a, b); }
+		};
+
+		template <>
+		struct SimdSaturateAdd<2, false>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b) { return _mm_adds_epu16(a, b); }
+		};
+
+		template <>
+		struct SimdSaturateAdd<2, true>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b) { return _mm_adds_epi16(a, b); }
+		};
+
+		// Overflowed if the sum is less than a source value.
+		template <>
+		struct SimdSaturateAdd<4, false>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b)
+			{
+				__m128i c = _mm_add_epi32(a, b);
+				return _mm_or_si128(c, SimdCmpgtEpu32Sat(a, c));
+			}
+		};
+
+		// Overflowed if the sign of the sum differs from both sources.
+		template <>
+		struct SimdSaturateAdd<4, true>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b)
+			{
+				__m128i c = _mm_add_epi32(a, b);
+				__m128i overflow = _mm_srai_epi32(_mm_and_si128(_mm_xor_si128(a, c),
+					_mm_xor_si128(b, c)), 31);
+				return SimdSelect(overflow, SimdLimitEpi32(a), c);
+			}
+		};
+
+		// Add
+		////////////////////////////////////////////////////////////////////////////////////
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Subtract
+
+		template <>
+		struct SimdSaturateSubtract<1, false>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b) { return _mm_subs_epu8(a, b); }
+		};
+
+		template <>
+		struct SimdSaturateSubtract<1, true>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b) { return _mm_subs_epi8(a, b); }
+		};
+
+		template <>
+		struct SimdSaturateSubtract<2, false>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b) { return _mm_subs_epu16(a, b); }
+		};
+
+		template <>
+		struct SimdSaturateSubtract<2, true>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b) { return _mm_subs_epi16(a, b); }
+		};
+
+		// Zero if b > a.
+		template <>
+		struct SimdSaturateSubtract<4, false>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b)
+			{
+				return _mm_andnot_si128(SimdCmpgtEpu32Sat(b, a), _mm_sub_epi32(a, b));
+			}
+		};
+
+		// Overflowed if the signs of sources differ and the sign of the result differs
+		// from the first source.
+		template <>
+		struct SimdSaturateSubtract<4, true>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b)
+			{
+				__m128i c = _mm_sub_epi32(a, b);
+				__m128i overflow = _mm_srai_epi32(_mm_and_si128(_mm_xor_si128(a, b),
+					_mm_xor_si128(a, c)), 31);
+				return SimdSelect(overflow, SimdLimitEpi32(a), c);
+			}
+		};
+
+		// Subtract
+		////////////////////////////////////////////////////////////////////////////////////
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Multiply
+
+		// 16-bit products of zero-extended values, clamped to 255, and then packed.
+		template <>
+		struct SimdSaturateMultiply<1, false>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b)
+			{
+				const __m128i zero = _mm_setzero_si128(), max = _mm_set1_epi16(0xFF);
+				__m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero),
+					_mm_unpacklo_epi8(b, zero));
+				__m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero),
+					_mm_unpackhi_epi8(b, zero));
+				return _mm_packus_epi16(SimdMinEpu16(lo, max), SimdMinEpu16(hi, max));
+			}
+		};
+
+		// 16-bit products of sign-extended values, packed with signed saturation.
+		template <>
+		struct SimdSaturateMultiply<1, true>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b)
+			{
+				__m128i lo = _mm_mullo_epi16(_mm_srai_epi16(_mm_unpacklo_epi8(a, a), 8),
+					_mm_srai_epi16(_mm_unpacklo_epi8(b, b), 8));
+				__m128i hi = _mm_mullo_epi16(_mm_srai_epi16(_mm_unpackhi_epi8(a, a), 8),
+					_mm_srai_epi16(_mm_unpackhi_epi8(b, b), 8));
+				return _mm_packs_epi16(lo, hi);
+			}
+		};
+
+		// 0xFFFF if the high 16 bits of the product is not zero.
+		template <>
+		struct SimdSaturateMultiply<2, false>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b)
+			{
+				__m128i overflow = _mm_cmpeq_epi16(_mm_mulhi_epu16(a, b), _mm_setzero_si128());
+				return _mm_or_si128(_mm_mullo_epi16(a, b),
+					_mm_xor_si128(overflow, _mm_set1_epi32(-1)));
+			}
+		};
+
+		// 32-bit products from the low and high 16 bits, packed with signed saturation.
+		template <>
+		struct SimdSaturateMultiply<2, true>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b)
+			{
+				__m128i lo = _mm_mullo_epi16(a, b), hi = _mm_mulhi_epi16(a, b);
+				return _mm_packs_epi32(_mm_unpacklo_epi16(lo, hi), _mm_unpackhi_epi16(lo, hi));
+			}
+		};
+
+		// Multiply
+		////////////////////////////////////////////////////////////////////////////////////
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Cast
+
+		template <>
+		struct SimdSaturateCast<short, unsigned char>
+		{
+			static const bool enabled = true;
+			static const std::size_t step = 16;
+			static void Apply(const short *src, unsigned char *dst)
+			{
+				SimdStore(dst, _mm_packus_epi16(SimdLoad(src), SimdLoad(src + 8)));
+			}
+		};
+
+		template <>
+		struct SimdSaturateCast<short, signed char>
+		{
+			static const bool enabled = true;
+			static const std::size_t step = 16;
+			static void Apply(const short *src, signed char *dst)
+			{
+				SimdStore(dst, _mm_packs_epi16(SimdLoad(src), SimdLoad(src + 8)));
+			}
+		};
+
+		// Clamped to 255 first because packus_epi16 takes signed values.
+		template <>
+		struct SimdSaturateCast<unsigned short, unsigned char>
+		{
+			static const bool enabled = true;
+			static const std::size_t step = 16;
+			static void Apply(const unsigned short *src, unsigned char *dst)
+			{
+				const __m128i max = _mm_set1_epi16(0xFF);
+				SimdStore(dst, _mm_packus_epi16(SimdMinEpu16(SimdLoad(src), max),
+					SimdMinEpu16(SimdLoad(src + 8), max)));
+			}
+		};
+
+		template <>
+		struct SimdSaturateCast<int, short>
+		{
+			static const bool enabled = true;
+			static const std::size_t step = 8;
+			static void Apply(const int *src, short *dst)
+			{
+				SimdStore(dst, _mm_packs_epi32(SimdLoad(src), SimdLoad(src + 4)));
+			}
+		};
+
+		// int -> short -> unsigned char; both steps saturate, so the result is exact.
+		template <>
+		struct SimdSaturateCast<int, unsigned char>
+		{
+			static const bool enabled = true;
+			static const std::size_t step = 16;
+			static void Apply(const int *src, unsigned char *dst)
+			{
+				__m128i lo = _mm_packs_epi32(SimdLoad(src), SimdLoad(src + 4));
+				__m128i hi = _mm_packs_epi32(SimdLoad(src + 8), SimdLoad(src + 12));
+				SimdStore(dst, _mm_packus_epi16(lo, hi));
+			}
+		};
+
+		// Clamped as floating point values, and then truncated by cvttps.
+		template <>
+		struct SimdSaturateCast<float, unsigned char>
+		{
+			static const bool enabled = true;
+			static const std::size_t step = 16;
+			static void Apply(const float *src, unsigned char *dst)
+			{
+				const __m128 lo = _mm_setzero_ps(), hi = _mm_set1_ps(255.0f);
+				__m128i v[4];
+				for (int n = 0; n != 4; ++n)
+					v[n] = _mm_cvttps_epi32(SimdClampPs(_mm_loadu_ps(src + 4 * n), lo, hi));
+				SimdStore(dst, _mm_packus_epi16(_mm_packs_epi32(v[0], v[1]),
+					_mm_packs_epi32(v[2], v[3])));
+			}
+		};
+
+		template <>
+		struct SimdSaturateCast<float, short>
+		{
+			static const bool enabled = true;
+			static const std::size_t step = 8;
+			static void Apply(const float *src, short *dst)
+			{
+				const __m128 lo = _mm_set1_ps(-32768.0f), hi = _mm_set1_ps(32767.0f);
+				__m128i v0 = _mm_cvttps_epi32(SimdClampPs(_mm_loadu_ps(src), lo, hi));
+				__m128i v1 = _mm_cvttps_epi32(SimdClampPs(_mm_loadu_ps(src + 4), lo, hi));
+				SimdStore(dst, _mm_packs_epi32(v0, v1));
+			}
+		};
+
+		// Cast
+		////////////////////////////////////////////////////////////////////////////////////
+#endif
+
+		// SSE2 operations.
+		////////////////////////////////////////////////////////////////////////////////////
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Range operations.
+
+		// char is either signed char or unsigned char for the SIMD kernels.
+		template <typename T>
+		struct SimdValueType
+		{
+			typedef typename std::conditional<std::is_same<T, char>::value,
+				typename std::conditional<std::is_signed<char>::value, signed char,
+				unsigned char>::type, T>::type type;
+		};
+
+		template <typename Op, typename SimdOp, typename T>
+		void SaturateRange_imp(const T *itA, const T *itB, T *itC, std::size_t n,
+			std::false_type)
+		{
+			for (std::size_t i = 0; i != n; ++i)
+				Op::Apply(itA[i], itB[i], itC[i]);
+		}
+
+		template <typename Op, typename SimdOp, typename T>
+		void SaturateRange_imp(const T *itA, const T *itB, T *itC, std::size_t n,
+			std::true_type)
+		{
+			std::size_t i = 0;
+#if defined(UTILITIES_HAVE_SSE2)
+			const std::size_t step = sizeof(__m128i) / sizeof(T);
+			for (; i + step <= n; i += step)
+				SimdStore(itC + i, SimdOp::Apply(SimdLoad(itA + i), SimdLoad(itB + i)));
+#endif
+			SaturateRange_imp<Op, SimdOp>(itA + i, itB + i, itC + i, n - i,
+				std::false_type());
+		}
+
+		template <typename Op, template <std::size_t, bool> class SimdOp, typename T>
+		void SaturateRange(const T *itA, const T *itA_last, const T *itB, T *itC)
+		{
+			typedef SimdOp<sizeof(T), std::is_signed<T>::value> SimdOpT;
+			SaturateRange_imp<Op, SimdOpT>(itA, itB, itC,
+				static_cast<std::size_t>(itA_last - itA),
+				std::integral_constant<bool, std::is_integral<T>::value &&
+				SimdOpT::enabled>());
+		}
+
+		template <typename SimdOp, typename T, typename U>
+		void SaturateCastRange_imp(const T *itSrc, U *itDst, std::size_t n, std::false_type)
+		{
+			for (std::size_t i = 0; i != n; ++i)
+				Cast(itSrc[i], itDst[i], Saturate());
+		}
+
+		template <typename SimdOp, typename T, typename U>
+		void SaturateCastRange_imp(const T *itSrc, U *itDst, std::size_t n, std::true_type)
+		{
+			std::size_t i = 0;
+#if defined(UTILITIES_HAVE_SSE2)
+			typedef typename SimdValueType<T>::type SimdT;
+			typedef typename SimdValueType<U>::type SimdU;
+			for (; i + SimdOp::step <= n; i += SimdOp::step)
+				SimdOp::Apply(reinterpret_cast<const SimdT *>(itSrc + i),
+				reinterpret_cast<SimdU *>(itDst + i));
+#endif
+			SaturateCastRange_imp<SimdOp>(itSrc + i, itDst + i, n - i, std::false_type());
+		}
+
+		// Range operations.
+		////////////////////////////////////////////////////////////////////////////////////
+	}
+
+	/* C = A op B for contiguous arrays of the same arithmetic type with saturation.
+	itC may be the same as itA or itB (in-place operation), but must not partially overlap
+	them. */
+
+	template <typename T>
+	std::enable_if_t<std::is_arithmetic<T>::value, void> SaturateAddRange(const T *itA,
+		const T *itA_last, const T *itB, T *itC)
+	{
+		Internal::SaturateRange<Internal::SaturateAdd, Internal::SimdSaturateAdd>(itA,
+			itA_last, itB, itC);
+	}
+
+	template <typename T>
+	std::enable_if_t<std::is_arithmetic<T>::value, void> SaturateSubtractRange(const T *itA,
+		const T *itA_last, const T *itB, T *itC)
+	{
+		Internal::SaturateRange<Internal::SaturateSubtract, Internal::SimdSaturateSubtract>(
+			itA, itA_last, itB, itC);
+	}
+
+	template <typename T>
+	std::enable_if_t<std::is_arithmetic<T>::value, void> SaturateMultiplyRange(const T *itA,
+		const T *itA_last, const T *itB, T *itC)
+	{
+		Internal::SaturateRange<Internal::SaturateMultiply, Internal::SimdSaturateMultiply>(
+			itA, itA_last, itB, itC);
+	}
+
+	// Src -> Dst for contiguous arrays with saturation.
+	template <typename T, typename U>
+	std::enable_if_t<std::is_arithmetic<T>::value && std::is_arithmetic<U>::value, void>
+		SaturateCastRange(const T *itSrc, const T *itSrcLast, U *itDst)
+	{
+		typedef Internal::SimdSaturateCast<typename Internal::SimdValueType<T>::type,
+			typename Internal::SimdValueType<U>::type> SimdOp;
+		Internal::SaturateCastRange_imp<SimdOp>(itSrc, itDst,
+			static_cast<std::size_t>(itSrcLast - itSrc),
+			std::integral_constant<bool, SimdOp::enabled>());
+	}
+}
+
+#endif
@@ -0,0 +1,273 @@
+#if !defined(VIEW_H)
+#define VIEW_H
+
+#include <sstream>
+#include <type_traits>
+
+#include "utilities/containers.h"
+#include "image.h"
+
+namespace Imaging
+{
+	/* Non-owning view of pixel-based bitmap (raster) image data.
+
+	A view is a raw pointer to the first pixel plus the dimension of the image data
+	{dataType, size, depth, bytesPerLine}, so it can describe an entire ImageFrame, an ROI
+	of an ImageFrame, or image data owned by anything else (e.g. a camera driver) without
+	copying the image data.
+	Since bytesPerLine is kept from the source, an ROI is just another view with a shifted
+	pointer and a smaller size. A view of a view is still a view of the original data.
+
+	The byte unit type is either ImageFrame::ByteType (ImageView) or
+	const ImageFrame::ByteType (ConstImageView). An ImageView can be converted to a
+	ConstImageView, but not vice versa.
+
+	Lifetime.
+	A view does not own the image data, so the source must outlive the view. Resetting or
+	moving the source ImageFrame invalidates its views. Creating a view of a temporary
+	ImageFrame is disabled for this reason.
+
+	The accessors use the same names as ImageFrame, so function templates can take either an
+	ImageFrame or a view. */
+	template <typename B>
+	class BasicImageView
+	{
+		static_assert(std::is_same<typename std::remove_const<B>::type,
+			ImageFrame::ByteType>::value, "Only ImageFrame::ByteType is supported.");
+
+	public:
+		////////////////////////////////////////////////////////////////////////////////////
+		// Types and constants.
+		typedef B ByteType;
+		typedef ImageFrame::SizeType SizeType;
+		typedef B *Iterator;
+		typedef const ImageFrame::ByteType *ConstIterator;
+		typedef ImageFrame::ROI ROI;
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Default constructors.
+		BasicImageView(void) = default;
+		BasicImageView(const BasicImageView<B> &src);
+		BasicImageView<B> &operator=(const BasicImageView<B> &src);
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Custom constructors.
+		BasicImageView(B *src, DataType ty, const Size2D<SizeType> &sz, SizeType d,
+			SizeType stepBytes);
+		BasicImageView(ImageFrame &imgSrc);
+		BasicImageView(const ImageFrame &imgSrc);
+		BasicImageView(ImageFrame &&imgSrc) = delete;
+		BasicImageView(const ImageFrame &&imgSrc) = delete;
+
+		// ImageView -> ConstImageView
+		template <typename U>
+		BasicImageView(const BasicImageView<U> &src);
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Accessors.
+		Iterator Begin(const Point2D<SizeType> &pt = { 0, 0 }) const;
+		ConstIterator Cbegin(const Point2D<SizeType> &pt = { 0, 0 }) const;
+
+		const SizeType &bytesPerLine = this->bytesPerLine_;
+		const DataType &dataType = this->dataType_;
+		const SizeType &depth = this->depth_;
+		const Size2D<SizeType> &size = this->size_;
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Methods.
+		bool HaveZeroPaddingBytes(void) const;
+		bool IsEmpty(void) const;
+
+		// Creates a view of the ROI without copying image data.
+		BasicImageView<B> SubView(const ROI &roi) const;
+
+	protected:
+		////////////////////////////////////////////////////////////////////////////////////
+		// Accessors.
+		SizeType GetOffset(const Point2D<SizeType> &pt) const;
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Methods.
+		void EvalRoi(const Point2D<SizeType> &orgn, const Size2D<SizeType> &sz) const;
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Data.
+		B *begin_ = nullptr;
+		SizeType bytesPerLine_ = 0;
+		DataType dataType_ = DataType::UNDEFINED;
+		SizeType depth_ = 0;
+		Size2D<SizeType> size_ = Size2D<SizeType>(0, 0);
+
+		template <typename U>
+		friend class BasicImageView;
+	};
+
+	// Custom name for frequently used classes.
+	typedef BasicImageView<ImageFrame::ByteType> ImageView;
+	typedef BasicImageView<const ImageFrame::ByteType> ConstImageView;
+}
+
+namespace Imaging
+{
+	////////////////////////////////////////////////////////////////////////////////////////
+	// BasicImageView<B>
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Constructors.
+
+	template <typename B>
+	BasicImageView<B>::BasicImageView(const BasicImageView<B> &src) : BasicImageView<B>()
+	{
+		*this = src;
+	}
+
+	template <typename B>
+	BasicImageView<B> &BasicImageView<B>::operator=(const BasicImageView<B> &src)
+	{
+		this->begin_ = src.begin_;
+		this->bytesPerLine_ = src.bytesPerLine;
+		this->dataType_ = src.dataType;
+		this->depth_ = src.depth;
+		this->size_ = src.size;
+		return *this;
+	}
+
+	template <typename B>
+	BasicImageView<B>::BasicImageView(B *src, DataType ty, const Size2D<SizeType> &sz,
+		SizeType d, SizeType stepBytes) : BasicImageView<B>()
+	{
+		if (stepBytes < ImageFrame::GetBytesPerLine(ty, sz.width, d))
+		{
+			std::ostringstream errMsg;
+			errMsg << "The step size (" << stepBytes << ") is less than the effective " <<
+				"bytes per line of the image (" << sz.width << " x " << d << ").";
+			throw std::invalid_argument(errMsg.str());
+		}
+
+		this->begin_ = src;
+		this->bytesPerLine_ = stepBytes;
+		this->dataType_ = ty;
+		this->depth_ = d;
+		this->size_ = sz;
+	}
+
+	template <typename B>
+	BasicImageView<B>::BasicImageView(ImageFrame &imgSrc) : BasicImageView<B>()
+	{
+		if (!imgSrc.data.empty())
+			this->begin_ = &(*imgSrc.Begin());
+		this->bytesPerLine_ = imgSrc.bytesPerLine;
+		this->dataType_ = imgSrc.dataType;
+		this->depth_ = imgSrc.depth;
+		this->size_ = imgSrc.size;
+	}
+
+	template <typename B>
+	BasicImageView<B>::BasicImageView(const ImageFrame &imgSrc) : BasicImageView<B>()
+	{
+		static_assert(std::is_const<B>::value,
+			"A const ImageFrame can be viewed only by a ConstImageView.");
+		if (!imgSrc.data.empty())
+			this->begin_ = &(*imgSrc.Cbegin());
+		this->bytesPerLine_ = imgSrc.bytesPerLine;
+		this->dataType_ = imgSrc.dataType;
+		this->depth_ = imgSrc.depth;
+		this->size_ = imgSrc.size;
+	}
+
+	template <typename B>
+	template <typename U>
+	BasicImageView<B>::BasicImageView(const BasicImageView<U> &src) : BasicImageView<B>()
+	{
+		static_assert(std::is_const<B>::value || !std::is_const<U>::value,
+			"A ConstImageView cannot be converted to an ImageView.");
+		this->begin_ = src.begin_;
+		this->bytesPerLine_ = src.bytesPerLine;
+		this->dataType_ = src.dataType;
+		this->depth_ = src.depth;
+		this->size_ = src.size;
+	}
+
+	// Constructors.
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Accessors.
+
+	template <typename B>
+	typename BasicImageView<B>::Iterator BasicImageView<B>::Begin(
+		const Point2D<SizeType> &pt) const
+	{
+		if (pt == Point2D<SizeType>{ 0, 0 })
+			return this->begin_;
+		else
+		{
+			this->EvalRoi(pt, { 1, 1 });
+			return this->begin_ + this->GetOffset(pt);
+		}
+	}
+
+	template <typename B>
+	typename BasicImageView<B>::ConstIterator BasicImageView<B>::Cbegin(
+		const Point2D<SizeType> &pt) const
+	{
+		return this->Begin(pt);
+	}
+
+	template <typename B>
+	typename BasicImageView<B>::SizeType BasicImageView<B>::GetOffset(
+		const Point2D<SizeType> &pt) const
+	{
+		return this->bytesPerLine * pt.y + GetNumBytes(this->dataType) * this->depth * pt.x;
+	}
+
+	// Accessors.
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Methods.
+
+	template <typename B>
+	void BasicImageView<B>::EvalRoi(const Point2D<SizeType> &orgn,
+		const Size2D<SizeType> &sz) const
+	{
+		Point2D<SizeType> ptEnd = orgn + sz;	// excluding point
+		if (ptEnd.x > this->size.width || ptEnd.y > this->size.height)
+		{
+			std::ostringstream errMsg;
+			errMsg << "[" << orgn.x << ", " << orgn.y << "] ~ (" << ptEnd.x <<
+				", " << ptEnd.y << ") is out of range.";
+			throw std::out_of_range(errMsg.str());
+		}
+	}
+
+	template <typename B>
+	bool BasicImageView<B>::HaveZeroPaddingBytes(void) const
+	{
+		return this->bytesPerLine == ImageFrame::GetBytesPerLine(this->dataType,
+			this->size.width, this->depth);
+	}
+
+	template <typename B>
+	bool BasicImageView<B>::IsEmpty(void) const
+	{
+		return this->begin_ == nullptr || this->size.width == 0 || this->size.height == 0;
+	}
+
+	template <typename B>
+	BasicImageView<B> BasicImageView<B>::SubView(const ROI &roi) const
+	{
+		this->EvalRoi(roi.origin, roi.size);
+		BasicImageView<B> viewDst = *this;
+		viewDst.begin_ = this->begin_ + this->GetOffset(roi.origin);
+		viewDst.size_ = roi.size;
+		return viewDst;
+	}
+
+	// Methods.
+	////////////////////////////////////////////////////////////////////////////////////////
+
+	// BasicImageView<B>
+	////////////////////////////////////////////////////////////////////////////////////////
+}
+#endif
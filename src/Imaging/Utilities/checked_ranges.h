@@ -0,0 +1,520 @@
+#if !defined(CHECKED_RANGES_H)
+#define CHECKED_RANGES_H
+
+/*
+Declares and defines arithmetic operations with overflow checking for contiguous arrays of
+the same data type.
+Features are designed as non-member function templates in a namespace.
+
+Unlike the element-wise functions in safe_operations.h, these functions do not stop at the
+first overflow. All of the result values are computed, and the position of the first
+overflowed element is returned at the end. An overflowed result value is truncated to the
+bits of the data type (wrapped).
+This lets the loop compute multiple elements at once with SIMD instructions while the
+overflow of each element is accumulated as a mask, instead of a branch per element.
+
+SSE2 is used if it is enabled at compile time, i.e. always for x64, and for x86 if
+/arch:SSE2 (default since Visual Studio 2012) or -msse2 is given.
+Vectorized data types: 8-bit and 16-bit integers for {+, -, *}, 32-bit integers for {+, -}.
+Other data types and the remaining elements of a range are computed one by one; with
+SafeInt for 32-bit and 64-bit integers.
+*/
+
+#include <cstddef>
+#include <limits>
+#include <type_traits>
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define UTILITIES_HAVE_SSE2
+#include <emmintrin.h>
+#endif
+
+#include "safe_operations.h"
+
+namespace Utilities
+{
+	namespace Internal
+	{
+		////////////////////////////////////////////////////////////////////////////////////
+		// Scalar operations.
+
+		// Unsigned type with the same width as T, but at least as wide as unsigned int
+		// to avoid the promotion to (signed) int.
+		template <typename T>
+		struct WrapType
+		{
+			typedef typename std::conditional<(sizeof(T) < sizeof(unsigned int)),
+				unsigned int, typename std::make_unsigned<T>::type>::type type;
+		};
+
+		// True if a value of a wider type W is within the range of T.
+		template <typename T, typename W>
+		bool IsInRange(W w)
+		{
+			return w >= static_cast<W>(std::numeric_limits<T>::min()) &&
+				w <= static_cast<W>(std::numeric_limits<T>::max());
+		}
+
+		/* Each operation computes c = a op b and returns false if overflowed.
+		c is the wrapped value if overflowed.
+		Types narrower than int are computed exactly with long long, because the result of
+		SafeInt for them relies on the overflow of the promoted int. */
+
+		struct CheckedAdd
+		{
+			template <typename T>
+			static std::enable_if_t<std::is_integral<T>::value &&
+				(sizeof(T) < sizeof(int)), bool> Apply(T a, T b, T &c)
+			{
+				long long result = static_cast<long long>(a) + static_cast<long long>(b);
+				c = static_cast<T>(result);
+				return IsInRange<T>(result);
+			}
+
+			template <typename T>
+			static std::enable_if_t<std::is_integral<T>::value &&
+				(sizeof(T) >= sizeof(int)), bool> Apply(T a, T b, T &c)
+			{
+				typedef typename WrapType<T>::type U;
+				T result;
+				bool ok = ::SafeAdd(a, b, result);
+				c = static_cast<T>(static_cast<U>(a) + static_cast<U>(b));
+				return ok;
+			}
+
+			template <typename T>
+			static std::enable_if_t<std::is_floating_point<T>::value, bool> Apply(T a, T b,
+				T &c)
+			{
+				c = a + b;
+				return true;
+			}
+		};
+
+		struct CheckedSubtract
+		{
+			template <typename T>
+			static std::enable_if_t<std::is_integral<T>::value &&
+				(sizeof(T) < sizeof(int)), bool> Apply(T a, T b, T &c)
+			{
+				long long result = static_cast<long long>(a) - static_cast<long long>(b);
+				c = static_cast<T>(result);
+				return IsInRange<T>(result);
+			}
+
+			template <typename T>
+			static std::enable_if_t<std::is_integral<T>::value &&
+				(sizeof(T) >= sizeof(int)), bool> Apply(T a, T b, T &c)
+			{
+				typedef typename WrapType<T>::type U;
+				T result;
+				bool ok = ::SafeSubtract(a, b, result);
+				c = static_cast<T>(static_cast<U>(a) - static_cast<U>(b));
+				return ok;
+			}
+
+			template <typename T>
+			static std::enable_if_t<std::is_floating_point<T>::value, bool> Apply(T a, T b,
+				T &c)
+			{
+				c = a - b;
+				return true;
+			}
+		};
+
+		struct CheckedMultiply
+		{
+			template <typename T>
+			static std::enable_if_t<std::is_integral<T>::value &&
+				(sizeof(T) < sizeof(int)), bool> Apply(T a, T b, T &c)
+			{
+				long long result = static_cast<long long>(a) * static_cast<long long>(b);
+				c = static_cast<T>(result);
+				return IsInRange<T>(result);
+			}
+
+			template <typename T>
+			static std::enable_if_t<std::is_integral<T>::value &&
+				(sizeof(T) >= sizeof(int)), bool> Apply(T a, T b, T &c)
+			{
+				typedef typename WrapType<T>::type U;
+				T result;
+				bool ok = ::SafeMultiply(a, b, result);
+				c = static_cast<T>(static_cast<U>(a) * static_cast<U>(b));
+				return ok;
+			}
+
+			template <typename T>
+			static std::enable_if_t<std::is_floating_point<T>::value, bool> Apply(T a, T b,
+				T &c)
+			{
+				c = a * b;
+				return true;
+			}
+		};
+
+		// Scalar operations.
+		////////////////////////////////////////////////////////////////////////////////////
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// SSE2 operations.
+
+		/* SimdChecked{Op}<N, S> is the vector version of Checked{Op} for integral types of
+		N bytes with signedness S, so char, signed char, and unsigned char share kernels
+		depending on their signedness.
+		Apply() returns the wrapped result, and sets every bit of an element in 'overflow'
+		if the element overflowed.
+		'enabled' is false if there is no vector version. */
+
+		template <std::size_t N, bool S>
+		struct SimdCheckedAdd
+		{
+			static const bool enabled = false;
+		};
+
+		template <std::size_t N, bool S>
+		struct SimdCheckedSubtract
+		{
+			static const bool enabled = false;
+		};
+
+		template <std::size_t N, bool S>
+		struct SimdCheckedMultiply
+		{
+			static const bool enabled = false;
+		};
+
+#if defined(UTILITIES_HAVE_SSE2)
+		inline __m128i SimdNot(__m128i v)
+		{
+			return _mm_xor_si128(v, _mm_set1_epi32(-1));
+		}
+
+		// Unsigned comparison a > b of 32-bit values.
+		inline __m128i SimdCmpgtEpu32(__m128i a, __m128i b)
+		{
+			const __m128i bias = _mm_set1_epi32(static_cast<int>(0x80000000));
+			return _mm_cmpgt_epi32(_mm_xor_si128(a, bias), _mm_xor_si128(b, bias));
+		}
+
+		// 8-bit and 16-bit; overflowed if the wrapped result differs from the saturated one.
+		template <>
+		struct SimdCheckedAdd<1, false>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b, __m128i &overflow)
+			{
+				__m128i c = _mm_add_epi8(a, b);
+				overflow = SimdNot(_mm_cmpeq_epi8(c, _mm_adds_epu8(a, b)));
+				return c;
+			}
+		};
+
+		template <>
+		struct SimdCheckedAdd<1, true>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b, __m128i &overflow)
+			{
+				__m128i c = _mm_add_epi8(a, b);
+				overflow = SimdNot(_mm_cmpeq_epi8(c, _mm_adds_epi8(a, b)));
+				return c;
+			}
+		};
+
+		template <>
+		struct SimdCheckedAdd<2, false>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b, __m128i &overflow)
+			{
+				__m128i c = _mm_add_epi16(a, b);
+				overflow = SimdNot(_mm_cmpeq_epi16(c, _mm_adds_epu16(a, b)));
+				return c;
+			}
+		};
+
+		template <>
+		struct SimdCheckedAdd<2, true>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b, __m128i &overflow)
+			{
+				__m128i c = _mm_add_epi16(a, b);
+				overflow = SimdNot(_mm_cmpeq_epi16(c, _mm_adds_epi16(a, b)));
+				return c;
+			}
+		};
+
+		// Overflowed if the sum is less than a source value.
+		template <>
+		struct SimdCheckedAdd<4, false>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b, __m128i &overflow)
+			{
+				__m128i c = _mm_add_epi32(a, b);
+				overflow = SimdCmpgtEpu32(a, c);
+				return c;
+			}
+		};
+
+		// Overflowed if the sign of the sum differs from both sources.
+		template <>
+		struct SimdCheckedAdd<4, true>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b, __m128i &overflow)
+			{
+				__m128i c = _mm_add_epi32(a, b);
+				overflow = _mm_srai_epi32(_mm_and_si128(_mm_xor_si128(a, c),
+					_mm_xor_si128(b, c)), 31);
+				return c;
+			}
+		};
+
+		template <>
+		struct SimdCheckedSubtract<1, false>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b, __m128i &overflow)
+			{
+				__m128i c = _mm_sub_epi8(a, b);
+				overflow = SimdNot(_mm_cmpeq_epi8(c, _mm_subs_epu8(a, b)));
+				return c;
+			}
+		};
+
+		template <>
+		struct SimdCheckedSubtract<1, true>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b, __m128i &overflow)
+			{
+				__m128i c = _mm_sub_epi8(a, b);
+				overflow = SimdNot(_mm_cmpeq_epi8(c, _mm_subs_epi8(a, b)));
+				return c;
+			}
+		};
+
+		template <>
+		struct SimdCheckedSubtract<2, false>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b, __m128i &overflow)
+			{
+				__m128i c = _mm_sub_epi16(a, b);
+				overflow = SimdNot(_mm_cmpeq_epi16(c, _mm_subs_epu16(a, b)));
+				return c;
+			}
+		};
+
+		template <>
+		struct SimdCheckedSubtract<2, true>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b, __m128i &overflow)
+			{
+				__m128i c = _mm_sub_epi16(a, b);
+				overflow = SimdNot(_mm_cmpeq_epi16(c, _mm_subs_epi16(a, b)));
+				return c;
+			}
+		};
+
+		// Overflowed if b > a.
+		template <>
+		struct SimdCheckedSubtract<4, false>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b, __m128i &overflow)
+			{
+				overflow = SimdCmpgtEpu32(b, a);
+				return _mm_sub_epi32(a, b);
+			}
+		};
+
+		// Overflowed if the signs of sources differ and the sign of the result differs
+		// from the first source.
+		template <>
+		struct SimdCheckedSubtract<4, true>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b, __m128i &overflow)
+			{
+				__m128i c = _mm_sub_epi32(a, b);
+				overflow = _mm_srai_epi32(_mm_and_si128(_mm_xor_si128(a, b),
+					_mm_xor_si128(a, c)), 31);
+				return c;
+			}
+		};
+
+		// 16-bit products of zero-extended values; overflowed if the high byte is not zero.
+		template <>
+		struct SimdCheckedMultiply<1, false>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b, __m128i &overflow)
+			{
+				const __m128i zero = _mm_setzero_si128(), mask = _mm_set1_epi16(0xFF);
+				__m128i lo = _mm_mullo_epi16(_mm_unpacklo_epi8(a, zero),
+					_mm_unpacklo_epi8(b, zero));
+				__m128i hi = _mm_mullo_epi16(_mm_unpackhi_epi8(a, zero),
+					_mm_unpackhi_epi8(b, zero));
+				overflow = _mm_packs_epi16(
+					SimdNot(_mm_cmpeq_epi16(_mm_srli_epi16(lo, 8), zero)),
+					SimdNot(_mm_cmpeq_epi16(_mm_srli_epi16(hi, 8), zero)));
+				return _mm_packus_epi16(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+			}
+		};
+
+		// 16-bit products of sign-extended values; overflowed if the product differs from
+		// its sign-extended low byte.
+		template <>
+		struct SimdCheckedMultiply<1, true>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b, __m128i &overflow)
+			{
+				const __m128i mask = _mm_set1_epi16(0xFF);
+				__m128i lo = _mm_mullo_epi16(_mm_srai_epi16(_mm_unpacklo_epi8(a, a), 8),
+					_mm_srai_epi16(_mm_unpacklo_epi8(b, b), 8));
+				__m128i hi = _mm_mullo_epi16(_mm_srai_epi16(_mm_unpackhi_epi8(a, a), 8),
+					_mm_srai_epi16(_mm_unpackhi_epi8(b, b), 8));
+				overflow = _mm_packs_epi16(
+					SimdNot(_mm_cmpeq_epi16(lo, _mm_srai_epi16(_mm_slli_epi16(lo, 8), 8))),
+					SimdNot(_mm_cmpeq_epi16(hi, _mm_srai_epi16(_mm_slli_epi16(hi, 8), 8))));
+				return _mm_packus_epi16(_mm_and_si128(lo, mask), _mm_and_si128(hi, mask));
+			}
+		};
+
+		// Overflowed if the high 16 bits of the product is not zero.
+		template <>
+		struct SimdCheckedMultiply<2, false>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b, __m128i &overflow)
+			{
+				overflow = SimdNot(_mm_cmpeq_epi16(_mm_mulhi_epu16(a, b),
+					_mm_setzero_si128()));
+				return _mm_mullo_epi16(a, b);
+			}
+		};
+
+		// Overflowed if the high 16 bits of the product is not the sign of the low 16 bits.
+		template <>
+		struct SimdCheckedMultiply<2, true>
+		{
+			static const bool enabled = true;
+			static __m128i Apply(__m128i a, __m128i b, __m128i &overflow)
+			{
+				__m128i c = _mm_mullo_epi16(a, b);
+				overflow = SimdNot(_mm_cmpeq_epi16(_mm_mulhi_epi16(a, b),
+					_mm_srai_epi16(c, 15)));
+				return c;
+			}
+		};
+
+		// Index of the lowest set bit; bits must not be zero.
+		inline std::size_t LowestBit(int bits)
+		{
+			std::size_t index = 0;
+			while ((bits & 1) == 0)
+			{
+				bits >>= 1;
+				++index;
+			}
+			return index;
+		}
+#endif
+
+		// SSE2 operations.
+		////////////////////////////////////////////////////////////////////////////////////
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Range operations.
+
+		// Scalar loop only.
+		template <typename Op, typename SimdOp, typename T>
+		std::size_t CheckedRange_imp(const T *itA, const T *itB, T *itC, std::size_t n,
+			std::false_type)
+		{
+			std::size_t first = n;
+			for (std::size_t i = 0; i != n; ++i)
+				if (!Op::Apply(itA[i], itB[i], itC[i]) && first == n)
+					first = i;
+			return first;
+		}
+
+		/* Vector loop, and then the remaining elements with the scalar loop.
+		The branch for an overflowed vector is taken at most once per range, so it is
+		almost free on a branch predictor. */
+		template <typename Op, typename SimdOp, typename T>
+		std::size_t CheckedRange_imp(const T *itA, const T *itB, T *itC, std::size_t n,
+			std::true_type)
+		{
+			std::size_t first = n, i = 0;
+#if defined(UTILITIES_HAVE_SSE2)
+			const std::size_t step = sizeof(__m128i) / sizeof(T);
+			for (; i + step <= n; i += step)
+			{
+				__m128i overflow;
+				__m128i c = SimdOp::Apply(
+					_mm_loadu_si128(reinterpret_cast<const __m128i *>(itA + i)),
+					_mm_loadu_si128(reinterpret_cast<const __m128i *>(itB + i)), overflow);
+				_mm_storeu_si128(reinterpret_cast<__m128i *>(itC + i), c);
+
+				int bits = _mm_movemask_epi8(overflow);
+				if (bits != 0 && first == n)
+					first = i + LowestBit(bits) / sizeof(T);
+			}
+#endif
+			std::size_t firstTail = CheckedRange_imp<Op, SimdOp>(itA + i, itB + i, itC + i,
+				n - i, std::false_type());
+			return first != n ? first : i + firstTail;
+		}
+
+		template <typename Op, template <std::size_t, bool> class SimdOp, typename T>
+		std::size_t CheckedRange(const T *itA, const T *itA_last, const T *itB, T *itC)
+		{
+			typedef SimdOp<sizeof(T), std::is_signed<T>::value> SimdOpT;
+			return CheckedRange_imp<Op, SimdOpT>(itA, itB, itC,
+				static_cast<std::size_t>(itA_last - itA),
+				std::integral_constant<bool, std::is_integral<T>::value && SimdOpT::enabled>());
+		}
+
+		// Range operations.
+		////////////////////////////////////////////////////////////////////////////////////
+	}
+
+	/* C = A op B for contiguous arrays of the same arithmetic type.
+	Returns the position of the first overflowed element, or (itA_last - itA) if no element
+	overflowed. Floating point types never overflow.
+	itC may be the same as itA or itB (in-place operation), but must not partially overlap
+	them. */
+
+	template <typename T>
+	std::enable_if_t<std::is_arithmetic<T>::value, std::size_t> TryAddRange(const T *itA,
+		const T *itA_last, const T *itB, T *itC)
+	{
+		return Internal::CheckedRange<Internal::CheckedAdd, Internal::SimdCheckedAdd>(itA,
+			itA_last, itB, itC);
+	}
+
+	template <typename T>
+	std::enable_if_t<std::is_arithmetic<T>::value, std::size_t> TrySubtractRange(
+		const T *itA, const T *itA_last, const T *itB, T *itC)
+	{
+		return Internal::CheckedRange<Internal::CheckedSubtract,
+			Internal::SimdCheckedSubtract>(itA, itA_last, itB, itC);
+	}
+
+	template <typename T>
+	std::enable_if_t<std::is_arithmetic<T>::value, std::size_t> TryMultiplyRange(
+		const T *itA, const T *itA_last, const T *itB, T *itC)
+	{
+		return Internal::CheckedRange<Internal::CheckedMultiply,
+			Internal::SimdCheckedMultiply>(itA, itA_last, itB, itC);
+	}
+}
+
+#endif
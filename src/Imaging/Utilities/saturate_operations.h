@@ -0,0 +1,343 @@
+#if !defined(SATURATE_OPERATIONS_H)
+#define SATURATE_OPERATIONS_H
+
+/*
+Declares and defines common arithmetic operations with saturation.
+Features are designed as non-member function templates in a namespace.
+If overflow happens, the result value is clamped to the range of the result data type
+instead of throwing an std::overflow_error, e.g. 200 + 100 -> 255 for unsigned char.
+This is the same as saturate_cast<T>() of OpenCV except that floating point values are
+truncated toward zero as Cast() does.
+
+The functions take the policy tag Saturate as the last argument. Otherwise, they follow the
+same rules of data types as the functions in safe_operations.h.
+e.g. Add(t, u, result) throws if overflowed, Add(t, u, result, Saturate()) clamps.
+
+Integral types narrower than 64 bits are computed exactly with 64-bit types and then
+clamped, which compilers implement with conditional moves instead of branches.
+64-bit integral types employ SafeInt, and the direction of the overflow is evaluated only
+if overflowed.
+Operations with floating point types are the same as safe_operations.h.
+*/
+
+#include <limits>
+#include <type_traits>
+
+#include "safe_operations.h"
+
+namespace Utilities
+{
+	// Overflow policy; clamps the result value to the range of its data type.
+	struct Saturate {};
+
+	namespace Internal
+	{
+		////////////////////////////////////////////////////////////////////////////////////
+		// Common functions.
+
+		// True if exact values of the operations fit in 64-bit types.
+		template <typename T, typename U>
+		struct IsNarrowPair : std::integral_constant<bool, (sizeof(T) < 8) && (sizeof(U) < 8)>
+		{};
+
+		/* Clamps a value of a wider type W into the range of an integral type R.
+		W must be able to represent the limits of R. */
+		template <typename R, typename W>
+		R ClampTo(W w)
+		{
+			return w < static_cast<W>(std::numeric_limits<R>::min()) ?
+				std::numeric_limits<R>::min() :
+				(w > static_cast<W>(std::numeric_limits<R>::max()) ?
+				std::numeric_limits<R>::max() : static_cast<R>(w));
+		}
+
+		// Saturated value of R for an overflow toward 'negative' or positive.
+		template <typename R>
+		R Limit(bool negative)
+		{
+			return negative ? std::numeric_limits<R>::min() : std::numeric_limits<R>::max();
+		}
+
+		template <typename T>
+		bool IsNegative(T value)
+		{
+			return ::SafeLessThan(value, 0);
+		}
+
+		// |value| of a negative value.
+		template <typename T>
+		unsigned long long Magnitude(T value)
+		{
+			return 0ULL - static_cast<unsigned long long>(value);
+		}
+
+		// True if t + u < 0. Used only after an overflow, so the cost does not matter.
+		template <typename T, typename U>
+		bool IsNegativeSum(T t, U u)
+		{
+			bool negT = IsNegative(t), negU = IsNegative(u);
+			if (negT == negU)
+				return negT;
+			else if (negT)
+				return ::SafeLessThan(u, Magnitude(t));
+			else
+				return ::SafeLessThan(t, Magnitude(u));
+		}
+
+		// Common functions.
+		////////////////////////////////////////////////////////////////////////////////////
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Add
+
+		// integral = integral + integral; exact.
+		template <typename T, typename U>
+		void AddIntegralSat_imp(T t, U u, T &result, std::true_type)
+		{
+			result = ClampTo<T>(static_cast<long long>(t) + static_cast<long long>(u));
+		}
+
+		// integral = integral + integral; 64-bit.
+		template <typename T, typename U>
+		void AddIntegralSat_imp(T t, U u, T &result, std::false_type)
+		{
+			if (!::SafeAdd(t, u, result))
+				result = Limit<T>(IsNegativeSum(t, u));
+		}
+
+		template <typename T, typename U>
+		void AddSat_imp(T t, U u, T &result, std::true_type)
+		{
+			AddIntegralSat_imp(t, u, result, IsNarrowPair<T, U>());
+		}
+
+		// Any floating point type; no overflow.
+		template <typename T, typename U>
+		void AddSat_imp(T t, U u, T &result, std::false_type)
+		{
+			Add(t, u, result);
+		}
+
+		// Add
+		////////////////////////////////////////////////////////////////////////////////////
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Multiply
+
+		// The product of two unsigned 32-bit values does not fit in long long.
+		template <typename T, typename U>
+		void MultiplyIntegralSat_imp(T t, U u, T &result, std::true_type)
+		{
+			typedef typename std::conditional<std::is_unsigned<T>::value &&
+				std::is_unsigned<U>::value, unsigned long long, long long>::type W;
+			result = ClampTo<T>(static_cast<W>(t) * static_cast<W>(u));
+		}
+
+		// A product is negative if the signs differ; an overflowed product is not zero.
+		template <typename T, typename U>
+		void MultiplyIntegralSat_imp(T t, U u, T &result, std::false_type)
+		{
+			if (!::SafeMultiply(t, u, result))
+				result = Limit<T>(IsNegative(t) != IsNegative(u));
+		}
+
+		template <typename T, typename U>
+		void MultiplySat_imp(T t, U u, T &result, std::true_type)
+		{
+			MultiplyIntegralSat_imp(t, u, result, IsNarrowPair<T, U>());
+		}
+
+		template <typename T, typename U>
+		void MultiplySat_imp(T t, U u, T &result, std::false_type)
+		{
+			Multiply(t, u, result);
+		}
+
+		// Multiply
+		////////////////////////////////////////////////////////////////////////////////////
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Subtract
+
+		template <typename T, typename U>
+		void SubtractIntegralSat_imp(T t, U u, T &result, std::true_type)
+		{
+			result = ClampTo<T>(static_cast<long long>(t) - static_cast<long long>(u));
+		}
+
+		template <typename T, typename U>
+		void SubtractIntegralSat_imp(T t, U u, T &result, std::false_type)
+		{
+			if (!::SafeSubtract(t, u, result))
+				result = Limit<T>(::SafeLessThan(t, u));
+		}
+
+		template <typename T, typename U>
+		void SubtractSat_imp(T t, U u, T &result, std::true_type)
+		{
+			SubtractIntegralSat_imp(t, u, result, IsNarrowPair<T, U>());
+		}
+
+		template <typename T, typename U>
+		void SubtractSat_imp(T t, U u, T &result, std::false_type)
+		{
+			Subtract(t, u, result);
+		}
+
+		// Subtract
+		////////////////////////////////////////////////////////////////////////////////////
+
+		////////////////////////////////////////////////////////////////////////////////////
+		// Cast
+
+		// integral to integral; exact.
+		template <typename T, typename U>
+		void CastSat_imp(T src, U &dst, std::true_type)
+		{
+			dst = ClampTo<U>(static_cast<long long>(src));
+		}
+
+		// integral to integral; 64-bit.
+		template <typename T, typename U>
+		void CastSat_imp(T src, U &dst, std::false_type)
+		{
+			if (!::SafeCast(src, dst))
+				dst = Limit<U>(IsNegative(src));
+		}
+
+		template <typename T, typename U>
+		void CastSat_imp(T src, U &dst, std::true_type, std::true_type)
+		{
+			CastSat_imp(src, dst, IsNarrowPair<T, U>());
+		}
+
+		/* floating point to integral; truncates toward zero, and NaN becomes zero.
+		The limits of U converted to T are powers of two or representable, so a value
+		beyond them is out of the range of U. */
+		template <typename T, typename U>
+		void CastSat_imp(T src, U &dst, std::false_type, std::true_type)
+		{
+			dst = src != src ? static_cast<U>(0) :
+				(src <= static_cast<T>(std::numeric_limits<U>::min()) ?
+				std::numeric_limits<U>::min() :
+				(src >= static_cast<T>(std::numeric_limits<U>::max()) ?
+				std::numeric_limits<U>::max() : static_cast<U>(src)));
+		}
+
+		// integral to floating point; no overflow.
+		template <typename T, typename U>
+		void CastSat_imp(T src, U &dst, std::true_type, std::false_type)
+		{
+			dst = static_cast<U>(src);
+		}
+
+		// floating point to floating point; clamps to the finite range of U. NaN is kept.
+		template <typename T, typename U>
+		void CastSat_imp(T src, U &dst, std::false_type, std::false_type)
+		{
+			dst = src > static_cast<T>(std::numeric_limits<U>::max()) ?
+				std::numeric_limits<U>::max() :
+				(src < static_cast<T>(std::numeric_limits<U>::lowest()) ?
+				std::numeric_limits<U>::lowest() : static_cast<U>(src));
+		}
+
+		// Cast
+		////////////////////////////////////////////////////////////////////////////////////
+	}
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Add
+
+	// 1. Same data type only. T = T + T (T + T -> T)
+	// 2. Different data type scenario A. T = T + U (T + U -> T)
+	template <typename T, typename U>
+	std::enable_if_t<std::is_arithmetic<T>::value && std::is_arithmetic<U>::value, void> Add(
+		T t, U u, T &result, Saturate)
+	{
+		Internal::AddSat_imp(t, u, result, std::integral_constant<bool,
+			std::is_integral<T>::value && std::is_integral<U>::value>());
+	}
+
+	// 3. Different data type scenario B. U = T + U (T + U -> U)
+	template <typename T, typename U>
+	std::enable_if_t<std::is_arithmetic<T>::value && std::is_arithmetic<U>::value &&
+		!std::is_same<T, U>::value, void> Add(T t, U u, U &result, Saturate)
+	{
+		Internal::AddSat_imp(u, t, result, std::integral_constant<bool,
+			std::is_integral<U>::value && std::is_integral<T>::value>());
+	}
+
+	// Add
+	////////////////////////////////////////////////////////////////////////////////////////
+
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Multiply
+
+	// 1. Same data type only. T = T * T (T * T -> T)
+	// 2. Different data type scenario A. T = T * U (T * U -> T)
+	template <typename T, typename U>
+	std::enable_if_t<std::is_arithmetic<T>::value && std::is_arithmetic<U>::value, void>
+		Multiply(T t, U u, T &result, Saturate)
+	{
+		Internal::MultiplySat_imp(t, u, result, std::integral_constant<bool,
+			std::is_integral<T>::value && std::is_integral<U>::value>());
+	}
+
+	// 3. Different data type scenario B. U = T * U (T * U -> U)
+	template <typename T, typename U>
+	std::enable_if_t<std::is_arithmetic<T>::value && std::is_arithmetic<U>::value &&
+		!std::is_same<T, U>::value, void> Multiply(T t, U u, U &result, Saturate)
+	{
+		Internal::MultiplySat_imp(u, t, result, std::integral_constant<bool,
+			std::is_integral<U>::value && std::is_integral<T>::value>());
+	}
+
+	// Multiply
+	////////////////////////////////////////////////////////////////////////////////////////
+
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Subtract
+	// NOTE: The result data type is always T for subtraction as safe_operations.h.
+
+	// 1. Same data type only. T = T - T (T - T -> T)
+	// 2. Different data type scenario A. T = T - U (T - U -> T)
+	template <typename T, typename U>
+	std::enable_if_t<std::is_arithmetic<T>::value && std::is_arithmetic<U>::value, void>
+		Subtract(T t, U u, T &result, Saturate)
+	{
+		Internal::SubtractSat_imp(t, u, result, std::integral_constant<bool,
+			std::is_integral<T>::value && std::is_integral<U>::value>());
+	}
+
+	// Subtract
+	////////////////////////////////////////////////////////////////////////////////////////
+
+
+	////////////////////////////////////////////////////////////////////////////////////////
+	// Cast
+
+	// Cast(T, U, Saturate); T -> U
+	template <typename T, typename U>
+	std::enable_if_t<std::is_arithmetic<T>::value && std::is_arithmetic<U>::value, void> Cast(
+		T src, U &dst, Saturate)
+	{
+		Internal::CastSat_imp(src, dst, std::is_integral<T>(), std::is_integral<U>());
+	}
+
+	// T = Cast<T>(U, Saturate); U -> T
+	template <typename T, typename U>
+	std::enable_if_t<std::is_arithmetic<T>::value && std::is_arithmetic<U>::value, T> Cast(
+		U src, Saturate)
+	{
+		T dst;
+		Internal::CastSat_imp(src, dst, std::is_integral<U>(), std::is_integral<T>());
+		return dst;
+	}
+
+	// Cast
+	////////////////////////////////////////////////////////////////////////////////////////
+}
+
+#endif
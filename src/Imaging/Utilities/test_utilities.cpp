@@ -157,6 +157,68 @@ void TestAlgorithms(void)
 	TestAlgorithms_imp<double>();
 }
 
+void TestCheckedRanges(void)
+{
+	// 16-bit sensor data; the vector loop covers the first 32 elements.
+	std::vector<unsigned short> v1(37, 60000), v2(37, 1000), v3(37);
+	v2[20] = 6000;
+	std::size_t first = Utilities::TryAddRange(v1.data(), v1.data() + v1.size(), v2.data(),
+		v3.data());
+	if (first == 20 && v3[20] == static_cast<unsigned short>(60000 + 6000) && v3[36] == 61000)
+		std::cout << "good" << std::endl;
+
+	// Throws after computing all elements.
+	try
+	{
+		const unsigned short *p1 = v1.data(), *p2 = v2.data();
+		Utilities::AddRange(p1, p1 + v1.size(), p2, v3.data());
+	}
+	catch (const std::overflow_error &e)
+	{
+		std::cout << e.what() << std::endl;
+	}
+
+	std::vector<short> v4(37, -400), v5(37, 100), v6(37);
+	if (Utilities::TryMultiplyRange(v4.data(), v4.data() + v4.size(), v5.data(),
+		v6.data()) == 0 && Utilities::TrySubtractRange(v5.data(), v5.data() + v5.size(),
+		v4.data(), v6.data()) == v6.size() && v6[36] == 500)
+		std::cout << "good" << std::endl;
+}
+
+void TestSaturate(void)
+{
+	unsigned char uc;
+	Utilities::Add(static_cast<unsigned char>(200), static_cast<unsigned char>(100), uc,
+		Utilities::Saturate());
+	short s = Utilities::Cast<short>(-1.0e6, Utilities::Saturate());
+	long long l;
+	Utilities::Multiply(std::numeric_limits<long long>::max(), -2, l, Utilities::Saturate());
+	if (uc == 255 && s == -32768 && l == std::numeric_limits<long long>::min())
+		std::cout << "good" << std::endl;
+
+	// 8-bit images; the vector loop covers the first 32 elements.
+	std::vector<unsigned char> v1(37, 200), v2(37, 100), v3(37);
+	v2[36] = 10;
+	Utilities::AddRange(v1.data(), v1.data() + v1.size(), v2.data(), v3.data(),
+		Utilities::Saturate());
+	if (v3[0] == 255 && v3[36] == 210)
+		std::cout << "good" << std::endl;
+	Utilities::SubtractRange(v1.begin(), v1.end(), v3.begin(), Utilities::Saturate());
+	Utilities::MultiplyRange(v1.begin(), v1.end(), v2.begin(), Utilities::Saturate());
+	if (v3[0] == 55 && v2[0] == 255 && v2[36] == 255)
+		std::cout << "good" << std::endl;
+
+	// Narrows without widening by hand.
+	std::vector<float> v4 = { -1.5f, 0.5f, 254.9f, 300.0f };
+	std::vector<short> v5 = { -1, 128, 255, 256 };
+	std::vector<unsigned char> v6(4), v7(4);
+	Utilities::CastRange(v4.data(), v4.data() + v4.size(), v6.data(), Utilities::Saturate());
+	Utilities::CastRange(v5.data(), v5.data() + v5.size(), v7.data(), Utilities::Saturate());
+	if (v6 == std::vector<unsigned char>{ 0, 0, 254, 255 } &&
+		v7 == std::vector<unsigned char>{ 0, 128, 255, 255 })
+		std::cout << "good" << std::endl;
+}
+
 void TestContainers(void)
 {
 	std::array<int, 2> arrayI1 = { 1, 2 }, arrayI2{ 2, 3 }, arrayI3;
@@ -213,5 +275,7 @@ int main(void)
 {
 	TestSafeOperations();
 	TestAlgorithms();
+	TestCheckedRanges();
+	TestSaturate();
 	TestContainers();
 }
\ No newline at end of file